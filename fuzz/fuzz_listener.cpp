@@ -0,0 +1,40 @@
+#include "nmea/listener.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <linux/can.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Keeps the whole input inside the default socket buffer so the write never blocks
+constexpr size_t MAX_FRAMES = 512;
+
+// Input is a raw stream of can_frame structs, replayed through a Listener as if read from the bus
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    const size_t frames = size / sizeof(can_frame);
+    if (frames == 0 || frames > MAX_FRAMES) {
+        return -1;
+    }
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+        return 0;
+    }
+    nmea::Listener listener(fds[0]);
+
+    for (size_t i = 0; i < frames; i++) {
+        can_frame frame{};
+        std::memcpy(&frame, data + i * sizeof(can_frame), sizeof(can_frame));
+        if (::write(fds[1], &frame, sizeof(frame)) != sizeof(frame)) {
+            break;
+        }
+    }
+    close(fds[1]);
+
+    // Every call consumes at least one frame, and returns an error once the stream is drained
+    for (size_t i = 0; i < frames; i++) {
+        auto _ = listener.read();
+    }
+
+    return 0;
+}
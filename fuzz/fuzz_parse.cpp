@@ -0,0 +1,21 @@
+#include "nmea/message.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <span>
+
+// Input layout: 4 bytes of little endian CAN id followed by the payload
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 4) {
+        return -1;
+    }
+    const uint32_t id = uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) |
+                        (uint32_t(data[3]) << 24);
+
+    auto msg = nmea::parse(id, std::span<const uint8_t>(data + 4, size - 4));
+    if (msg) {
+        auto _ = std::format("{}", *msg);
+    }
+
+    return 0;
+}
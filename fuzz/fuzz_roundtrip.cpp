@@ -0,0 +1,49 @@
+#include "nmea/message.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+
+constexpr std::array SUPPORTED_PGNS{
+    nmea::pgn::VESSEL_HEADING,
+    nmea::pgn::RATE_OF_TURN,
+    nmea::pgn::HEAVE,
+    nmea::pgn::ATTITUDE,
+    nmea::pgn::POSITION,
+    nmea::pgn::COG_SOG,
+    nmea::pgn::TEMPERATURE,
+    nmea::pgn::VESSEL_SPEED,
+    nmea::pgn::ENVIRONMENTAL_PARAMETERS,
+    nmea::pgn::ACTUAL_PRESSURE,
+};
+
+// Differential check between parse() and serialize(): once a payload has been through one
+// parse/serialize cycle, another cycle must reproduce exactly the same bytes.
+//
+// Input layout: 1 byte selecting the PGN followed by the payload
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 1) {
+        return -1;
+    }
+    const uint32_t msg_pgn = SUPPORTED_PGNS[data[0] % SUPPORTED_PGNS.size()];
+
+    auto first = nmea::parse(msg_pgn << 8, std::span<const uint8_t>(data + 1, size - 1));
+    if (!first) {
+        return 0;
+    }
+    auto serialized = nmea::serialize(*first);
+    if (serialized.pgn != msg_pgn) {
+        std::abort();
+    }
+
+    auto second = nmea::parse(serialized.pgn << 8, serialized.data);
+    if (!second || second->index() != first->index()) {
+        std::abort();
+    }
+    if (nmea::serialize(*second).data != serialized.data) {
+        std::abort();
+    }
+
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <print>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+// Stand-in for the libFuzzer driver: runs every file passed on the command line once
+int main(int argc, const char **argv) {
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::println("Unable to open {}", argv[i]);
+            return EXIT_FAILURE;
+        }
+        std::vector<uint8_t> input(std::istreambuf_iterator<char>(file), {});
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+struct can_frame;
+
+namespace nmea {
+
+/// Addresses 0 to 251 can be claimed. 252 and 253 are reserved and 254 is the null address
+constexpr uint8_t MAX_CLAIMABLE_ADDRESS = 251;
+
+/// Map of claimed source addresses and the NAME of the device holding them, learned passively
+/// from the address claims seen on the bus.
+///
+/// All methods are thread safe so that a map can be filled by a `Listener` while a `Device` is
+/// claiming an address on another thread.
+class AddressMap {
+public:
+    /// Record the claim if `frame` is an address claim (PGN 60928). Other frames are ignored
+    void observe(const can_frame &frame);
+
+    /// Record that `name` holds `address`. A null address (254) means the device could not claim
+    /// an address and it is removed from the map
+    void record(uint8_t address, uint64_t name);
+
+    std::optional<uint64_t> name(uint8_t address) const;
+    std::optional<uint8_t> address(uint64_t name) const;
+
+    /// First address from `preferred` onwards (wrapping around) that `own_name` can claim, ie.
+    /// that is not held by a device whose NAME wins the contest against it. Addresses held by
+    /// `own_name` or by a lower priority (numerically higher) NAME count as free
+    std::optional<uint8_t> free_address(uint8_t preferred, uint64_t own_name) const;
+
+    /// Whether `address` is held by a device whose NAME wins the contest against `own_name`
+    bool taken(uint8_t address, uint64_t own_name) const;
+
+    /// Number of claimed addresses
+    size_t size() const;
+
+    void clear();
+
+private:
+    mutable std::mutex m_mutex;
+    std::array<std::optional<uint64_t>, MAX_CLAIMABLE_ADDRESS + 1> m_names{};
+};
+
+} // namespace nmea
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sys/epoll.h>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace nmea {
+
+class Executor;
+class Transport;
+
+namespace internal {
+/// Resumes the coroutine that awaited a task once the task completes
+struct ResumeContinuation {
+    bool await_ready() noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+        return handle.promise().continuation;
+    }
+    void await_resume() noexcept {}
+};
+
+/// State shared by the promises of every coroutine type, so that awaiting a task hands down the
+/// executor that runs the awaiting coroutine
+struct PromiseBase {
+    Executor *executor = nullptr;
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    ResumeContinuation final_suspend() noexcept { return {}; }
+    // Errors are returned as values, so an exception escaping a coroutine is a bug
+    void unhandled_exception() noexcept { std::terminate(); }
+};
+
+template <typename T> struct PromiseResult : PromiseBase {
+    std::optional<T> value;
+
+    template <typename U> void return_value(U &&result) { value.emplace(std::forward<U>(result)); }
+    T take() { return std::move(*value); }
+};
+
+template <> struct PromiseResult<void> : PromiseBase {
+    void return_void() noexcept {}
+    void take() noexcept {}
+};
+
+/// Starts a task when awaited, handing it the executor of the awaiting coroutine
+template <typename Promise> struct StartTask {
+    std::coroutine_handle<Promise> handle;
+
+    bool await_ready() noexcept { return false; }
+    template <typename P>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<P> parent) noexcept {
+        handle.promise().executor = parent.promise().executor;
+        handle.promise().continuation = parent;
+        return handle;
+    }
+    auto await_resume() { return handle.promise().take(); }
+};
+
+/// A coroutine waiting for a file descriptor, a deadline or both
+struct Waiter {
+    std::coroutine_handle<> handle;
+    int fd = -1;
+    std::optional<std::multimap<std::chrono::steady_clock::time_point, Waiter *>::iterator> timer;
+    bool timed_out = false;
+};
+} // namespace internal
+
+/// Lazily started coroutine returning `T`. It runs when awaited, on the executor of the
+/// coroutine awaiting it, or when passed to `Executor::spawn()` or `Executor::block_on()`
+template <typename T = void> class [[nodiscard]] Task {
+public:
+    struct promise_type : internal::PromiseResult<T> {
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+    };
+
+    Task(Task &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task &other) = delete;
+    Task &operator=(const Task &other) = delete;
+    ~Task() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    internal::StartTask<promise_type> operator co_await() && noexcept { return {m_handle}; }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/// Awaitable that resumes the coroutine once `fd` is ready for `events` (`EPOLLIN`, `EPOLLOUT`)
+/// or `deadline` has passed. `co_await` yields false on timeout. Wake ups may be spurious, so the
+/// caller must check the file descriptor again
+class Wait {
+public:
+    Wait(int fd, uint32_t events, std::optional<std::chrono::steady_clock::time_point> deadline)
+        : m_fd(fd), m_events(events), m_deadline(deadline) {}
+
+    bool await_ready() const noexcept { return false; }
+    template <typename P> void await_suspend(std::coroutine_handle<P> handle) {
+        suspend(*handle.promise().executor, handle);
+    }
+    bool await_resume() const noexcept { return !m_waiter.timed_out; }
+
+private:
+    void suspend(Executor &executor, std::coroutine_handle<> handle);
+
+    int m_fd;
+    uint32_t m_events;
+    std::optional<std::chrono::steady_clock::time_point> m_deadline;
+    internal::Waiter m_waiter;
+};
+
+/// Wait until `fd` is readable
+inline Wait readable(int fd) { return Wait(fd, EPOLLIN, std::nullopt); }
+/// Wait until `fd` is readable or `deadline` has passed
+inline Wait readable(int fd, std::chrono::steady_clock::time_point deadline) {
+    return Wait(fd, EPOLLIN, deadline);
+}
+/// Wait until `fd` is writable
+inline Wait writable(int fd) { return Wait(fd, EPOLLOUT, std::nullopt); }
+
+inline Wait sleep_until(std::chrono::steady_clock::time_point deadline) {
+    return Wait(-1, 0, deadline);
+}
+inline Wait sleep_for(std::chrono::steady_clock::duration duration) {
+    return sleep_until(std::chrono::steady_clock::now() + duration);
+}
+
+/// Wait until `transport` has a frame to read or `deadline` has passed. Returns false on timeout.
+/// Transports without a file descriptor, eg. `VirtualBus` nodes, are polled every millisecond
+Task<bool> frame_available(Transport &transport,
+                           std::optional<std::chrono::steady_clock::time_point> deadline = {});
+
+/// Runs coroutines on the threads that call `run()`, suspending them on epoll while they wait for
+/// a file descriptor or a timer. Thousands of listeners and devices can be driven by a few
+/// threads this way instead of a thread each.
+///
+/// A file descriptor can only be awaited by one coroutine at a time.
+class Executor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Executor();
+    ~Executor();
+
+    Executor(const Executor &other) = delete;
+    Executor &operator=(const Executor &other) = delete;
+    Executor(Executor &&other) noexcept = delete;
+    Executor &operator=(Executor &&other) noexcept = delete;
+
+    /// Run `task` to completion in the background of `run()`. The task is owned by the executor
+    void spawn(Task<> task);
+
+    /// Run coroutines until every spawned task has completed or `stop()` is called. Can be called
+    /// from several threads at once
+    void run();
+
+    /// Spawn `task` and run on the calling thread until it and every other spawned task completed
+    template <typename T> T block_on(Task<T> task) {
+        if constexpr (std::is_void_v<T>) {
+            spawn(std::move(task));
+            run();
+        } else {
+            std::optional<T> result;
+            spawn(store(std::move(task), result));
+            run();
+            return std::move(*result);
+        }
+    }
+
+    /// Make `run()` return in every thread, leaving unfinished tasks suspended. Once every thread
+    /// returned, `run()` can be called again to carry on with them
+    void stop();
+
+    /// Number of spawned tasks that have not completed
+    size_t pending() const;
+
+private:
+    friend class Wait;
+
+    struct Detached {
+        struct promise_type : internal::PromiseBase {
+            Detached get_return_object() {
+                return {std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            auto final_suspend() noexcept {
+                struct Finish {
+                    bool await_ready() noexcept { return false; }
+                    void await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                        Executor *executor = handle.promise().executor;
+                        handle.destroy();
+                        executor->finished(handle.address());
+                    }
+                    void await_resume() noexcept {}
+                };
+                return Finish{};
+            }
+            void return_void() noexcept {}
+        };
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    static Detached detach(Task<> task);
+    template <typename T> static Task<> store(Task<T> task, std::optional<T> &result) {
+        result.emplace(co_await std::move(task));
+    }
+
+    void schedule(std::coroutine_handle<> handle);
+    void suspend(internal::Waiter &waiter, uint32_t events,
+                 std::optional<Clock::time_point> deadline);
+    void complete(internal::Waiter &waiter, bool timed_out);
+    void finished(void *task);
+    void wake();
+
+    int m_epoll_fd;
+    int m_wake_fd;
+
+    mutable std::mutex m_mutex;
+    std::deque<std::coroutine_handle<>> m_ready;
+    std::unordered_map<int, internal::Waiter *> m_fd_waiters;
+    std::multimap<Clock::time_point, internal::Waiter *> m_timers;
+    // Frames of the spawned tasks, destroyed with the executor if they did not complete
+    std::unordered_set<void *> m_tasks;
+    bool m_stopping = false;
+    // Threads in `run()`. The last one to return clears `m_stopping`
+    size_t m_running = 0;
+};
+
+} // namespace nmea
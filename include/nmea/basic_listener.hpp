@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+
+#include "nmea/async.hpp"
+#include "nmea/connection.hpp"
+#include "nmea/decoder.hpp"
+#include "nmea/parse.hpp"
+#include "nmea/transport.hpp"
+#include <linux/can.h>
+
+namespace nmea {
+
+/// Listener for a chosen subset of the messages, eg.
+/// `BasicListener<message::VesselHeading, message::Position>`. The variant the messages are
+/// returned in, the table that decodes them and the kernel filter are generated from the types at
+/// compile time, so the read loop only compares the PGN of a payload with the chosen ones. Only
+/// the parsers of the chosen messages are instantiated, from `parse_as()`, and reassembly does not
+/// reference `parse()`, so the parsers of the other messages are not linked in from the static
+/// library. Messages of any policy can be chosen, eg.
+/// `message::BasicHeave<policy::Raw>`.
+///
+/// Payloads of other PGNs are skipped instead of being returned as errors. The hooks of
+/// `Listener` are not supported
+template <typename... Messages> class BasicListener {
+    static_assert(sizeof...(Messages) > 0, "BasicListener needs at least one message type");
+    // Reassembled payloads carry the PGN with the destination address of PDU1 messages folded
+    // into it, which would never compare equal to theirs
+    static_assert(((((Messages::pgn >> 8) & 0xFF) >= 240) && ...),
+                  "BasicListener only supports PDU2 messages");
+
+public:
+    using Message = std::variant<Messages...>;
+
+    /// PGNs of the chosen messages
+    static constexpr std::array<uint32_t, sizeof...(Messages)> pgns{Messages::pgn...};
+
+    /// Create a listener that owns the passed socket, of either `Protocol`. Call `filter()` to
+    /// have the kernel drop the other PGNs
+    explicit BasicListener(connection_t conn,
+                           std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : BasicListener(socket_transport(conn), resource) {}
+
+    explicit BasicListener(std::unique_ptr<Transport> transport,
+                           std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : m_transport(std::move(transport)), m_decoder(resource) {}
+
+    /// Only receive the frames of `pgns` on the socket, see `filter_pgns()`. Fails for
+    /// transports without a socket, which are filtered by `read()` only
+    std::expected<void, std::string> filter() {
+        if (sockfd() == -1) {
+            return std::unexpected("Transport has no socket to filter");
+        }
+        return filter_pgns(sockfd(), pgns);
+    }
+
+    std::expected<Message, std::string> read() {
+        while (true) {
+            auto result = read_next();
+            if (!result) {
+                return std::unexpected(result.error());
+            }
+            if (*result) {
+                return std::move(**result);
+            }
+        }
+    }
+
+    /// Awaitable `read()`
+    Task<std::expected<Message, std::string>> next() {
+        while (true) {
+            co_await frame_available(*m_transport);
+            auto result = read_next();
+            if (!result) {
+                co_return std::unexpected(result.error());
+            }
+            if (*result) {
+                co_return std::move(**result);
+            }
+        }
+    }
+
+    /// Pollable file descriptor of the transport, or -1 if it does not have one
+    int sockfd() const { return m_transport ? m_transport->fd() : -1; }
+
+    /// Source address of the message most recently returned by `read()`
+    uint8_t last_source() const { return m_last_source; }
+
+private:
+    /// A chosen message or decoding error, nullopt for anything else
+    using Decoded = std::optional<std::expected<Message, std::string>>;
+
+    std::expected<Decoded, std::string> read_next() {
+        if (m_transport->reassembles()) {
+            if (auto result = m_transport->read_packet(m_packet); !result) {
+                return std::unexpected(result.error());
+            }
+            m_last_source = m_packet.source;
+            return parse(m_packet.pgn, m_packet.data);
+        }
+        can_frame frame{};
+        if (auto result = m_transport->read(frame); !result) {
+            return std::unexpected(result.error());
+        }
+        m_last_source = frame.can_id & 0xFF;
+        auto payload = m_decoder.reassemble(frame);
+        if (!payload) {
+            return Decoded();
+        }
+        if (!*payload) {
+            return Decoded(std::unexpected(payload->error()));
+        }
+        return parse((*payload)->pgn, (*payload)->data);
+    }
+
+    static Decoded parse(uint32_t pgn, std::span<const uint8_t> data) {
+        Decoded result;
+        // One comparison per chosen message, in the order they were listed
+        (void)((pgn == Messages::pgn && (result.emplace(parse_as<Messages>(data)), true)) || ...);
+        return result;
+    }
+
+    std::unique_ptr<Transport> m_transport;
+    uint8_t m_last_source = 0;
+    Decoder m_decoder;
+    Packet m_packet{};
+};
+
+} // namespace nmea
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <vector>
+
+struct can_frame;
+
+namespace nmea {
+
+/// Decoding of many frames of a single PGN at once into struct-of-arrays buffers, for offline
+/// processing of captured traffic. Each field is converted for several frames at a time with
+/// SIMD kernels, and the results are identical to the ones of `parse()`.
+namespace batch {
+
+/// PGN 127257 - Attitude
+struct Attitude {
+    std::vector<uint8_t> sid;
+    std::vector<double> yaw;   // radians
+    std::vector<double> pitch; // radians
+    std::vector<double> roll;  // radians
+
+    size_t size() const { return sid.size(); }
+    void resize(size_t n);
+    void clear() { resize(0); }
+};
+
+/// PGN 129025 - Position, Rapid Update
+struct Position {
+    std::vector<double> latitude;  // degrees
+    std::vector<double> longitude; // degrees
+
+    size_t size() const { return latitude.size(); }
+    void resize(size_t n);
+    void clear() { resize(0); }
+};
+
+/// PGN 129026 - COG & SOG, Rapid Update
+struct CogSog {
+    std::vector<uint8_t> sid;
+    std::vector<uint8_t> cog_reference; // 0 = true, 1 = magnetic
+    std::vector<double> cog;            // radians
+    std::vector<double> sog;            // m/s
+
+    size_t size() const { return sid.size(); }
+    void resize(size_t n);
+    void clear() { resize(0); }
+};
+
+/// Instruction set used by the decode kernels
+enum class Simd {
+    SCALAR,
+    SSE2,
+    AVX2,
+};
+
+/// Best instruction set supported by the CPU
+Simd detect_simd();
+
+/// Decode `frames` and append them to `out`. Every frame must be of the PGN of `out` and long
+/// enough for it, otherwise nothing is appended and the first offending frame is reported.
+///
+/// `simd` can be lowered to compare or benchmark kernels. It is capped to `detect_simd()`
+std::expected<void, std::string> decode(std::span<const can_frame> frames, Attitude &out,
+                                        Simd simd = detect_simd());
+std::expected<void, std::string> decode(std::span<const can_frame> frames, Position &out,
+                                        Simd simd = detect_simd());
+std::expected<void, std::string> decode(std::span<const can_frame> frames, CogSog &out,
+                                        Simd simd = detect_simd());
+
+} // namespace batch
+} // namespace nmea
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include "nmea/shm_ring.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <linux/can.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nmea {
+namespace internal {
+struct RingSlot;
+} // namespace internal
+
+struct BroadcastConfig {
+    /// Number of entries kept in the ring, rounded up to a power of two. Readers that fall this
+    /// far behind the writer are overrun
+    size_t capacity = 8192;
+};
+
+class BroadcastReader;
+
+/// In-process ring that a single `Listener` publishes to with `Listener::set_broadcast()`, so
+/// that the bus is read and decoded once for any number of consumers in the process. Each
+/// consumer has its own `BroadcastReader`, with its own position and PGN filter.
+///
+/// The writer never waits for the readers. There must be only one writer, and the ring must
+/// outlive its readers
+class BroadcastRing {
+public:
+    using Clock = std::chrono::system_clock;
+
+    explicit BroadcastRing(BroadcastConfig config = {});
+    ~BroadcastRing();
+
+    BroadcastRing(const BroadcastRing &other) = delete;
+    BroadcastRing &operator=(const BroadcastRing &other) = delete;
+    BroadcastRing(BroadcastRing &&other) noexcept = delete;
+    BroadcastRing &operator=(BroadcastRing &&other) noexcept = delete;
+
+    void write(const can_frame &frame, Clock::time_point timestamp = Clock::now());
+    void write(const can_frame &frame, const NmeaMessage &message,
+               Clock::time_point timestamp = Clock::now());
+
+    /// Reader of the entries written from now on. With `pgns`, it only sees the entries of those
+    /// PGNs: the PGN of the message an entry completed, or else the PGN of its frame
+    BroadcastReader subscribe(std::vector<uint32_t> pgns = {}) const;
+
+    size_t capacity() const { return m_capacity; }
+
+private:
+    friend class BroadcastReader;
+
+    void write_entry(const can_frame &frame, const NmeaMessage *message,
+                     Clock::time_point timestamp);
+
+    size_t m_capacity;
+    std::unique_ptr<internal::RingSlot[]> m_slots;
+    // Sequence of the next entry to be written
+    alignas(64) std::atomic<uint64_t> m_head = 0;
+
+    // Only touched when a reader is blocked in `wait()`, so the writer does not make a system
+    // call per entry otherwise
+    alignas(64) mutable std::atomic<uint32_t> m_waiters = 0;
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+};
+
+/// Cursor of one consumer over a `BroadcastRing`. Not thread-safe, each consumer has its own
+class BroadcastReader {
+public:
+    /// Next entry that passes the filter, or nullopt if the reader has caught up with the writer.
+    /// If the writer lapped the reader, an error tells how many entries were lost and reading
+    /// resumes at the oldest entry still in the ring
+    std::expected<std::optional<RingEntry>, std::string> next();
+
+    /// Block until an entry was written after those already read, or `timeout` passed. Returns
+    /// false on timeout. The entry may not pass the filter
+    bool wait(std::chrono::milliseconds timeout) const;
+
+    /// Total number of entries lost to overruns
+    uint64_t lost() const { return m_lost; }
+
+private:
+    friend class BroadcastRing;
+
+    BroadcastReader(const BroadcastRing &ring, std::vector<uint32_t> pgns);
+    bool wants(uint32_t pgn) const;
+
+    const BroadcastRing *m_ring;
+    std::vector<uint32_t> m_pgns; // Sorted. Empty for every PGN
+    uint64_t m_next;
+    uint64_t m_lost = 0;
+};
+
+} // namespace nmea
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct can_frame;
+
+namespace nmea {
+
+struct BusLoadConfig {
+    /// Nominal bit rate of the bus. NMEA2000 runs at 250 kbit/s
+    uint32_t bitrate = 250000;
+    /// Length of the sliding window the load is averaged over
+    std::chrono::milliseconds window{1000};
+};
+
+/// Traffic seen within the sliding window
+struct BusUsage {
+    uint64_t frames;
+    uint64_t bits; // On-wire bits, including stuff bits and inter-frame space
+    double load;   // Fraction of the bus capacity, 0 to 1
+};
+
+/// Streaming bus load analyzer. Feed it every frame seen on the bus and it keeps sliding window
+/// totals for the whole bus, each PGN and each source address.
+///
+/// The window is split into `BUCKETS` time buckets that are recycled lazily, so recording a frame
+/// and querying a total are both constant time.
+class BusLoad {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t BUCKETS = 10;
+
+    explicit BusLoad(BusLoadConfig config = {});
+
+    /// Number of bits the frame takes on the wire, from start of frame to the end of the
+    /// inter-frame space, including the stuff bits for its exact contents
+    static uint32_t frame_bits(const can_frame &frame);
+
+    void record(const can_frame &frame, Clock::time_point now = Clock::now());
+
+    BusUsage total(Clock::time_point now = Clock::now()) const;
+    BusUsage pgn(uint32_t pgn, Clock::time_point now = Clock::now()) const;
+    BusUsage source(uint8_t source, Clock::time_point now = Clock::now()) const;
+
+    /// Usage of every PGN that was seen within the window
+    std::vector<std::pair<uint32_t, BusUsage>> pgns(Clock::time_point now = Clock::now()) const;
+
+private:
+    struct Bucket {
+        uint64_t epoch = 0;
+        uint64_t frames = 0;
+        uint64_t bits = 0;
+    };
+
+    using Window = std::array<Bucket, BUCKETS>;
+
+    uint64_t epoch(Clock::time_point now) const;
+    void add(Window &window, uint64_t epoch, uint32_t bits);
+    BusUsage usage(const Window &window, uint64_t epoch) const;
+
+    BusLoadConfig m_config;
+    Clock::duration m_bucket_width;
+    Window m_total{};
+    std::array<Window, 256> m_sources{};
+    std::unordered_map<uint32_t, Window> m_pgns;
+};
+
+} // namespace nmea
@@ -1,11 +1,61 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <expected>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 
 namespace nmea {
 using connection_t = int;
 
-std::expected<connection_t, std::string> connect(std::string_view interface);
+enum class Protocol : uint8_t {
+    /// Raw CAN frames. Transport protocol transfers are handled by the library
+    RAW,
+    /// Linux kernel J1939 stack, which reassembles and segments TP and ETP transfers so that
+    /// whole PGN payloads are read and written
+    J1939,
+};
+
+/// Socket options for `connect()`. Options left empty keep the kernel defaults
+struct ConnectOptions {
+    Protocol protocol = Protocol::RAW;
+    /// Size of the receive queue in bytes, so that bursts are not dropped while the reader is
+    /// busy. Beyond `net.core.rmem_max` it needs CAP_NET_ADMIN
+    std::optional<int> receive_buffer = std::nullopt;
+    /// Size of the send queue in bytes. Beyond `net.core.wmem_max` it needs CAP_NET_ADMIN
+    std::optional<int> send_buffer = std::nullopt;
+    /// Busy poll the device for this long on blocking reads (`SO_BUSY_POLL`), trading CPU time
+    /// for latency. Needs CAP_NET_ADMIN
+    std::optional<std::chrono::microseconds> busy_poll = std::nullopt;
+    /// Queueing discipline priority of the frames written (`SO_PRIORITY`). Beyond 6 it needs
+    /// CAP_NET_ADMIN
+    std::optional<int> priority = std::nullopt;
+    /// Open the socket with O_NONBLOCK, so reads fail instead of blocking when no frame is queued
+    bool nonblocking = false;
+
+    // Raw sockets only
+
+    /// Echo the frames written to other sockets on the same host (`CAN_RAW_LOOPBACK`)
+    bool loopback = true;
+    /// Also echo the frames written to this socket (`CAN_RAW_RECV_OWN_MSGS`). Needs `loopback`
+    bool receive_own_messages = false;
+    /// Error classes to receive as error frames (`CAN_RAW_ERR_FILTER`), eg. `CAN_ERR_BUSOFF`.
+    /// The decoder returns them as errors
+    uint32_t error_mask = 0;
+};
+
+std::expected<connection_t, std::string> connect(std::string_view interface,
+                                                 Protocol protocol = Protocol::RAW);
+
+/// Connect with tuned socket options, eg. to absorb bursts or cut the tail latency of reads
+std::expected<connection_t, std::string> connect(std::string_view interface,
+                                                 const ConnectOptions &options);
+
+/// Only receive the frames of `pgns` on a socket returned by `connect()`, so that the kernel
+/// drops the others instead of waking the reader for them. Raw sockets also receive every
+/// transport protocol frame, since the data packets do not tell the PGN of their transfer
+std::expected<void, std::string> filter_pgns(connection_t conn, std::span<const uint32_t> pgns);
 } // namespace nmea
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include <cstdint>
+#include <expected>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct can_frame;
+
+namespace nmea {
+
+struct TpTransfer {
+    uint32_t pgn;
+    uint8_t priority;
+    uint8_t destination;
+    uint16_t total_size;
+    uint8_t total_packets;
+    uint8_t next_packet; // 0 once the transfer is over
+    std::pmr::vector<uint8_t> buffer;
+};
+
+/// Payload of a complete message
+struct Payload {
+    /// Without the destination address of PDU1 PGNs
+    uint32_t pgn;
+    uint8_t priority;
+    uint8_t source;
+    /// Destination address of PDU1 PGNs, 0xFF for broadcasts
+    uint8_t destination;
+    std::span<const uint8_t> data;
+};
+
+/// Turns raw frames into messages, reassembling transport protocol transfers on the way.
+///
+/// Transfers are tracked per source address, so frames from one source must be decoded in the
+/// order they were received. Frames from different sources can go through different decoders.
+///
+/// Transfer buffers are allocated from `resource` and kept once a transfer is over, so that after
+/// the first transfer from each source decoding does not allocate
+class Decoder {
+public:
+    explicit Decoder(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : m_tp_transfers(resource) {}
+
+    /// Decode a frame. Returns nullopt when the frame was consumed by a transport protocol
+    /// transfer that is not complete yet.
+    ///
+    /// Inline so that reassembling frames does not link the parsers of every message type
+    std::optional<std::expected<NmeaMessage, std::string>> decode(const can_frame &frame) {
+        auto payload = reassemble(frame);
+        if (!payload) {
+            return std::nullopt;
+        }
+        if (!*payload) {
+            return std::unexpected(payload->error());
+        }
+        return parse((*payload)->pgn << 8, (*payload)->data);
+    }
+
+    /// Reassemble a frame into the payload of a message without parsing it, eg. to parse only
+    /// some message types. The payload points into `frame` or into the transfer buffer, so it is
+    /// only valid until the next frame is passed and while `frame` is alive
+    std::optional<std::expected<Payload, std::string>> reassemble(const can_frame &frame);
+
+private:
+    std::expected<void, std::string> handle_tp_bam(uint8_t source, const can_frame &frame);
+    std::optional<std::expected<Payload, std::string>> handle_tp_dt(uint8_t source,
+                                                                    const can_frame &frame);
+
+    std::pmr::unordered_map<uint8_t, TpTransfer> m_tp_transfers;
+};
+
+} // namespace nmea
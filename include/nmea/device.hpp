@@ -1,15 +1,30 @@
 #pragma once
 
+#include "nmea/address_map.hpp"
+#include "nmea/async.hpp"
 #include "nmea/connection.hpp"
 #include "nmea/definitions.hpp"
+#include "nmea/interface_monitor.hpp"
 #include "nmea/message.hpp"
+#include "nmea/transport.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <expected>
 #include <future>
+#include <linux/can.h>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace nmea {
+namespace internal {
+struct SendQueue;
+} // namespace internal
 
 /// Device information (NAME). This is a 64 bit frame. If any field is larger than the
 /// maximum length, then the upper bits are ignored.
@@ -24,13 +39,42 @@ struct DeviceName {
     bool arbitrary_address_capable;     // 1 bit
 };
 
+/// Product Information (PGN 126996) sent in answer to ISO Requests. Strings longer than 32
+/// characters are truncated
+struct ProductInfo {
+    /// Version of the NMEA 2000 standard the device implements, in units of 0.001
+    uint16_t nmea2000_version = 2100;
+    uint16_t product_code = 0;
+    std::string model_id;
+    std::string software_version;
+    std::string model_version;
+    std::string serial_code;
+    uint8_t certification_level = 0;
+    /// Current drawn from the bus, in units of 50 mA
+    uint8_t load_equivalency = 1;
+};
+
+/// Configuration Information (PGN 126998) sent in answer to ISO Requests. Strings longer than 70
+/// characters are truncated
+struct ConfigurationInfo {
+    std::string installation_description1;
+    std::string installation_description2;
+    std::string manufacturer_information;
+};
+
 class Device {
 public:
-    /// Create a NMEA2000 device that is able to communicate on the bus
+    using Clock = std::chrono::steady_clock;
+
+    /// Create a NMEA2000 device that is able to communicate on the bus, over a socket of either
+    /// `Protocol`
     ///
     /// This object will then own the socket it is connected to and will be responsible
     /// for closing it once done
     explicit Device(connection_t conn);
+
+    /// Create a device that communicates over any transport, eg. a `VirtualBus` node
+    explicit Device(std::unique_ptr<Transport> transport);
     Device() = delete;
     ~Device();
 
@@ -39,18 +83,106 @@ public:
     Device(Device &&other) noexcept;
     Device &operator=(Device &&other) noexcept;
 
-    int sockfd() const { return m_conn; }
+    /// Pollable file descriptor of the transport, or -1 if it does not have one
+    int sockfd() const { return m_transport ? m_transport->fd() : -1; }
 
     std::optional<uint8_t> address() const { return m_address; }
 
+    /// Addresses claimed by other devices. It is filled while claiming, and can also be kept up to
+    /// date passively with `Listener::set_address_map()` so that a claim can pick a free address
+    /// without any conflicts
+    AddressMap &address_map() { return *m_address_map; }
+
     std::shared_future<std::expected<void, std::string>> claim(DeviceName name);
+    /// Send a message once an address has been claimed. Safe to call from any number of threads
+    /// at once: the calls are queued without a lock and written by one of the calling threads at a
+    /// time, so transport protocol transfers are never interleaved
     std::expected<void, std::string> send(const NmeaMessage &msg);
     std::expected<void, std::string> send(const NmeaMessage &msg, uint8_t priority);
 
+    /// Send `messages` in order, at their default priority, with as few system calls as possible:
+    /// on a raw socket the frames of every message are written with a single `sendmmsg()`. Returns
+    /// how many messages, from the first one, were sent in full, so that the rest can be retried.
+    /// Fails only if none was sent. Transfers of other threads are never interleaved with the batch
+    std::expected<size_t, std::string> send_batch(std::span<const NmeaMessage> messages);
+
+    /// Claim an address on the executor of the awaiting coroutine, without a thread of its own
+    Task<std::expected<void, std::string>> claim_async(DeviceName name);
+    /// Send once the transport is writable, suspending the awaiting coroutine meanwhile
+    Task<std::expected<void, std::string>> send_async(NmeaMessage msg);
+    Task<std::expected<void, std::string>> send_async(NmeaMessage msg, uint8_t priority);
+
+    /// Answer ISO Requests for the Product Information with `info`. The Fast Packet frames are
+    /// built once here so that answering only has to write them out
+    void set_product_info(const ProductInfo &info);
+    /// Answer ISO Requests for the Configuration Information with `info`, also as Fast Packet
+    void set_configuration_info(const ConfigurationInfo &info);
+
+    /// Interval of the Heartbeat (PGN 126993), 60 s by default. The next heartbeat is due at once
+    /// so that it announces the new interval
+    void set_heartbeat_interval(std::chrono::milliseconds interval);
+
+    /// Handle a frame read from the bus. ISO Requests for the Address Claim, Product Information,
+    /// Configuration Information and Heartbeat of the device are answered, requests for other
+    /// PGNs addressed to the device are rejected with a NACK. The answers are queued with the
+    /// messages of `send()`, so they never interleave with a transfer of another thread. Does
+    /// nothing until an address has been claimed
+    std::expected<void, std::string> handle(const can_frame &frame);
+
+    /// Send the Heartbeat if it is due. Returns when the next one is due. A heartbeat that could
+    /// not be sent stays due
+    std::expected<Clock::time_point, std::string> heartbeat(Clock::time_point now = Clock::now());
+
+    /// Read and handle the frames received within `timeout`, sending Heartbeats when due. Fails
+    /// while an address claim is in progress
+    std::expected<void, std::string> process(std::chrono::milliseconds timeout);
+
+    /// Reconnect when the interface comes back after `monitor` saw it go down, eg. after a USB
+    /// adapter was reset. `process()` also wakes up on the changes of the link state: while the
+    /// interface is down it only waits for it to come back, without sending heartbeats, and once
+    /// it is back it carries on with a new socket and claims an address again with the name last
+    /// claimed. Sends fail while the interface is down. The filter of a `CAN_RAW` socket is carried
+    /// over to the new one, that of a `CAN_J1939` socket is not. The transport must have a
+    /// socket. The monitor is not owned and must outlive the device. Pass nullptr to stop
+    std::expected<void, std::string> set_interface_monitor(InterfaceMonitor *monitor);
+
 private:
-    connection_t m_conn;
+    /// What reads from the transport. Only one claim or `process()` may at a time, or they would
+    /// consume each other's frames
+    enum class Reader : uint8_t { None, Claim, Process };
+
+    /// Become the reader for the duration of a claim or `process()`, or fail if another one is
+    std::expected<void, std::string> begin_reading(Reader reader);
+    Task<std::expected<void, std::string>> claim_address(DeviceName name);
+    std::expected<void, std::string> answer_request(uint32_t pgn, uint8_t requester,
+                                                    bool global);
+    std::expected<void, std::string> send_heartbeat();
+    /// Queue `frames` with the messages of `send()` and wait until they are written
+    std::expected<void, std::string> send_frames(std::span<const can_frame> frames);
+    /// Send cached Fast Packet frames from the address of the device, with the next sequence
+    std::expected<void, std::string> send_fast_packet(std::span<const can_frame> frames);
+    /// Reconnect the transport if its interface came back, and claim the address again
+    std::expected<InterfaceMonitor::LinkState, std::string> update_link();
+    /// Wait up to `timeout` for a frame, or for a change of the link state
+    bool wait_frame(std::chrono::milliseconds timeout);
+
+    std::unique_ptr<Transport> m_transport;
+    std::unique_ptr<AddressMap> m_address_map;
+    std::unique_ptr<internal::SendQueue> m_send_queue;
     std::optional<uint8_t> m_address;
+    uint64_t m_name = 0;
+    std::optional<DeviceName> m_device_name;
     std::shared_future<std::expected<void, std::string>> m_claim_future;
+    std::atomic<Reader> m_reader = Reader::None;
+
+    // Frames of the answers without the source address, which is filled in when sending
+    std::vector<can_frame> m_product_info;
+    std::vector<can_frame> m_configuration_info;
+    uint8_t m_fast_packet_sequence = 0;
+    std::chrono::milliseconds m_heartbeat_interval{60000};
+    Clock::time_point m_next_heartbeat{};
+    uint8_t m_heartbeat_sequence = 0;
+    std::unique_ptr<InterfaceMonitor::Watch> m_watch;
 };
 
 } // namespace nmea
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include "nmea/visit.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace nmea {
+
+/// Routes messages to handlers subscribed to a specific message type and, optionally, a
+/// specific source address.
+///
+/// Handlers are kept in a flat table indexed by the variant alternative, so dispatching a message
+/// only touches the handlers registered for its type. Callables are stored inline (no heap
+/// allocation per handler) and must fit in `HANDLER_STORAGE` bytes.
+class Dispatcher {
+public:
+    static constexpr std::size_t HANDLER_STORAGE = 4 * sizeof(void *);
+    static constexpr uint16_t ANY_SOURCE = 0x100;
+
+    using SubscriptionId = uint32_t;
+
+    Dispatcher() = default;
+    ~Dispatcher() = default;
+
+    Dispatcher(const Dispatcher &other) = delete;
+    Dispatcher &operator=(const Dispatcher &other) = delete;
+    Dispatcher(Dispatcher &&other) noexcept = default;
+    Dispatcher &operator=(Dispatcher &&other) noexcept = default;
+
+    /// Subscribe to every message of type `T`. The handler is called as either
+    /// `handler(const T &)` or `handler(const T &, uint8_t source)`
+    template <typename T, typename F> SubscriptionId on(F &&handler) {
+        return subscribe<T>(ANY_SOURCE, std::forward<F>(handler));
+    }
+
+    /// Subscribe to messages of type `T` sent by a single source address
+    template <typename T, typename F> SubscriptionId on(uint8_t source, F &&handler) {
+        return subscribe<T>(source, std::forward<F>(handler));
+    }
+
+    /// Remove a subscription. Unknown ids are ignored
+    void off(SubscriptionId id) {
+        auto is_id = [&](const Pending &pending) { return pending.slot.id == id; };
+        if (std::erase_if(m_pending, is_id) > 0) {
+            return;
+        }
+        for (auto &slots : m_routes) {
+            for (auto iter = slots.begin(); iter != slots.end(); ++iter) {
+                if (iter->id == id && !iter->removed) {
+                    // A handler being called, which may be the one removing itself, is only
+                    // skipped until the dispatch is over
+                    if (m_dispatching > 0) {
+                        iter->removed = true;
+                        m_has_removed = true;
+                    } else {
+                        slots.erase(iter);
+                    }
+                    return;
+                }
+            }
+        }
+    }
+
+    /// Call every handler subscribed to the type of `msg` (and to `source`, if filtered).
+    ///
+    /// Handlers may subscribe and unsubscribe, including themselves. Those changes take effect
+    /// once the outermost dispatch returns: a handler removed meanwhile is not called anymore, and
+    /// one added meanwhile is only called from the next dispatch on
+    void dispatch(const NmeaMessage &msg, uint8_t source) {
+        m_dispatching++;
+        try {
+            // Slots are only appended or erased after the dispatch, so the iteration stays valid
+            for (const auto &slot : m_routes[msg.index()]) {
+                if (!slot.removed && (slot.source == ANY_SOURCE || slot.source == source)) {
+                    slot.ops->invoke(slot.storage, msg, source);
+                }
+            }
+        } catch (...) {
+            finish_dispatch();
+            throw;
+        }
+        finish_dispatch();
+    }
+
+    /// Number of handlers subscribed to message type `T`
+    template <typename T> std::size_t subscribers() const {
+        constexpr auto route = internal::variant_index_v<T, NmeaMessage>;
+        return static_cast<std::size_t>(
+            std::ranges::count(m_routes[route], false, &Slot::removed) +
+            std::ranges::count(m_pending, route, &Pending::route));
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(const void *storage, const NmeaMessage &msg, uint8_t source);
+        void (*relocate)(void *dst, void *src) noexcept;
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    struct Slot {
+        SubscriptionId id;
+        uint16_t source;
+        const Ops *ops;
+        bool removed = false;
+        alignas(std::max_align_t) std::byte storage[HANDLER_STORAGE];
+
+        Slot(SubscriptionId slot_id, uint16_t slot_source, const Ops *slot_ops)
+            : id(slot_id), source(slot_source), ops(slot_ops) {}
+
+        ~Slot() {
+            if (ops) {
+                ops->destroy(storage);
+            }
+        }
+
+        Slot(const Slot &other) = delete;
+        Slot &operator=(const Slot &other) = delete;
+
+        Slot(Slot &&other) noexcept
+            : id(other.id), source(other.source), ops(std::exchange(other.ops, nullptr)),
+              removed(other.removed) {
+            if (ops) {
+                ops->relocate(storage, other.storage);
+            }
+        }
+
+        Slot &operator=(Slot &&other) noexcept {
+            if (this != &other) {
+                if (ops) {
+                    ops->destroy(storage);
+                }
+                id = other.id;
+                source = other.source;
+                ops = std::exchange(other.ops, nullptr);
+                removed = other.removed;
+                if (ops) {
+                    ops->relocate(storage, other.storage);
+                }
+            }
+            return *this;
+        }
+    };
+
+    template <typename T, typename Fn> static constexpr Ops ops_for{
+        .invoke =
+            [](const void *storage, const NmeaMessage &msg, uint8_t source) {
+                const auto &fn = *std::launder(reinterpret_cast<const Fn *>(storage));
+                const auto &m = *std::get_if<T>(&msg);
+                if constexpr (std::is_invocable_v<const Fn &, const T &, uint8_t>) {
+                    fn(m, source);
+                } else {
+                    fn(m);
+                }
+            },
+        .relocate =
+            [](void *dst, void *src) noexcept {
+                auto *from = std::launder(reinterpret_cast<Fn *>(src));
+                ::new (dst) Fn(std::move(*from));
+                from->~Fn();
+            },
+        .destroy = [](void *storage) noexcept {
+            std::launder(reinterpret_cast<Fn *>(storage))->~Fn();
+        },
+    };
+
+    template <typename T, typename F> SubscriptionId subscribe(uint16_t source, F &&handler) {
+        using Fn = std::decay_t<F>;
+        static_assert(std::is_invocable_v<const Fn &, const T &> ||
+                          std::is_invocable_v<const Fn &, const T &, uint8_t>,
+                      "Handler must be callable with (const T &) or (const T &, uint8_t)");
+        static_assert(sizeof(Fn) <= HANDLER_STORAGE, "Handler captures too much state");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "Handler is over-aligned");
+        static_assert(std::is_nothrow_move_constructible_v<Fn>,
+                      "Handler must be nothrow move constructible");
+
+        Fn fn(std::forward<F>(handler));
+        constexpr auto route = internal::variant_index_v<T, NmeaMessage>;
+        const SubscriptionId id = m_next_id++;
+        // Appending to a table being dispatched could move the handler that is being called
+        auto &slot = m_dispatching > 0
+                         ? m_pending.emplace_back(route, Slot(id, source, nullptr)).slot
+                         : m_routes[route].emplace_back(id, source, nullptr);
+        ::new (static_cast<void *>(slot.storage)) Fn(std::move(fn));
+        slot.ops = &ops_for<T, Fn>;
+        return id;
+    }
+
+    struct Pending {
+        std::size_t route;
+        Slot slot;
+    };
+
+    /// Apply the changes made by the handlers once the outermost dispatch is over
+    void finish_dispatch() {
+        if (--m_dispatching > 0) {
+            return;
+        }
+        if (m_has_removed) {
+            for (auto &slots : m_routes) {
+                std::erase_if(slots, [](const Slot &slot) { return slot.removed; });
+            }
+            m_has_removed = false;
+        }
+        for (auto &pending : m_pending) {
+            m_routes[pending.route].push_back(std::move(pending.slot));
+        }
+        m_pending.clear();
+    }
+
+    std::array<std::vector<Slot>, std::variant_size_v<NmeaMessage>> m_routes;
+    /// Subscriptions made while dispatching
+    std::vector<Pending> m_pending;
+    SubscriptionId m_next_id = 0;
+    uint32_t m_dispatching = 0;
+    bool m_has_removed = false;
+};
+
+} // namespace nmea
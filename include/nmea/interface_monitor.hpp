@@ -0,0 +1,138 @@
+#pragma once
+
+#include "nmea/connection.hpp"
+#include "nmea/transport.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nmea {
+
+/// Watches the link state of a CAN interface through rtnetlink link events, so that listeners and
+/// devices can rebind their sockets when the interface comes back, eg. after a USB adapter was
+/// reset or unplugged. See `Listener::set_interface_monitor()` and
+/// `Device::set_interface_monitor()`.
+///
+/// The events are read by a thread of the monitor, which sleeps until the kernel sends one
+class InterfaceMonitor {
+public:
+    class Watch;
+
+    /// Link state of a transport, as seen by `Watch::update()`
+    enum class LinkState {
+        /// The transport is connected to the interface as it is now
+        Up,
+        /// The transport was just reconnected, after its interface came back
+        Reconnected,
+        /// The interface went down and did not come back yet
+        Down,
+    };
+
+    /// Watch `interface`, which does not need to exist yet. Sockets are opened on it again with
+    /// `options`, which should be those of the sockets being watched
+    static std::expected<std::unique_ptr<InterfaceMonitor>, std::string>
+    create(std::string interface, ConnectOptions options = {});
+
+    virtual ~InterfaceMonitor();
+
+    InterfaceMonitor(const InterfaceMonitor &other) = delete;
+    InterfaceMonitor &operator=(const InterfaceMonitor &other) = delete;
+    InterfaceMonitor(InterfaceMonitor &&other) noexcept = delete;
+    InterfaceMonitor &operator=(InterfaceMonitor &&other) noexcept = delete;
+
+    const std::string &interface() const { return m_interface; }
+
+    /// Whether the interface exists and is up and running
+    bool up() const;
+
+    /// Number of times the interface went down or was removed, or link events were lost. Sockets
+    /// opened in an earlier generation may no longer receive anything
+    uint64_t generation() const;
+
+    /// Block until the interface is up
+    void wait_up() const;
+    /// Block until the interface is up, or `timeout` passed. Returns false on timeout
+    bool wait_up(std::chrono::milliseconds timeout) const;
+
+    /// Open a new socket on the interface, with the options of the monitor
+    virtual std::expected<connection_t, std::string> connect() const;
+
+    /// Watch `transport`, which must have a socket on the interface and outlive the watch
+    std::expected<std::unique_ptr<Watch>, std::string> watch(Transport &transport);
+
+protected:
+    /// Monitor that does not read link events itself. They are passed to `set_state()` instead,
+    /// eg. from another source of link events
+    InterfaceMonitor(std::string interface, ConnectOptions options);
+
+    /// Record the link state. `removed` if the interface was deleted, which ends the generation of
+    /// its sockets even if it was already down
+    void set_state(bool up, bool removed = false);
+
+private:
+    InterfaceMonitor(int netlink_fd, int wake_fd, std::string interface, ConnectOptions options);
+
+    void run();
+    void read_events();
+    void wake();
+
+    int m_netlink_fd = -1;
+    int m_wake_fd = -1;
+    std::string m_interface;
+    ConnectOptions m_options;
+
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    bool m_up = false;
+    uint64_t m_generation = 0;
+    // Event file descriptors of the watches, signalled on every change of the link state
+    std::vector<int> m_watch_fds;
+
+    std::atomic<bool> m_stopping = false;
+    std::thread m_thread;
+};
+
+/// Transport watched by an `InterfaceMonitor`. Its file descriptor becomes readable when the
+/// transport has a frame to read and also whenever the link state changes, so that a reader
+/// waiting on it is always woken when the interface goes away, even though the socket itself is
+/// never readable again. The reader then calls `update()`, which reconnects the transport once the
+/// interface is back. The socket is not watched while the interface is down
+class InterfaceMonitor::Watch {
+public:
+    ~Watch();
+
+    Watch(const Watch &other) = delete;
+    Watch &operator=(const Watch &other) = delete;
+    Watch(Watch &&other) noexcept = delete;
+    Watch &operator=(Watch &&other) noexcept = delete;
+
+    /// File descriptor to poll for readability, or to await with `readable()`
+    int fd() const { return m_epoll_fd; }
+
+    /// Clear the notification of a link change and reconnect the transport if its interface went
+    /// down since it was connected and is back up. Never blocks
+    std::expected<LinkState, std::string> update();
+
+private:
+    friend class InterfaceMonitor;
+    Watch(InterfaceMonitor &monitor, Transport &transport, int event_fd, int epoll_fd);
+
+    std::expected<void, std::string> reconnect();
+
+    InterfaceMonitor &m_monitor;
+    Transport &m_transport;
+    int m_event_fd;
+    int m_epoll_fd;
+    // Generation of the interface the socket was opened in
+    uint64_t m_generation;
+    bool m_socket_watched = true;
+};
+
+} // namespace nmea
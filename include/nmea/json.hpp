@@ -0,0 +1,59 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace nmea {
+
+enum class JsonFormat {
+    /// Signal K delta messages, with one update per message
+    SIGNALK_DELTA,
+    /// One JSON object per line with the PGN, source address and every field of the message
+    JSON_LINES,
+};
+
+struct JsonEncoderConfig {
+    JsonFormat format = JsonFormat::SIGNALK_DELTA;
+    /// Signal K context the deltas apply to
+    std::string context = "vessels.self";
+    /// Label of the Signal K source, usually the name of the interface
+    std::string label = "can0";
+};
+
+/// Streaming JSON encoder. Messages are written straight into a buffer that is reused between
+/// batches, without building a document first, and numbers are converted with `std::to_chars`.
+///
+/// Messages added between two calls to `finish()` form a batch: a single Signal K delta, or a
+/// block of JSON lines.
+class JsonEncoder {
+public:
+    using Clock = std::chrono::system_clock;
+
+    explicit JsonEncoder(JsonEncoderConfig config = {});
+
+    /// Add a message sent by `source` to the current batch
+    void add(const NmeaMessage &msg, uint8_t source, Clock::time_point timestamp = Clock::now());
+
+    /// Close the current batch and return its text, terminated by a newline. The view stays
+    /// valid until the next call to `add()`. Empty if no message was added
+    std::string_view finish();
+
+    /// Number of messages in the current batch
+    size_t pending() const { return m_pending; }
+
+private:
+    void begin_batch();
+    void add_signalk(const NmeaMessage &msg, uint8_t source, Clock::time_point timestamp);
+    void add_json_line(const NmeaMessage &msg, uint8_t source);
+
+    JsonEncoderConfig m_config;
+    std::string m_buffer;
+    size_t m_pending = 0;
+    bool m_finished = false;
+};
+
+} // namespace nmea
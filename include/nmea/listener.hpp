@@ -2,52 +2,153 @@
 
 #include <cstdint>
 #include <expected>
+#include <functional>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
-#include <unordered_map>
-#include <vector>
 
+#include "nmea/address_map.hpp"
+#include "nmea/async.hpp"
+#include "nmea/broadcast.hpp"
+#include "nmea/bus_load.hpp"
 #include "nmea/connection.hpp"
+#include "nmea/decoder.hpp"
+#include "nmea/interface_monitor.hpp"
 #include "nmea/message.hpp"
-
-struct can_frame;
+#include "nmea/shm_ring.hpp"
+#include "nmea/stream_server.hpp"
+#include "nmea/transport.hpp"
+#include <linux/can.h>
 
 namespace nmea {
 
-struct TpTransfer {
-    uint32_t pgn;
-    uint16_t total_size;
-    uint8_t total_packets;
-    uint8_t next_packet;
-    std::vector<uint8_t> buffer;
-};
-
 class Listener {
 public:
-    /// Create a listener that listens to the passed socketfd.
+    /// Create a listener that listens to the passed socketfd, of either `Protocol`.
     ///
     /// This object will then own the socket it is connected to and will be responsible
-    /// for closing it once done
-    explicit Listener(connection_t conn);
+    /// for closing it once done.
+    ///
+    /// Transport protocol buffers are allocated from `resource`, which must outlive the listener
+    explicit Listener(connection_t conn,
+                      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+    /// Create a listener that reads frames from any transport, eg. a `VirtualBus` node
+    explicit Listener(std::unique_ptr<Transport> transport,
+                      std::pmr::memory_resource *resource = std::pmr::get_default_resource());
     Listener() = delete;
-    ~Listener();
+    ~Listener() = default;
 
     Listener(const Listener &other) = delete;
     Listener &operator=(const Listener &other) = delete;
-    Listener(Listener &&other) noexcept;
-    Listener &operator=(Listener &&other) noexcept;
+    Listener(Listener &&other) noexcept = default;
+    Listener &operator=(Listener &&other) noexcept = default;
 
     std::expected<NmeaMessage, std::string> read();
 
-    int sockfd() const { return m_conn; }
+    /// Awaitable `read()`: `co_await listener.next()` suspends the coroutine until the next
+    /// message is complete instead of blocking the thread
+    Task<std::expected<NmeaMessage, std::string>> next();
+
+    /// Await the next message of type `T`. Messages of other types and frames that fail to decode
+    /// are skipped, only transport errors are returned
+    template <typename T> Task<std::expected<T, std::string>> next() {
+        while (true) {
+            if (auto ready = co_await frame_ready(); !ready) {
+                co_return std::unexpected(ready.error());
+            }
+            auto result = read_next();
+            if (!result) {
+                co_return std::unexpected(result.error());
+            }
+            if (*result && **result) {
+                if (auto *message = std::get_if<T>(&***result)) {
+                    co_return std::move(*message);
+                }
+            }
+        }
+    }
+
+    /// Pollable file descriptor of the transport, or -1 if it does not have one
+    int sockfd() const { return m_transport ? m_transport->fd() : -1; }
+
+    /// Source address of the message most recently returned by `read()`
+    uint8_t last_source() const { return m_last_source; }
+
+    /// Account every frame read from the bus, including transport protocol packets, in
+    /// `bus_load`. The analyzer is not owned and must outlive the listener. Pass nullptr to stop
+    void set_bus_load(BusLoad *bus_load) { m_bus_load = bus_load; }
+
+    /// Record the address claims read from the bus in `address_map`, eg. `Device::address_map()`
+    /// of a device on the same bus. The map is not owned and must outlive the listener
+    void set_address_map(AddressMap *address_map) { m_address_map = address_map; }
+
+    /// Publish every frame read from the bus, with the message it completed, to `ring` so that
+    /// other processes do not need to read and decode the bus themselves. The ring is not owned
+    /// and must outlive the listener. Pass nullptr to stop
+    void set_shm_ring(ShmRingWriter *ring) { m_shm_ring = ring; }
+
+    /// Publish every frame read from the bus, with the message it completed, to `ring` so that
+    /// other consumers in the process do not need a socket and a decoder of their own. The ring
+    /// is not owned and must outlive the listener. Pass nullptr to stop
+    void set_broadcast(BroadcastRing *ring) { m_broadcast = ring; }
+
+    /// Serve every frame read from the bus, with the message it completed, to the clients of
+    /// `server`. The server is not owned and must outlive the listener. Pass nullptr to stop
+    void set_stream_server(StreamServer *server) { m_stream_server = server; }
+
+    /// Reconnect when the interface comes back after `monitor` saw it go down, eg. after a USB
+    /// adapter was reset: reads wait on the socket and on the changes of the link state together,
+    /// so instead of returning the errors of the dead socket, or blocking on it forever, `read()`
+    /// waits until the interface is up and carries on with a new socket. `next()` suspends
+    /// meanwhile instead of blocking the executor. An error read before the monitor saw the
+    /// interface go down is still returned, the next read then waits for it to come back. The
+    /// filter of a `CAN_RAW` socket is carried over to the new one, but the kernel does not report
+    /// that of a `CAN_J1939` socket, which is lost: apply it again once `generation()` of the
+    /// monitor changed.
+    /// The transport must have a socket. The monitor is not owned and must outlive the listener.
+    /// Pass nullptr to stop
+    std::expected<void, std::string> set_interface_monitor(InterfaceMonitor *monitor);
+
+    /// Pass the messages of PGNs that are not supported to `handler`, including those reassembled
+    /// from transport protocol transfers, instead of returning them from `read()` as errors. No
+    /// error string is formatted for them. Pass an empty function to stop
+    void set_unknown_handler(std::function<void(const UnknownMessage &)> handler) {
+        m_unknown_handler = std::move(handler);
+    }
 
 private:
-    void handle_tp_bam(uint8_t source, const can_frame &frame);
-    std::optional<std::expected<NmeaMessage, std::string>> handle_tp_dt(uint8_t source,
-                                                                        const can_frame &frame);
+    /// A decoded message or decoding error, nullopt while a transfer is incomplete
+    using Decoded = std::optional<std::expected<NmeaMessage, std::string>>;
+
+    /// Read and decode a frame, or a whole packet if the transport reassembles them. Only
+    /// transport errors are returned as errors
+    std::expected<Decoded, std::string> read_next();
+    /// Account and decode what was read from the bus
+    Decoded process(const can_frame &frame);
+    Decoded process(const Packet &packet);
+    /// Parse a payload, or pass it to the unknown handler
+    Decoded decode(const UnknownMessage &payload);
+    void publish(const can_frame &frame, const Decoded &result);
+    /// Wait until a frame can be read, reconnecting the transport if its interface went down
+    std::expected<void, std::string> wait_frame();
+    /// Awaitable `wait_frame()`
+    Task<std::expected<void, std::string>> frame_ready();
+    /// Whether the interface went down or was reconnected since the last read
+    bool link_lost();
 
-    connection_t m_conn;
-    std::unordered_map<uint8_t, TpTransfer> m_tp_transfers;
+    std::unique_ptr<Transport> m_transport;
+    uint8_t m_last_source = 0;
+    BusLoad *m_bus_load = nullptr;
+    AddressMap *m_address_map = nullptr;
+    ShmRingWriter *m_shm_ring = nullptr;
+    BroadcastRing *m_broadcast = nullptr;
+    StreamServer *m_stream_server = nullptr;
+    std::unique_ptr<InterfaceMonitor::Watch> m_watch;
+    std::function<void(const UnknownMessage &)> m_unknown_handler;
+    Decoder m_decoder;
+    Packet m_packet{};
 };
 
 } // namespace nmea
@@ -1,11 +1,18 @@
 #pragma once
 
 #include "nmea/definitions.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <expected>
 #include <format>
+#include <memory>
+#include <memory_resource>
 #include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -26,215 +33,393 @@ constexpr uint32_t ENVIRONMENTAL_PARAMETERS = 130311;
 constexpr uint32_t ACTUAL_PRESSURE = 130314;
 } // namespace pgn
 
+/// Numeric policies for the scaled fields of the messages. Values are sent on the wire as
+/// integers in units of a fixed resolution, eg. 0.0001 radians
+namespace policy {
+/// Keep the integer from the wire. Multiply it by the resolution of the field to get the value
+struct Raw {};
+/// Scaled value in single precision
+struct Float {};
+/// Scaled value in double precision. This is what `NmeaMessage` uses
+struct Double {};
+
+template <typename Policy, typename Wire> struct field;
+template <typename Wire> struct field<Raw, Wire> {
+    using type = Wire;
+};
+template <typename Wire> struct field<Float, Wire> {
+    using type = float;
+};
+template <typename Wire> struct field<Double, Wire> {
+    using type = double;
+};
+
+/// Type of a field that is sent on the wire as `Wire`
+template <typename Policy, typename Wire> using field_t = typename field<Policy, Wire>::type;
+} // namespace policy
+
 namespace message {
 /// PGN 129026 - COG & SOG, Rapid Update
-struct CogSog {
+template <typename Policy> struct BasicCogSog {
     static constexpr uint8_t priority = 2;
+    static constexpr uint32_t pgn = nmea::pgn::COG_SOG;
     uint8_t sid;
-    uint8_t cog_reference; // 0 = true, 1 = magnetic
-    double cog;            // radians
-    double sog;            // m/s
+    uint8_t cog_reference;                     // 0 = true, 1 = magnetic
+    policy::field_t<Policy, uint16_t> cog;     // radians, resolution 1e-4
+    policy::field_t<Policy, uint16_t> sog;     // m/s, resolution 0.01
 };
 
 /// PGN 130312 - Temperature
-struct Temperature {
+template <typename Policy> struct BasicTemperature {
     static constexpr uint8_t priority = 6;
+    static constexpr uint32_t pgn = nmea::pgn::TEMPERATURE;
     uint8_t sid;
     uint8_t instance;
     uint8_t source;
-    double actual_temperature; // K
-    double set_temperature;    // K
+    policy::field_t<Policy, uint16_t> actual_temperature; // K, resolution 0.01
+    policy::field_t<Policy, uint16_t> set_temperature;    // K, resolution 0.01
 };
 
 /// PGN 130578 - Vessel Speed Components
-struct VesselSpeedComponents {
+template <typename Policy> struct BasicVesselSpeedComponents {
     static constexpr uint8_t priority = 2;
+    static constexpr uint32_t pgn = nmea::pgn::VESSEL_SPEED;
 
     struct Ref {
-        double water;
-        double ground;
+        policy::field_t<Policy, int16_t> water;
+        policy::field_t<Policy, int16_t> ground;
     };
 
-    Ref longitudinal; // m/s
-    Ref transverse;   // m/s
-    Ref stern;        // m/s
+    Ref longitudinal; // m/s, resolution 0.001
+    Ref transverse;   // m/s, resolution 0.001
+    Ref stern;        // m/s, resolution 0.001
 };
 
 // PGN 127257 - Attitude
-struct Attitude {
+template <typename Policy> struct BasicAttitude {
     static constexpr uint8_t priority = 3;
+    static constexpr uint32_t pgn = nmea::pgn::ATTITUDE;
     uint8_t sid;
-    double yaw;   // radians
-    double pitch; // radians
-    double roll;  // radians
+    policy::field_t<Policy, int16_t> yaw;   // radians, resolution 1e-4
+    policy::field_t<Policy, int16_t> pitch; // radians, resolution 1e-4
+    policy::field_t<Policy, int16_t> roll;  // radians, resolution 1e-4
 };
 
 // PGN 127250 - Vessel Heading
-struct VesselHeading {
+template <typename Policy> struct BasicVesselHeading {
     static constexpr uint8_t priority = 2;
+    static constexpr uint32_t pgn = nmea::pgn::VESSEL_HEADING;
     uint8_t sid;
-    double heading;   // radians
-    double deviation; // radians
-    double variation; // radians
+    policy::field_t<Policy, uint16_t> heading;  // radians, resolution 1e-4
+    policy::field_t<Policy, int16_t> deviation; // radians, resolution 1e-4
+    policy::field_t<Policy, int16_t> variation; // radians, resolution 1e-4
     DirectionReference reference;
 };
 
 // PGN 127251 - Rate of Turn
-struct RateOfTurn {
+template <typename Policy> struct BasicRateOfTurn {
     static constexpr uint8_t priority = 2;
+    static constexpr uint32_t pgn = nmea::pgn::RATE_OF_TURN;
     uint8_t sid;
-    double rate; // radians
+    policy::field_t<Policy, uint32_t> rate; // radians, resolution 3.125e-8
 };
 
 // PGN 127252 - Heave
-struct Heave {
+template <typename Policy> struct BasicHeave {
     static constexpr uint8_t priority = 3;
+    static constexpr uint32_t pgn = nmea::pgn::HEAVE;
     uint8_t sid;
-    double heave; // m
+    policy::field_t<Policy, uint16_t> heave; // m, resolution 0.01
 };
 
 // PGN 129025 - Position, Rapid Update
-struct Position {
+template <typename Policy> struct BasicPosition {
     static constexpr uint8_t priority = 2;
-    double latitude;  // degrees
-    double longitude; // degrees
+    static constexpr uint32_t pgn = nmea::pgn::POSITION;
+    policy::field_t<Policy, int32_t> latitude;  // degrees, resolution 1e-7
+    policy::field_t<Policy, int32_t> longitude; // degrees, resolution 1e-7
 };
 
 // PGN 130311 - Environmental Parameters
-struct EnvironmentalParameters {
+template <typename Policy> struct BasicEnvironmentalParameters {
     static constexpr uint8_t priority = 5;
+    static constexpr uint32_t pgn = nmea::pgn::ENVIRONMENTAL_PARAMETERS;
     uint8_t sid;
     uint8_t temperature_source;
     uint8_t humidity_source;
-    double temperature;            // K
-    double humidity;               // %
-    uint16_t atmospheric_pressure; // Pa
+    policy::field_t<Policy, uint16_t> temperature; // K, resolution 0.01
+    policy::field_t<Policy, int16_t> humidity;     // %, resolution 0.004
+    uint16_t atmospheric_pressure;                 // Pa
 };
 
 // PGN130314 - Actual Pressure
-struct ActualPressure {
+template <typename Policy> struct BasicActualPressure {
     static constexpr uint8_t priority = 5;
+    static constexpr uint32_t pgn = nmea::pgn::ACTUAL_PRESSURE;
     uint8_t sid;
     uint8_t instance;
     uint8_t source;
-    double pressure; // Pa
+    policy::field_t<Policy, int32_t> pressure; // Pa, resolution 0.1
 };
 
+using CogSog = BasicCogSog<policy::Double>;
+using Temperature = BasicTemperature<policy::Double>;
+using VesselSpeedComponents = BasicVesselSpeedComponents<policy::Double>;
+using Attitude = BasicAttitude<policy::Double>;
+using VesselHeading = BasicVesselHeading<policy::Double>;
+using RateOfTurn = BasicRateOfTurn<policy::Double>;
+using Heave = BasicHeave<policy::Double>;
+using Position = BasicPosition<policy::Double>;
+using EnvironmentalParameters = BasicEnvironmentalParameters<policy::Double>;
+using ActualPressure = BasicActualPressure<policy::Double>;
+
 template <typename T> constexpr uint8_t default_priority(const T &) { return T::priority; }
+template <typename T> constexpr uint32_t pgn_of(const T &) { return T::pgn; }
 
 } // namespace message
 
-using NmeaMessage =
-    std::variant<message::CogSog, message::Temperature, message::VesselSpeedComponents,
-                 message::Attitude, message::VesselHeading, message::RateOfTurn, message::Heave,
-                 message::Position, message::EnvironmentalParameters, message::ActualPressure>;
+template <typename Policy>
+using BasicNmeaMessage =
+    std::variant<message::BasicCogSog<Policy>, message::BasicTemperature<Policy>,
+                 message::BasicVesselSpeedComponents<Policy>, message::BasicAttitude<Policy>,
+                 message::BasicVesselHeading<Policy>, message::BasicRateOfTurn<Policy>,
+                 message::BasicHeave<Policy>, message::BasicPosition<Policy>,
+                 message::BasicEnvironmentalParameters<Policy>,
+                 message::BasicActualPressure<Policy>>;
+
+using NmeaMessage = BasicNmeaMessage<policy::Double>;
+
+/// Messages that keep the integers from the wire, for buffers holding many messages. Under a
+/// third of the size of `NmeaMessage`
+using CompactNmeaMessage = BasicNmeaMessage<policy::Raw>;
+
+namespace internal {
+template <typename Message> struct supported_pgns;
+template <typename... Messages> struct supported_pgns<std::variant<Messages...>> {
+    static constexpr std::array<uint32_t, sizeof...(Messages)> value{Messages::pgn...};
+};
+} // namespace internal
+
+/// Whether `parse()` decodes messages of `pgn`
+constexpr bool is_supported(uint32_t pgn) {
+    return std::ranges::find(internal::supported_pgns<NmeaMessage>::value, pgn) !=
+           internal::supported_pgns<NmeaMessage>::value.end();
+}
+
+/// Message of a PGN that is not decoded, with a view of its payload, eg. for logging or
+/// forwarding every message on the bus. The view is only valid until the next frame is read
+struct UnknownMessage {
+    /// Without the destination address of PDU1 PGNs
+    uint32_t pgn;
+    uint8_t priority;
+    uint8_t source;
+    /// Destination address of PDU1 PGNs, 0xFF for broadcasts
+    uint8_t destination;
+    std::span<const uint8_t> data;
+};
 
-struct SerializedMessage {
+/// Payload of a message as it goes on the wire. The allocator of the payload can be chosen, eg.
+/// to serialize into an arena with `pmr::SerializedMessage`
+template <typename Allocator = std::allocator<uint8_t>> struct BasicSerializedMessage {
     uint32_t pgn;
-    std::vector<uint8_t> data;
+    std::vector<uint8_t, Allocator> data;
 };
 
-std::expected<NmeaMessage, std::string> parse(uint32_t id, std::span<const uint8_t> data);
-SerializedMessage serialize(const NmeaMessage &msg);
+using SerializedMessage = BasicSerializedMessage<>;
+
+namespace pmr {
+using SerializedMessage = BasicSerializedMessage<std::pmr::polymorphic_allocator<uint8_t>>;
+} // namespace pmr
+
+/// Parse a frame payload. The numeric policy of the fields can be selected, eg.
+/// `parse<policy::Raw>(id, data)` for a `CompactNmeaMessage`
+template <typename Policy = policy::Double>
+std::expected<BasicNmeaMessage<Policy>, std::string> parse(uint32_t id,
+                                                           std::span<const uint8_t> data);
+
+/// Serialize a message, allocating the payload with `allocator`. Supports `std::allocator` and
+/// `std::pmr::polymorphic_allocator<uint8_t>`, so that the payload can come from an arena, eg. a
+/// `std::pmr::monotonic_buffer_resource` that is reset once the message has been sent
+template <typename Policy, typename Allocator = std::allocator<uint8_t>>
+BasicSerializedMessage<Allocator> serialize(const BasicNmeaMessage<Policy> &msg,
+                                            const Allocator &allocator = Allocator());
+
+// Also take single messages, eg. `serialize(message::Heave{...})`, which do not deduce the policy
+template <typename Allocator = std::allocator<uint8_t>>
+BasicSerializedMessage<Allocator> serialize(const NmeaMessage &msg,
+                                            const Allocator &allocator = Allocator()) {
+    return serialize<policy::Double>(msg, allocator);
+}
+template <typename Allocator = std::allocator<uint8_t>>
+BasicSerializedMessage<Allocator> serialize(const CompactNmeaMessage &msg,
+                                            const Allocator &allocator = Allocator()) {
+    return serialize<policy::Raw>(msg, allocator);
+}
+
+/// Convert a message to another numeric policy. Values are rounded to the resolution of the wire
+template <typename To, typename From>
+BasicNmeaMessage<To> convert(const BasicNmeaMessage<From> &msg) {
+    if constexpr (std::is_same_v<To, From>) {
+        return msg;
+    } else {
+        // Payloads are a few bytes, so they are serialized on the stack
+        std::array<std::byte, 64> storage;
+        std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size());
+        auto serialized = serialize<From>(msg, std::pmr::polymorphic_allocator<uint8_t>(&arena));
+        // Serialized payloads always have the full length, so parsing them cannot fail
+        return *parse<To>(serialized.pgn << 8, serialized.data);
+    }
+}
+
+/// Convert a single message type to another numeric policy, eg.
+/// `convert<policy::Double>(message::BasicAttitude<policy::Raw>{...})`
+template <typename To, template <typename> typename Message, typename From>
+Message<To> convert(const Message<From> &msg) {
+    return std::get<Message<To>>(convert<To, From>(BasicNmeaMessage<From>(msg)));
+}
 } // namespace nmea
 
-template <> struct std::formatter<nmea::message::CogSog> : std::formatter<std::string> {
-    auto format(const nmea::message::CogSog &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("COGSOG(SID={}, Reference={}, COG={} radians, SOG={} m/s)", m.sid,
-                        m.cog_reference, m.cog, m.sog),
-            ctx);
+namespace nmea::internal {
+/// Base of the message formatters. Messages are written straight to the output of the format
+/// context, and the format spec is applied to every floating point field, eg. `{:.2f}`
+class MessageFormatter {
+public:
+    constexpr auto parse(std::format_parse_context &ctx) {
+        m_has_spec = ctx.begin() != ctx.end() && *ctx.begin() != '}';
+        return m_double.parse(ctx);
+    }
+
+protected:
+    /// Write `pattern` with each `{}` replaced by the next field
+    template <typename Context, typename... Fields>
+    auto write(Context &ctx, std::string_view pattern, const Fields &...fields) const {
+        auto out = ctx.out();
+        auto next = [&](const auto &field) {
+            const auto pos = pattern.find("{}");
+            out = std::ranges::copy(pattern.substr(0, pos), out).out;
+            pattern.remove_prefix(pos + 2);
+            out = write_field(ctx, out, field);
+        };
+        (next(fields), ...);
+        return std::ranges::copy(pattern, out).out;
+    }
+
+private:
+    template <typename Context, typename Out, typename T>
+    Out write_field(Context &ctx, Out out, const T &value) const {
+        if constexpr (std::is_floating_point_v<T>) {
+            if (m_has_spec) {
+                ctx.advance_to(out);
+                return m_double.format(static_cast<double>(value), ctx);
+            }
+        }
+        return std::format_to(out, "{}", value);
+    }
+
+    std::formatter<double> m_double;
+    bool m_has_spec = false;
+};
+} // namespace nmea::internal
+
+template <typename Policy>
+struct std::formatter<nmea::message::BasicCogSog<Policy>> : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicCogSog<Policy> &m, auto &ctx) const {
+        return write(ctx, "COGSOG(SID={}, Reference={}, COG={} radians, SOG={} m/s)", m.sid,
+                     m.cog_reference, m.cog, m.sog);
     }
 };
 
-template <> struct std::formatter<nmea::message::Temperature> : std::formatter<std::string> {
-    auto format(const nmea::message::Temperature &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("Temperature(SID={}, Instance={}, Source={} Actual Temperature={} K, Set "
-                        "Temperature={} K)",
-                        m.sid, m.instance, m.source, m.actual_temperature, m.set_temperature),
-            ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicTemperature<Policy>> : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicTemperature<Policy> &m, auto &ctx) const {
+        return write(ctx,
+                     "Temperature(SID={}, Instance={}, Source={} Actual Temperature={} K, Set "
+                     "Temperature={} K)",
+                     m.sid, m.instance, m.source, m.actual_temperature, m.set_temperature);
     }
 };
 
-template <>
-struct std::formatter<nmea::message::VesselSpeedComponents> : std::formatter<std::string> {
-    auto format(const nmea::message::VesselSpeedComponents &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("VesselSpeed(Longitudinal=(Ground: {}, Water: {}), Transverse=(Ground: {}, "
-                        "Water: {}), Stern=(Ground: {}, Water: {}))",
-                        m.longitudinal.ground, m.longitudinal.water, m.transverse.ground,
-                        m.transverse.water, m.stern.ground, m.stern.water),
-            ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicVesselSpeedComponents<Policy>>
+    : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicVesselSpeedComponents<Policy> &m, auto &ctx) const {
+        return write(ctx,
+                     "VesselSpeed(Longitudinal=(Ground: {}, Water: {}), Transverse=(Ground: {}, "
+                     "Water: {}), Stern=(Ground: {}, Water: {}))",
+                     m.longitudinal.ground, m.longitudinal.water, m.transverse.ground,
+                     m.transverse.water, m.stern.ground, m.stern.water);
     }
 };
 
-template <> struct std::formatter<nmea::message::Attitude> : std::formatter<std::string> {
-    auto format(const nmea::message::Attitude &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("Attitude(SID={}, Yaw={}, Pitch={}, Roll={})", m.sid, m.yaw, m.pitch,
-                        m.roll),
-            ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicAttitude<Policy>> : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicAttitude<Policy> &m, auto &ctx) const {
+        return write(ctx, "Attitude(SID={}, Yaw={}, Pitch={}, Roll={})", m.sid, m.yaw, m.pitch,
+                     m.roll);
     }
 };
 
-template <> struct std::formatter<nmea::message::VesselHeading> : std::formatter<std::string> {
-    auto format(const nmea::message::VesselHeading &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format(
-                "Vessel Heading(SID={}, Heading={}, Deviation={}, Variation={}, Reference={})",
-                m.sid, m.heading, m.deviation, m.variation, std::to_underlying(m.reference)),
-            ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicVesselHeading<Policy>>
+    : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicVesselHeading<Policy> &m, auto &ctx) const {
+        return write(ctx,
+                     "Vessel Heading(SID={}, Heading={}, Deviation={}, Variation={}, Reference={})",
+                     m.sid, m.heading, m.deviation, m.variation, std::to_underlying(m.reference));
     }
 };
 
-template <> struct std::formatter<nmea::message::RateOfTurn> : std::formatter<std::string> {
-    auto format(const nmea::message::RateOfTurn &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("Rate of Turn(SID={}, Rate={})", m.sid, m.rate), ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicRateOfTurn<Policy>> : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicRateOfTurn<Policy> &m, auto &ctx) const {
+        return write(ctx, "Rate of Turn(SID={}, Rate={})", m.sid, m.rate);
     }
 };
 
-template <> struct std::formatter<nmea::message::Heave> : std::formatter<std::string> {
-    auto format(const nmea::message::Heave &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("Heave(SID={}, Heave={})", m.sid, m.heave), ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicHeave<Policy>> : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicHeave<Policy> &m, auto &ctx) const {
+        return write(ctx, "Heave(SID={}, Heave={})", m.sid, m.heave);
     }
 };
 
-template <> struct std::formatter<nmea::message::Position> : std::formatter<std::string> {
-    auto format(const nmea::message::Position &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("Position(Latitude={}, Longitude={})", m.latitude, m.longitude), ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicPosition<Policy>> : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicPosition<Policy> &m, auto &ctx) const {
+        return write(ctx, "Position(Latitude={}, Longitude={})", m.latitude, m.longitude);
     }
 };
 
-template <>
-struct std::formatter<nmea::message::EnvironmentalParameters> : std::formatter<std::string> {
-    auto format(const nmea::message::EnvironmentalParameters &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("Environmental Parameters(SID={}, Temperature Source={}, Humidity "
-                        "Source={}, Temperature={}, Humidity={}, Atmospheric Pressure={})",
-                        m.sid, m.temperature_source, m.humidity_source, m.temperature, m.humidity,
-                        m.atmospheric_pressure),
-            ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicEnvironmentalParameters<Policy>>
+    : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicEnvironmentalParameters<Policy> &m, auto &ctx) const {
+        return write(ctx,
+                     "Environmental Parameters(SID={}, Temperature Source={}, Humidity "
+                     "Source={}, Temperature={}, Humidity={}, Atmospheric Pressure={})",
+                     m.sid, m.temperature_source, m.humidity_source, m.temperature, m.humidity,
+                     m.atmospheric_pressure);
     }
 };
 
-template <> struct std::formatter<nmea::message::ActualPressure> : std::formatter<std::string> {
-    auto format(const nmea::message::ActualPressure &m, auto &ctx) const {
-        return std::formatter<std::string>::format(
-            std::format("ActualPressure(SID={}, Instance={}, Source={}, Pressure={})", m.sid,
-                        m.instance, m.source, m.pressure),
-            ctx);
+template <typename Policy>
+struct std::formatter<nmea::message::BasicActualPressure<Policy>>
+    : nmea::internal::MessageFormatter {
+    auto format(const nmea::message::BasicActualPressure<Policy> &m, auto &ctx) const {
+        return write(ctx, "ActualPressure(SID={}, Instance={}, Source={}, Pressure={})", m.sid,
+                     m.instance, m.source, m.pressure);
     }
 };
 
-template <> struct std::formatter<nmea::NmeaMessage> : std::formatter<std::string> {
-    auto format(const nmea::NmeaMessage &msg, auto &ctx) const {
+template <typename Policy>
+struct std::formatter<nmea::BasicNmeaMessage<Policy>> : nmea::internal::MessageFormatter {
+    auto format(const nmea::BasicNmeaMessage<Policy> &msg, auto &ctx) const {
         return std::visit(
-            [&](const auto &m) {
-                return std::formatter<std::string>::format(std::format("{}", m), ctx);
+            [&]<typename Message>(const Message &m) {
+                // The alternative formatter takes over the spec that was parsed for the variant
+                std::formatter<Message> alternative;
+                static_cast<nmea::internal::MessageFormatter &>(alternative) = *this;
+                return alternative.format(m, ctx);
             },
             msg);
     }
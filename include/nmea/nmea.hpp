@@ -1,6 +1,24 @@
 #pragma once
 
-#include "nmea/connection.hpp" // IWYU pragma: keep
-#include "nmea/listener.hpp"   // IWYU pragma: keep
-#include "nmea/message.hpp"    // IWYU pragma: keep
-#include "nmea/visit.hpp"      // IWYU pragma: keep
+#include "nmea/address_map.hpp"       // IWYU pragma: keep
+#include "nmea/async.hpp"             // IWYU pragma: keep
+#include "nmea/batch.hpp"             // IWYU pragma: keep
+#include "nmea/broadcast.hpp"         // IWYU pragma: keep
+#include "nmea/bus_load.hpp"          // IWYU pragma: keep
+#include "nmea/connection.hpp"        // IWYU pragma: keep
+#include "nmea/decoder.hpp"           // IWYU pragma: keep
+#include "nmea/dispatcher.hpp"        // IWYU pragma: keep
+#include "nmea/interface_monitor.hpp" // IWYU pragma: keep
+#include "nmea/json.hpp"              // IWYU pragma: keep
+#include "nmea/listener.hpp"          // IWYU pragma: keep
+#include "nmea/message.hpp"           // IWYU pragma: keep
+#include "nmea/nmea0183.hpp"          // IWYU pragma: keep
+#include "nmea/pipeline.hpp"          // IWYU pragma: keep
+#include "nmea/publisher.hpp"         // IWYU pragma: keep
+#include "nmea/shm_ring.hpp"          // IWYU pragma: keep
+#include "nmea/stream_server.hpp"     // IWYU pragma: keep
+#include "nmea/text_logger.hpp"       // IWYU pragma: keep
+#include "nmea/thread.hpp"            // IWYU pragma: keep
+#include "nmea/transport.hpp"         // IWYU pragma: keep
+#include "nmea/virtual_bus.hpp"       // IWYU pragma: keep
+#include "nmea/visit.hpp"             // IWYU pragma: keep
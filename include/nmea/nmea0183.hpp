@@ -0,0 +1,96 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+#include <variant>
+
+namespace nmea {
+
+/// Conversion of decoded messages to NMEA 0183 sentences for legacy consumers. Sentences are
+/// built in fixed size buffers, so the conversion never allocates.
+namespace nmea0183 {
+
+/// Longest sentence allowed by NMEA 0183, from the `$` to the `\r\n`
+constexpr size_t MAX_SENTENCE_LENGTH = 82;
+
+enum class SentenceType {
+    HDG, // Heading, deviation and variation, from Vessel Heading with a magnetic reference
+    HDT, // True heading, from Vessel Heading
+    VTG, // Course and speed over ground, from COG & SOG
+    ROT, // Rate of turn
+    MTW, // Water temperature, from Temperature and Environmental Parameters
+    XDR, // Transducer measurements: other temperatures, humidity, pressure, attitude and heave
+    GLL, // Position
+    VHW, // Speed through water, from Vessel Speed Components
+};
+
+constexpr size_t SENTENCE_TYPES = 8;
+
+class Sentence {
+public:
+    /// Full sentence, including the checksum and the trailing `\r\n`
+    std::string_view view() const { return {m_data.data(), m_size}; }
+    SentenceType type() const { return m_type; }
+
+private:
+    friend class SentenceBuilder;
+
+    std::array<char, MAX_SENTENCE_LENGTH> m_data;
+    size_t m_size = 0;
+    SentenceType m_type = SentenceType::HDG;
+};
+
+/// Sentences generated from a single message
+class Sentences {
+public:
+    static constexpr size_t CAPACITY = 2;
+
+    const Sentence *begin() const { return m_sentences.data(); }
+    const Sentence *end() const { return m_sentences.data() + m_size; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const Sentence &operator[](size_t i) const { return m_sentences[i]; }
+
+private:
+    friend class Gateway;
+
+    std::array<Sentence, CAPACITY> m_sentences;
+    size_t m_size = 0;
+};
+
+struct GatewayConfig {
+    /// Talker identifier at the start of every sentence
+    std::array<char, 2> talker = {'I', 'I'};
+    /// Minimum interval between two sentences of the same type, indexed by `SentenceType`. A
+    /// zero interval sends a sentence for every message
+    std::array<std::chrono::milliseconds, SENTENCE_TYPES> intervals{};
+};
+
+/// Maps decoded messages to NMEA 0183 sentences, dropping the ones that would exceed the output
+/// rate configured for their sentence type. Rates are tracked per sentence type and message
+/// type, so eg. XDR sentences with temperatures do not hold back the ones with the attitude.
+class Gateway {
+public:
+    using Clock = std::chrono::system_clock;
+
+    explicit Gateway(GatewayConfig config = {});
+
+    /// Change the minimum interval between two sentences of `type`
+    void set_interval(SentenceType type, std::chrono::milliseconds interval);
+
+    /// Sentences for `msg`. The time is used for rate limiting, and as the UTC time of GLL
+    Sentences convert(const NmeaMessage &msg, Clock::time_point now = Clock::now());
+
+private:
+    bool due(SentenceType type, size_t message_index, Clock::time_point now);
+
+    GatewayConfig m_config;
+    std::array<std::array<Clock::time_point, std::variant_size_v<NmeaMessage>>, SENTENCE_TYPES>
+        m_last_sent{};
+};
+
+} // namespace nmea0183
+} // namespace nmea
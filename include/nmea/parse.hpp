@@ -0,0 +1,226 @@
+#pragma once
+
+#include "nmea/definitions.hpp"
+#include "nmea/message.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <span>
+#include <string>
+#include <type_traits>
+
+namespace nmea {
+// Wire layouts of the messages. Only `parse_as()` is meant to be used, anything in `internal` may
+// change between releases. Included by `nmea/basic_listener.hpp`, but not by `nmea/nmea.hpp`
+namespace internal {
+inline uint16_t read_u16(std::span<const uint8_t> data, size_t idx) {
+    return static_cast<uint16_t>(data[idx] | (data[idx + 1] << 8));
+}
+
+inline uint32_t read_u32(std::span<const uint8_t> data, size_t idx) {
+    return static_cast<uint32_t>(data[idx] | (data[idx + 1] << 8) | (data[idx + 2] << 16) |
+                                 (data[idx + 3] << 24));
+}
+
+inline int16_t read_i16(std::span<const uint8_t> data, size_t idx) {
+    return static_cast<int16_t>(data[idx] | (data[idx + 1] << 8));
+}
+
+inline int32_t read_i32(std::span<const uint8_t> data, size_t idx) {
+    return static_cast<int32_t>(data[idx] | (data[idx + 1] << 8) | (data[idx + 2] << 16) |
+                                (data[idx + 3] << 24));
+}
+
+// Store a wire value as a field of the numeric policy. Raw fields keep the integer as it is
+template <typename P, typename Wire>
+policy::field_t<P, Wire> scale(Wire raw, double resolution) {
+    if constexpr (std::is_same_v<P, policy::Raw>) {
+        return raw;
+    } else {
+        return static_cast<policy::field_t<P, Wire>>(raw * resolution);
+    }
+}
+
+/// Minimum payload length and parse function of each message type. The field offsets of the parse
+/// functions are fixed, so a single length check per message is enough to keep a truncated or
+/// malformed payload from being read out of bounds
+template <typename M> struct Layout;
+
+// ============================== 129026 - COG & SOG, Rapid Update ============================== //
+template <typename P> struct Layout<message::BasicCogSog<P>> {
+    static constexpr size_t min_length = 6;
+
+    static message::BasicCogSog<P> parse(std::span<const uint8_t> data) {
+        message::BasicCogSog<P> msg{};
+
+        msg.sid = data[0];
+        msg.cog_reference = data[1] & 0x03;
+        msg.cog = scale<P>(read_u16(data, 2), 0.0001);
+        msg.sog = scale<P>(read_u16(data, 4), 0.01);
+
+        return msg;
+    }
+};
+
+// ==================================== 130312 - Temperature ==================================== //
+template <typename P> struct Layout<message::BasicTemperature<P>> {
+    static constexpr size_t min_length = 7;
+
+    static message::BasicTemperature<P> parse(std::span<const uint8_t> data) {
+        message::BasicTemperature<P> msg{};
+
+        msg.sid = data[0];
+        msg.instance = data[1];
+        msg.source = data[2];
+        msg.actual_temperature = scale<P>(read_u16(data, 3), 0.01);
+        msg.set_temperature = scale<P>(read_u16(data, 5), 0.01);
+
+        return msg;
+    }
+};
+
+// ============================== 130578 - Vessel Speed Components ============================== //
+template <typename P> struct Layout<message::BasicVesselSpeedComponents<P>> {
+    static constexpr size_t min_length = 12;
+
+    static message::BasicVesselSpeedComponents<P> parse(std::span<const uint8_t> data) {
+        message::BasicVesselSpeedComponents<P> msg{};
+
+        msg.longitudinal.water = scale<P>(read_i16(data, 0), 0.001);
+        msg.transverse.water = scale<P>(read_i16(data, 2), 0.001);
+        msg.longitudinal.ground = scale<P>(read_i16(data, 4), 0.001);
+        msg.transverse.ground = scale<P>(read_i16(data, 6), 0.001);
+        msg.stern.water = scale<P>(read_i16(data, 8), 0.001);
+        msg.stern.ground = scale<P>(read_i16(data, 10), 0.001);
+
+        return msg;
+    }
+};
+
+// ====================================== 127250 - Heading ====================================== //
+template <typename P> struct Layout<message::BasicVesselHeading<P>> {
+    static constexpr size_t min_length = 8;
+
+    static message::BasicVesselHeading<P> parse(std::span<const uint8_t> data) {
+        message::BasicVesselHeading<P> msg{};
+
+        msg.sid = data[0];
+        msg.heading = scale<P>(read_u16(data, 1), 0.0001);
+        msg.deviation = scale<P>(read_i16(data, 3), 0.0001);
+        msg.variation = scale<P>(read_i16(data, 5), 0.0001);
+        msg.reference = static_cast<DirectionReference>(data[7] & 0x3);
+
+        return msg;
+    }
+};
+
+// ==================================== 127251 - Rate of Turn =================================== //
+template <typename P> struct Layout<message::BasicRateOfTurn<P>> {
+    static constexpr size_t min_length = 5;
+
+    static message::BasicRateOfTurn<P> parse(std::span<const uint8_t> data) {
+        message::BasicRateOfTurn<P> msg{};
+
+        msg.sid = data[0];
+        msg.rate = scale<P>(read_u32(data, 1), 3.125e-08);
+
+        return msg;
+    }
+};
+
+// ======================================= 127252 - Heave ======================================= //
+template <typename P> struct Layout<message::BasicHeave<P>> {
+    static constexpr size_t min_length = 3;
+
+    static message::BasicHeave<P> parse(std::span<const uint8_t> data) {
+        message::BasicHeave<P> msg{};
+
+        msg.sid = data[0];
+        msg.heave = scale<P>(read_u16(data, 1), 0.01);
+
+        return msg;
+    }
+};
+
+// ===================================== 127257 - Attitude ====================================== //
+template <typename P> struct Layout<message::BasicAttitude<P>> {
+    static constexpr size_t min_length = 7;
+
+    static message::BasicAttitude<P> parse(std::span<const uint8_t> data) {
+        message::BasicAttitude<P> msg{};
+
+        msg.sid = data[0];
+        msg.yaw = scale<P>(read_i16(data, 1), 0.0001);
+        msg.pitch = scale<P>(read_i16(data, 3), 0.0001);
+        msg.roll = scale<P>(read_i16(data, 5), 0.0001);
+
+        return msg;
+    }
+};
+
+// ============================== 129025 - Position, Rapid Update =============================== //
+template <typename P> struct Layout<message::BasicPosition<P>> {
+    static constexpr size_t min_length = 8;
+
+    static message::BasicPosition<P> parse(std::span<const uint8_t> data) {
+        message::BasicPosition<P> msg{};
+
+        msg.latitude = scale<P>(read_i32(data, 0), 1e-07);
+        msg.longitude = scale<P>(read_i32(data, 4), 1e-07);
+
+        return msg;
+    }
+};
+
+// ============================= 130311 - Environmental Parameters ============================== //
+template <typename P> struct Layout<message::BasicEnvironmentalParameters<P>> {
+    static constexpr size_t min_length = 8;
+
+    static message::BasicEnvironmentalParameters<P> parse(std::span<const uint8_t> data) {
+        message::BasicEnvironmentalParameters<P> msg{};
+
+        msg.sid = data[0];
+        msg.temperature_source = data[1] & 0x3F;
+        msg.humidity_source = data[1] & 0xC0;
+        msg.temperature = scale<P>(read_u16(data, 2), 0.01);
+        msg.humidity = scale<P>(read_i16(data, 4), 0.004);
+        msg.atmospheric_pressure = read_u16(data, 6);
+
+        return msg;
+    }
+};
+
+// ================================== 130314 - Actual Pressure ================================== //
+template <typename P> struct Layout<message::BasicActualPressure<P>> {
+    static constexpr size_t min_length = 7;
+
+    static message::BasicActualPressure<P> parse(std::span<const uint8_t> data) {
+        message::BasicActualPressure<P> msg{};
+
+        msg.sid = data[0];
+        msg.instance = data[1];
+        msg.source = data[2];
+        msg.pressure = scale<P>(read_i32(data, 3), 0.1);
+
+        return msg;
+    }
+};
+} // namespace internal
+
+/// Parse the payload of a message of a known type, eg. `parse_as<message::Heave>(data)`, without
+/// the dispatch on the PGN of `parse()`. Any policy of any message type can be parsed.
+///
+/// Defined here rather than in the library, so that a program only contains the parsers of the
+/// message types it names
+template <typename Message>
+std::expected<Message, std::string> parse_as(std::span<const uint8_t> data) {
+    using Layout = internal::Layout<Message>;
+    if (data.size() < Layout::min_length) [[unlikely]] {
+        return std::unexpected(std::format("PGN {} payload too short: got {} bytes, expected {}",
+                                           Message::pgn, data.size(), Layout::min_length));
+    }
+    return Layout::parse(data);
+}
+
+} // namespace nmea
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include "nmea/thread.hpp"
+#include "nmea/transport.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct can_frame;
+
+namespace nmea {
+namespace internal {
+struct PipelineShard;
+} // namespace internal
+
+struct PipelineConfig {
+    /// Number of decode workers. 0 uses one per hardware thread
+    size_t workers = 0;
+    /// Maximum number of frames waiting to be decoded per worker, and of decoded messages a worker
+    /// queues until the consumer takes them over. Ingest blocks once a worker falls this far
+    /// behind
+    size_t capacity = 4096;
+    /// Scheduling of the ingest thread of a pipeline that reads from a transport
+    ThreadOptions ingest_thread = {};
+};
+
+struct DecodedMessage {
+    /// Position of the frame that completed the message in the ingested stream
+    uint64_t sequence;
+    uint8_t source;
+    std::expected<NmeaMessage, std::string> message;
+};
+
+/// Multi-core decoder. A single ingest stage only pulls raw frames, which are sharded by source
+/// address across decode workers so that the messages and transport protocol sessions of each
+/// source stay in order. Frames are handed to a worker through a ring without locking, and the
+/// workers and the consumer only lock a shard once per batch of frames or messages.
+///
+/// The decoded messages can be consumed in ingest order with `next()`, or per worker without
+/// any merging with `next(shard)`. Only one of the two should be used, from a single thread.
+class Pipeline {
+public:
+    /// Create a pipeline that is fed with `push()`, eg. to replay recorded traffic
+    explicit Pipeline(PipelineConfig config = {});
+
+    /// Create a pipeline with an ingest thread that reads frames from `transport` until it fails
+    /// or the pipeline is destroyed. If the ingest thread cannot be scheduled as configured, the
+    /// pipeline is closed and the error is returned by `ingest_error()`
+    explicit Pipeline(std::unique_ptr<Transport> transport, PipelineConfig config = {});
+    ~Pipeline();
+
+    Pipeline(const Pipeline &other) = delete;
+    Pipeline &operator=(const Pipeline &other) = delete;
+    Pipeline(Pipeline &&other) noexcept = delete;
+    Pipeline &operator=(Pipeline &&other) noexcept = delete;
+
+    /// Queue a frame for decoding. Blocks while the worker of its source is at capacity. Frames
+    /// must only be pushed from one thread, and not when the pipeline has its own ingest thread
+    void push(const can_frame &frame);
+
+    /// Signal that no more frames will be pushed. Workers drain their queues and `next()`
+    /// returns nullopt once every message has been consumed
+    void close();
+
+    /// Next decoded message in the order its last frame was ingested. Blocks until it is
+    /// available, or returns nullopt once the pipeline is closed and drained
+    std::optional<DecodedMessage> next();
+
+    /// Next decoded message of a single worker, in the order its frames were ingested
+    std::optional<DecodedMessage> next(size_t shard);
+
+    size_t shards() const { return m_shards.size(); }
+
+    /// Error that stopped the ingest thread, if any
+    std::optional<std::string> ingest_error() const;
+
+private:
+    void work(internal::PipelineShard &shard);
+    void ingest();
+    void notify_progress();
+
+    std::vector<std::unique_ptr<internal::PipelineShard>> m_shards;
+    size_t m_capacity;
+    // Number of frames pushed, which is also the sequence of the next frame
+    std::atomic<uint64_t> m_ingested = 0;
+
+    // Wakes up `next()` whenever a worker finishes a batch. Also guards the ingest error
+    mutable std::mutex m_progress_mutex;
+    std::condition_variable m_progress_cv;
+    // Only incremented with the mutex held, but read without it until `next()` has to wait
+    std::atomic<uint64_t> m_progress = 0;
+
+    std::unique_ptr<Transport> m_transport;
+    std::atomic<bool> m_stopping = false;
+    std::optional<std::string> m_ingest_error;
+    std::thread m_ingest;
+};
+
+} // namespace nmea
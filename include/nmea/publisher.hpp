@@ -0,0 +1,65 @@
+#pragma once
+
+#include "nmea/device.hpp"
+#include "nmea/message.hpp"
+#include "nmea/visit.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <optional>
+#include <string>
+#include <variant>
+
+namespace nmea {
+
+struct PublishConfig {
+    /// Nominal transmit interval, eg. 100 ms for a 10 Hz message. Updates made within an interval
+    /// are coalesced and only the latest value is sent
+    std::chrono::milliseconds interval;
+    /// Absolute difference below which a measurement is considered unchanged. Identifying fields
+    /// (instance, source, reference) must match exactly, and the SID is ignored
+    double tolerance = 0.0;
+    /// How often an unchanged value is repeated. 0 only sends a value once it changes
+    std::chrono::milliseconds max_interval{0};
+};
+
+/// Rate limited, change driven publishing of messages through a `Device`.
+///
+/// Each message type has its own configuration. Producers call `update()` as often as they like,
+/// and `flush()` sends whatever is due. The device must outlive the publisher.
+class Publisher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Publisher(Device &device) : m_device(device) {}
+
+    template <typename T> void configure(PublishConfig config) {
+        auto &entry = m_entries[internal::variant_index_v<T, NmeaMessage>];
+        entry.config = config;
+    }
+
+    /// Store the latest value of a message. Fails if its type has not been configured
+    std::expected<void, std::string> update(const NmeaMessage &msg);
+
+    /// Send every message that is due. Returns how many were sent
+    std::expected<size_t, std::string> flush(Clock::time_point now = Clock::now());
+
+    /// Earliest time at which `flush()` could send something, if anything is pending
+    std::optional<Clock::time_point> next_due() const;
+
+private:
+    struct Entry {
+        std::optional<PublishConfig> config;
+        std::optional<NmeaMessage> latest;
+        std::optional<NmeaMessage> sent;
+        Clock::time_point sent_at{};
+    };
+
+    static std::optional<Clock::time_point> due(const Entry &entry);
+
+    Device &m_device;
+    std::array<Entry, std::variant_size_v<NmeaMessage>> m_entries;
+};
+
+} // namespace nmea
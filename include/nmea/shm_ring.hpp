@@ -0,0 +1,98 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <linux/can.h>
+#include <optional>
+#include <string>
+
+namespace nmea {
+namespace internal {
+struct ShmHeader;
+} // namespace internal
+
+struct ShmRingConfig {
+    /// Number of entries kept in the ring, rounded up to a power of two. Readers that fall this
+    /// far behind the writer are overrun
+    size_t capacity = 8192;
+};
+
+/// A frame read from the bus, with the message it completed if any
+struct RingEntry {
+    /// Position of the entry in the stream of everything written to the ring
+    uint64_t sequence;
+    std::chrono::system_clock::time_point timestamp;
+    can_frame frame;
+    std::optional<NmeaMessage> message;
+};
+
+/// Writing end of a ring in shared memory (/dev/shm), so that a single process reads and decodes
+/// the bus for any number of readers in other processes. Usually fed by a `Listener` with
+/// `Listener::set_shm_ring()`.
+///
+/// There must be only one writer per ring. The shared memory object is removed when the writer
+/// is destroyed, but readers that have it mapped can keep reading what is in it
+class ShmRingWriter {
+public:
+    using Clock = std::chrono::system_clock;
+
+    /// Create the ring `name`, eg. "/nmea-can0", replacing any previous one of the same name
+    static std::expected<ShmRingWriter, std::string> create(const std::string &name,
+                                                            ShmRingConfig config = {});
+    ~ShmRingWriter();
+
+    ShmRingWriter(const ShmRingWriter &other) = delete;
+    ShmRingWriter &operator=(const ShmRingWriter &other) = delete;
+    ShmRingWriter(ShmRingWriter &&other) noexcept;
+    ShmRingWriter &operator=(ShmRingWriter &&other) noexcept;
+
+    void write(const can_frame &frame, Clock::time_point timestamp = Clock::now());
+    void write(const can_frame &frame, const NmeaMessage &message,
+               Clock::time_point timestamp = Clock::now());
+
+    size_t capacity() const;
+
+private:
+    ShmRingWriter(std::string name, internal::ShmHeader *header, size_t size);
+    void write_entry(const can_frame &frame, const NmeaMessage *message,
+                     Clock::time_point timestamp);
+
+    std::string m_name;
+    internal::ShmHeader *m_header = nullptr;
+    size_t m_size = 0;
+};
+
+/// Reading end of a ring created by `ShmRingWriter`. Entries are read straight from the mapped
+/// memory without any system calls. Each reader keeps its own position, starting at the entries
+/// written after it was opened
+class ShmRingReader {
+public:
+    static std::expected<ShmRingReader, std::string> open(const std::string &name);
+    ~ShmRingReader();
+
+    ShmRingReader(const ShmRingReader &other) = delete;
+    ShmRingReader &operator=(const ShmRingReader &other) = delete;
+    ShmRingReader(ShmRingReader &&other) noexcept;
+    ShmRingReader &operator=(ShmRingReader &&other) noexcept;
+
+    /// Next entry, or nullopt if the reader has caught up with the writer. If the writer lapped
+    /// the reader, an error tells how many entries were lost and reading resumes at the oldest
+    /// entry still in the ring
+    std::expected<std::optional<RingEntry>, std::string> next();
+
+    /// Total number of entries lost to overruns
+    uint64_t lost() const { return m_lost; }
+
+private:
+    ShmRingReader(const internal::ShmHeader *header, size_t size);
+
+    const internal::ShmHeader *m_header = nullptr;
+    size_t m_size = 0;
+    uint64_t m_next = 0;
+    uint64_t m_lost = 0;
+};
+
+} // namespace nmea
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "nmea/json.hpp"
+#include "nmea/message.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct can_frame;
+
+namespace nmea {
+namespace internal {
+struct StreamClient;
+} // namespace internal
+
+/// Wire protocol of `StreamServer`. Every message in either direction is a little endian `u16`
+/// length of what follows, a `u8` type and the payload of the type.
+namespace stream {
+/// Server to client: `u64` timestamp in ns since the epoch, `u32` CAN id with its flags, `u8`
+/// length and the frame data
+constexpr uint8_t RAW_FRAME = 0x01;
+/// Server to client: `u64` timestamp in ns since the epoch and the message as a JSON object,
+/// with the same fields as the JSON lines of `JsonEncoder`
+constexpr uint8_t DECODED_MESSAGE = 0x02;
+/// Client to server: `u8` mask of the record types to receive (1 raw, 2 decoded) followed by any
+/// number of `u32` PGNs. Without PGNs every PGN is sent. Frames of PDU1 PGNs match whatever their
+/// destination, eg. 59904 matches every ISO Request. Replaces the previous subscription
+constexpr uint8_t SUBSCRIBE = 0x81;
+
+constexpr uint8_t SUBSCRIBE_RAW = 0x01;
+constexpr uint8_t SUBSCRIBE_DECODED = 0x02;
+} // namespace stream
+
+struct StreamServerConfig {
+    /// Records are held back until this many bytes are queued for a client...
+    size_t flush_threshold = 16 * 1024;
+    /// ...or until the oldest of them has waited this long
+    std::chrono::milliseconds coalesce_delay{5};
+    /// Clients with more than this many bytes queued are too slow and get disconnected, so that
+    /// they do not hold back the others
+    size_t max_queued = 1024 * 1024;
+};
+
+/// Serves bus traffic to local clients that do not link the library, over a Unix domain socket
+/// or a TCP port on localhost. Fed by a `Listener` with `Listener::set_stream_server()`.
+///
+/// Clients receive every raw frame and decoded message until they subscribe to a subset. Records
+/// are coalesced per client and written with a single `sendmsg` once enough are queued or the
+/// oldest one has waited for the coalescing delay. They are written without holding the lock that
+/// `publish()` takes, so a slow client never holds up the thread reading the bus.
+class StreamServer {
+public:
+    using Clock = std::chrono::system_clock;
+
+    /// Serve on a Unix domain socket at `path`, replacing any socket file already there
+    static std::expected<std::unique_ptr<StreamServer>, std::string>
+    unix_socket(const std::string &path, StreamServerConfig config = {});
+
+    /// Serve on `port` of 127.0.0.1. Port 0 picks a free port, see `port()`
+    static std::expected<std::unique_ptr<StreamServer>, std::string>
+    tcp(uint16_t port, StreamServerConfig config = {});
+
+    ~StreamServer();
+
+    StreamServer(const StreamServer &other) = delete;
+    StreamServer &operator=(const StreamServer &other) = delete;
+    StreamServer(StreamServer &&other) noexcept = delete;
+    StreamServer &operator=(StreamServer &&other) noexcept = delete;
+
+    /// Queue a frame for the clients subscribed to it. Never blocks on a client
+    void publish(const can_frame &frame, Clock::time_point timestamp = Clock::now());
+    /// Queue a frame and the message it completed
+    void publish(const can_frame &frame, const NmeaMessage &message,
+                 Clock::time_point timestamp = Clock::now());
+
+    size_t clients() const;
+    /// Number of clients that were disconnected for being too slow
+    uint64_t dropped_clients() const { return m_dropped; }
+    /// TCP port the server listens on, or 0 for a Unix domain socket
+    uint16_t port() const { return m_port; }
+
+private:
+    StreamServer(int listen_fd, std::string path, uint16_t port, StreamServerConfig config);
+
+    void publish_records(const can_frame &frame, const NmeaMessage *message,
+                         Clock::time_point timestamp);
+    void run();
+    void accept_clients();
+    bool read_subscription(internal::StreamClient &client);
+    bool flush(internal::StreamClient &client);
+    void wake();
+
+    StreamServerConfig m_config;
+    int m_listen_fd;
+    int m_wake_fd;
+    std::string m_path;
+    uint16_t m_port;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<internal::StreamClient>> m_clients;
+    JsonEncoder m_json{{.format = JsonFormat::JSON_LINES}};
+    std::vector<uint8_t> m_record;
+    std::atomic<uint64_t> m_dropped = 0;
+
+    std::atomic<bool> m_stopping = false;
+    std::thread m_thread;
+};
+
+} // namespace nmea
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include <cstddef>
+#include <expected>
+#include <format>
+#include <iterator>
+#include <ranges>
+#include <string>
+
+namespace nmea {
+
+struct TextLoggerConfig {
+    /// Buffered lines are written out once they take this many bytes
+    size_t flush_threshold = 64 * 1024;
+};
+
+/// Buffered sink writing one line of text per message to a file descriptor. Messages are
+/// formatted straight into a buffer that is reused between writes, so logging at bus rate does
+/// not allocate once the buffer has grown to its working size.
+///
+/// The file descriptor is not owned and must stay open while the logger is in use
+class TextLogger {
+public:
+    explicit TextLogger(int fd, TextLoggerConfig config = {});
+    /// Writes whatever is still buffered, ignoring errors
+    ~TextLogger();
+
+    TextLogger(const TextLogger &other) = delete;
+    TextLogger &operator=(const TextLogger &other) = delete;
+    TextLogger(TextLogger &&other) noexcept = delete;
+    TextLogger &operator=(TextLogger &&other) noexcept = delete;
+
+    /// Buffer a message, and write the buffer once it reaches the flush threshold
+    template <typename Policy>
+    std::expected<void, std::string> log(const BasicNmeaMessage<Policy> &msg) {
+        append(msg);
+        if (m_buffer.size() >= m_config.flush_threshold) {
+            return flush();
+        }
+        return {};
+    }
+
+    /// Format a batch of messages after anything already buffered and write all of it at once
+    template <std::ranges::input_range Messages>
+    std::expected<void, std::string> log_batch(const Messages &messages) {
+        for (const auto &msg : messages) {
+            append(msg);
+        }
+        return flush();
+    }
+
+    /// Write everything that is buffered
+    std::expected<void, std::string> flush();
+
+    /// Number of bytes waiting to be written
+    size_t buffered() const { return m_buffer.size(); }
+
+private:
+    template <typename Message> void append(const Message &msg) {
+        std::format_to(std::back_inserter(m_buffer), "{}\n", msg);
+    }
+
+    int m_fd;
+    TextLoggerConfig m_config;
+    std::string m_buffer;
+};
+
+} // namespace nmea
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <expected>
+#include <functional>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nmea {
+
+/// Scheduling of the threads that read the bus, so that they are not preempted or migrated
+/// while a burst is queued on the socket
+struct ThreadOptions {
+    /// CPUs the thread may run on, eg. a core isolated with `isolcpus`. Empty keeps the
+    /// affinity of the creating thread
+    std::vector<int> cpus = {};
+    /// Run under SCHED_FIFO with this priority, from 1 to 99. Needs CAP_SYS_NICE or an
+    /// RLIMIT_RTPRIO of at least the priority
+    std::optional<int> fifo_priority = std::nullopt;
+};
+
+/// Apply `options` to the calling thread
+std::expected<void, std::string> configure_thread(const ThreadOptions &options);
+
+/// Start a thread that runs `function` once `options` have been applied to it. If they cannot
+/// be, the thread exits without running `function` and the error is returned
+std::expected<std::thread, std::string> start_thread(const ThreadOptions &options,
+                                                     std::function<void()> function);
+
+} // namespace nmea
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "nmea/connection.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+struct can_frame;
+
+namespace nmea {
+
+/// A whole PGN payload, as moved by transports that handle transport protocol transfers
+/// themselves
+struct Packet {
+    uint32_t pgn;
+    uint8_t priority;
+    uint8_t source;
+    /// Destination address of PDU1 PGNs, 0xFF for broadcasts
+    uint8_t destination;
+    std::vector<uint8_t> data;
+
+    /// CAN id of the frames carrying the packet
+    uint32_t can_id() const;
+};
+
+/// Moves raw CAN frames between the library and a bus. `Listener` and `Device` only talk to the
+/// bus through this interface so they can run on a SocketCAN socket or an in-process bus.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    /// Block until a frame is available and read it
+    virtual std::expected<void, std::string> read(can_frame &frame) = 0;
+
+    virtual std::expected<void, std::string> write(const can_frame &frame) = 0;
+
+    /// Write `frames` in order, stopping at the first that cannot be written. Returns how many
+    /// were written, and fails only if none was. Writes them one at a time unless overridden
+    virtual std::expected<size_t, std::string> write_batch(std::span<const can_frame> frames);
+
+    /// Wait up to `timeout` for a frame to become readable. Returns false on timeout
+    virtual bool wait(std::chrono::milliseconds timeout) = 0;
+
+    /// File descriptor that can be polled for readability, or -1 if there is none
+    virtual int fd() const = 0;
+
+    /// Replace the socket of the transport with `conn`, eg. a new one once the interface is back
+    /// up, taking ownership of it. The file descriptor of the transport does not change, so other
+    /// threads can keep using it meanwhile
+    virtual std::expected<void, std::string> reconnect(connection_t conn);
+
+    /// Whether the transport reassembles and segments transport protocol transfers itself. If so,
+    /// `read_packet()` and `write_packet()` move whole PGN payloads and `read()` only returns
+    /// the packets that fit in a single frame
+    virtual bool reassembles() const { return false; }
+
+    /// Block until a packet is available and read it into `packet`, reusing its buffer
+    virtual std::expected<void, std::string> read_packet(Packet &packet);
+
+    virtual std::expected<void, std::string> write_packet(const Packet &packet);
+};
+
+/// Transport over a socket returned by `nmea::connect`
+///
+/// This object owns the socket and closes it once done
+class SocketTransport : public Transport {
+public:
+    /// Most frames written by a single `sendmmsg()` in `write_batch()`
+    static constexpr size_t MAX_BATCH = 64;
+
+    explicit SocketTransport(connection_t conn);
+    SocketTransport() = delete;
+    ~SocketTransport() override;
+
+    SocketTransport(const SocketTransport &other) = delete;
+    SocketTransport &operator=(const SocketTransport &other) = delete;
+    SocketTransport(SocketTransport &&other) noexcept = delete;
+    SocketTransport &operator=(SocketTransport &&other) noexcept = delete;
+
+    std::expected<void, std::string> read(can_frame &frame) override;
+    std::expected<void, std::string> write(const can_frame &frame) override;
+    std::expected<size_t, std::string> write_batch(std::span<const can_frame> frames) override;
+    bool wait(std::chrono::milliseconds timeout) override;
+    int fd() const override { return m_conn; }
+    std::expected<void, std::string> reconnect(connection_t conn) override;
+
+private:
+    connection_t m_conn;
+};
+
+/// Transport over a `CAN_J1939` socket returned by `nmea::connect(interface, Protocol::J1939)`.
+/// The kernel reassembles TP and ETP transfers, so a packet of any length is a single system call
+/// and the library does no per-frame work for it.
+///
+/// The socket is bound to the source address of the packet being written whenever it changes,
+/// eg. while claiming an address. This object owns the socket and closes it once done
+class J1939Transport : public Transport {
+public:
+    /// Largest packet that can be read. Longer ETP transfers are dropped with an error
+    static constexpr size_t MAX_PACKET_SIZE = 64 * 1024;
+
+    explicit J1939Transport(connection_t conn);
+    J1939Transport() = delete;
+    ~J1939Transport() override;
+
+    J1939Transport(const J1939Transport &other) = delete;
+    J1939Transport &operator=(const J1939Transport &other) = delete;
+    J1939Transport(J1939Transport &&other) noexcept = delete;
+    J1939Transport &operator=(J1939Transport &&other) noexcept = delete;
+
+    std::expected<void, std::string> read(can_frame &frame) override;
+    std::expected<void, std::string> write(const can_frame &frame) override;
+    bool wait(std::chrono::milliseconds timeout) override;
+    int fd() const override { return m_conn; }
+    std::expected<void, std::string> reconnect(connection_t conn) override;
+
+    bool reassembles() const override { return true; }
+    std::expected<void, std::string> read_packet(Packet &packet) override;
+    std::expected<void, std::string> write_packet(const Packet &packet) override;
+
+private:
+    std::expected<void, std::string> receive(Packet &packet);
+    std::expected<void, std::string> send(uint32_t pgn, uint8_t priority, uint8_t source,
+                                          uint8_t destination, std::span<const uint8_t> data);
+
+    connection_t m_conn;
+    // Held by writes and reconnects, which replace the socket and the state it is bound with
+    std::mutex m_mutex;
+    int m_ifindex = 0;
+    std::optional<uint8_t> m_bound_source;
+    // NAME of the last address claim sent, J1939_NO_NAME until then
+    uint64_t m_bound_name = 0;
+    std::optional<uint8_t> m_send_priority;
+    std::vector<uint8_t> m_buffer;
+    Packet m_packet{};
+};
+
+/// Transport for a socket returned by `nmea::connect`, of either protocol
+std::unique_ptr<Transport> socket_transport(connection_t conn);
+
+} // namespace nmea
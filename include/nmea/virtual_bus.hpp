@@ -0,0 +1,59 @@
+#pragma once
+
+#include "nmea/transport.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace nmea {
+namespace internal {
+struct VirtualBusState;
+} // namespace internal
+
+struct VirtualBusConfig {
+    /// Bit rate used to work out how long each frame occupies the bus. While the bus is busy,
+    /// frames queue up and the lowest CAN id wins arbitration once it is free. 0 transmits every
+    /// frame instantly
+    uint32_t bitrate = 0;
+    /// Delay between a frame finishing transmission and it becoming readable by the other nodes
+    std::chrono::microseconds latency{0};
+    /// Probability in [0, 1] that a node misses a transmitted frame
+    double loss = 0.0;
+    /// Seed for the loss model so that simulations are reproducible
+    uint32_t seed = 0;
+};
+
+/// In-process CAN bus. Frames written by one attached node are delivered to every other node,
+/// like a CAN_RAW socket with the default loopback settings.
+///
+/// Nodes only need a `Transport`, so `Listener` and `Device` objects can be created on top of
+/// the bus without a (virtual) CAN interface. The bus state is shared with the nodes, so it is
+/// safe for the `VirtualBus` object to be destroyed before them.
+class VirtualBus {
+public:
+    explicit VirtualBus(VirtualBusConfig config = {});
+    ~VirtualBus() = default;
+
+    VirtualBus(const VirtualBus &other) = delete;
+    VirtualBus &operator=(const VirtualBus &other) = delete;
+    VirtualBus(VirtualBus &&other) noexcept = default;
+    VirtualBus &operator=(VirtualBus &&other) noexcept = default;
+
+    /// Attach a new node to the bus. It is detached once the returned transport is destroyed
+    std::unique_ptr<Transport> attach();
+
+    /// Number of attached nodes
+    size_t nodes() const;
+
+    /// Number of frames that won arbitration and were put on the bus
+    uint64_t frames_transmitted() const;
+
+    /// Number of deliveries dropped by the loss model (one per frame and receiving node)
+    uint64_t frames_dropped() const;
+
+private:
+    std::shared_ptr<internal::VirtualBusState> m_state;
+};
+
+} // namespace nmea
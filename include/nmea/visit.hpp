@@ -1,6 +1,9 @@
 #pragma once
 
 #include "nmea/message.hpp"
+#include <cstddef>
+#include <type_traits>
+#include <variant>
 
 namespace nmea {
 namespace internal {
@@ -8,13 +11,33 @@ template <typename... Ts> struct overload : Ts... {
     using Ts::operator()...;
 };
 
+template <typename T, typename Variant> struct variant_index;
+
+template <typename T, typename... Ts> struct variant_index<T, std::variant<Ts...>> {
+    static constexpr std::size_t value = [] {
+        constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+        for (std::size_t i = 0; i < sizeof...(Ts); i++) {
+            if (matches[i]) {
+                return i;
+            }
+        }
+        return sizeof...(Ts);
+    }();
+    static_assert(value < sizeof...(Ts), "Type is not an alternative of the variant");
+};
+
+template <typename T, typename Variant>
+constexpr std::size_t variant_index_v = variant_index<T, Variant>::value;
+
 } // namespace internal
 
-template <typename... Visitors> auto visit(NmeaMessage &msg, Visitors &&...visitors) {
+template <typename Policy, typename... Visitors>
+auto visit(BasicNmeaMessage<Policy> &msg, Visitors &&...visitors) {
     return std::visit(internal::overload{std::forward<Visitors>(visitors)...}, msg);
 }
 
-template <typename... Visitors> auto visit(const NmeaMessage &msg, Visitors &&...visitors) {
+template <typename Policy, typename... Visitors>
+auto visit(const BasicNmeaMessage<Policy> &msg, Visitors &&...visitors) {
     return std::visit(internal::overload{std::forward<Visitors>(visitors)...}, msg);
 }
 } // namespace nmea
@@ -0,0 +1,74 @@
+#include "nmea/address_map.hpp"
+#include <algorithm>
+#include <linux/can.h>
+
+namespace nmea {
+
+constexpr uint32_t PGN_ADDRESS_CLAIM_PF = 0xEEu;
+
+void AddressMap::observe(const can_frame &frame) {
+    if (((frame.can_id >> 16) & 0xFF) != PGN_ADDRESS_CLAIM_PF || frame.can_dlc < 8) {
+        return;
+    }
+    uint64_t name = 0;
+    for (int i = 0; i < 8; ++i) {
+        name |= static_cast<uint64_t>(frame.data[i]) << (i * 8);
+    }
+    record(static_cast<uint8_t>(frame.can_id & 0xFF), name);
+}
+
+void AddressMap::record(uint8_t address, uint64_t name) {
+    std::lock_guard lock(m_mutex);
+    // A device only holds one address, so a new claim replaces the old one
+    std::ranges::replace(m_names, std::optional<uint64_t>(name), std::optional<uint64_t>());
+    if (address <= MAX_CLAIMABLE_ADDRESS) {
+        m_names[address] = name;
+    }
+}
+
+std::optional<uint64_t> AddressMap::name(uint8_t address) const {
+    if (address > MAX_CLAIMABLE_ADDRESS) {
+        return std::nullopt;
+    }
+    std::lock_guard lock(m_mutex);
+    return m_names[address];
+}
+
+std::optional<uint8_t> AddressMap::address(uint64_t name) const {
+    std::lock_guard lock(m_mutex);
+    auto iter = std::ranges::find(m_names, std::optional<uint64_t>(name));
+    if (iter == m_names.end()) {
+        return std::nullopt;
+    }
+    return static_cast<uint8_t>(iter - m_names.begin());
+}
+
+std::optional<uint8_t> AddressMap::free_address(uint8_t preferred, uint64_t own_name) const {
+    std::lock_guard lock(m_mutex);
+    for (size_t i = 0; i < m_names.size(); i++) {
+        const size_t address = (preferred + i) % m_names.size();
+        // The lower NAME wins an address claim contest
+        if (!m_names[address] || *m_names[address] >= own_name) {
+            return static_cast<uint8_t>(address);
+        }
+    }
+    return std::nullopt;
+}
+
+bool AddressMap::taken(uint8_t address, uint64_t own_name) const {
+    auto holder = name(address);
+    return holder && *holder < own_name;
+}
+
+size_t AddressMap::size() const {
+    std::lock_guard lock(m_mutex);
+    return static_cast<size_t>(
+        std::ranges::count_if(m_names, [](const auto &n) { return n.has_value(); }));
+}
+
+void AddressMap::clear() {
+    std::lock_guard lock(m_mutex);
+    m_names.fill(std::nullopt);
+}
+
+} // namespace nmea
@@ -0,0 +1,180 @@
+#include "nmea/async.hpp"
+#include "nmea/transport.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace nmea {
+
+using namespace std::chrono;
+
+void Wait::suspend(Executor &executor, std::coroutine_handle<> handle) {
+    m_waiter.handle = handle;
+    m_waiter.fd = m_fd;
+    // The coroutine can be resumed by another thread as soon as it is registered
+    executor.suspend(m_waiter, m_events, m_deadline);
+}
+
+Task<bool> frame_available(Transport &transport, std::optional<steady_clock::time_point> deadline) {
+    while (!transport.wait(milliseconds(0))) {
+        const auto now = steady_clock::now();
+        if (deadline && now >= *deadline) {
+            co_return false;
+        }
+        if (transport.fd() >= 0) {
+            co_await Wait(transport.fd(), EPOLLIN, deadline);
+        } else {
+            co_await sleep_until(deadline ? std::min(*deadline, now + milliseconds(1))
+                                          : now + milliseconds(1));
+        }
+    }
+    co_return true;
+}
+
+Executor::Executor()
+    : m_epoll_fd(epoll_create1(EPOLL_CLOEXEC)), m_wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = m_wake_fd;
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &event);
+}
+
+Executor::~Executor() {
+    for (void *task : m_tasks) {
+        std::coroutine_handle<>::from_address(task).destroy();
+    }
+    close(m_wake_fd);
+    close(m_epoll_fd);
+}
+
+Executor::Detached Executor::detach(Task<> task) {
+    co_await std::move(task);
+}
+
+void Executor::spawn(Task<> task) {
+    auto detached = detach(std::move(task));
+    detached.handle.promise().executor = this;
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.insert(detached.handle.address());
+        m_ready.push_back(detached.handle);
+    }
+    // Spawning from outside of the executor must wake a thread blocked in epoll
+    wake();
+}
+
+void Executor::run() {
+    std::array<epoll_event, 64> events{};
+    std::unique_lock lock(m_mutex);
+    m_running++;
+    while (!m_stopping && !m_tasks.empty()) {
+        if (!m_ready.empty()) {
+            auto handle = m_ready.front();
+            m_ready.pop_front();
+            lock.unlock();
+            handle.resume();
+            lock.lock();
+            continue;
+        }
+
+        int timeout = -1;
+        if (!m_timers.empty()) {
+            const auto remaining = ceil<milliseconds>(m_timers.begin()->first - Clock::now());
+            timeout = static_cast<int>(std::max<milliseconds::rep>(remaining.count(), 0));
+        }
+        lock.unlock();
+        const int count = epoll_wait(m_epoll_fd, events.data(), events.size(), timeout);
+        lock.lock();
+
+        bool woken = false;
+        for (int i = 0; i < count; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == m_wake_fd) {
+                woken = true;
+            } else if (auto iter = m_fd_waiters.find(fd); iter != m_fd_waiters.end()) {
+                complete(*iter->second, false);
+            }
+        }
+        // Once done the wake up is left pending so that it reaches every thread
+        if (woken && !m_stopping && !m_tasks.empty()) {
+            uint64_t value = 0;
+            [[maybe_unused]] auto nbytes = ::read(m_wake_fd, &value, sizeof(value));
+        }
+
+        const auto now = Clock::now();
+        while (!m_timers.empty() && m_timers.begin()->first <= now) {
+            complete(*m_timers.begin()->second, true);
+        }
+    }
+    if (--m_running == 0) {
+        m_stopping = false;
+    }
+}
+
+void Executor::stop() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    wake();
+}
+
+size_t Executor::pending() const {
+    std::lock_guard lock(m_mutex);
+    return m_tasks.size();
+}
+
+void Executor::suspend(internal::Waiter &waiter, uint32_t events,
+                       std::optional<Clock::time_point> deadline) {
+    std::lock_guard lock(m_mutex);
+    if (waiter.fd >= 0) {
+        epoll_event event{};
+        event.events = events | EPOLLONESHOT;
+        event.data.fd = waiter.fd;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, waiter.fd, &event) < 0 &&
+            (errno != EEXIST || epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, waiter.fd, &event) < 0)) {
+            // Not pollable. Resume straight away and let the caller run into the error
+            m_ready.push_back(waiter.handle);
+            return;
+        }
+        m_fd_waiters[waiter.fd] = &waiter;
+    }
+    if (deadline) {
+        waiter.timer = m_timers.emplace(*deadline, &waiter);
+    } else if (waiter.fd < 0) {
+        m_ready.push_back(waiter.handle);
+    }
+}
+
+void Executor::complete(internal::Waiter &waiter, bool timed_out) {
+    if (waiter.fd >= 0) {
+        m_fd_waiters.erase(waiter.fd);
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, waiter.fd, nullptr);
+    }
+    if (waiter.timer) {
+        m_timers.erase(*waiter.timer);
+    }
+    waiter.timed_out = timed_out;
+    m_ready.push_back(waiter.handle);
+}
+
+void Executor::finished(void *task) {
+    bool done = false;
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.erase(task);
+        done = m_tasks.empty();
+    }
+    if (done) {
+        wake();
+    }
+}
+
+void Executor::wake() {
+    const uint64_t value = 1;
+    [[maybe_unused]] auto nbytes = ::write(m_wake_fd, &value, sizeof(value));
+}
+
+} // namespace nmea
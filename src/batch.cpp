@@ -0,0 +1,249 @@
+#include "nmea/batch.hpp"
+#include "nmea/message.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <format>
+#include <linux/can.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace nmea {
+namespace batch {
+
+// The kernels load whole frames and pick the payload out of the second 8 bytes
+static_assert(sizeof(can_frame) == 16 && offsetof(can_frame, data) == 8);
+
+// Fields are decoded one at a time over chunks small enough to stay in L1 between the passes
+constexpr size_t CHUNK = 256;
+
+constexpr size_t ATTITUDE_MIN_LENGTH = 7;
+constexpr size_t POSITION_MIN_LENGTH = 8;
+constexpr size_t COGSOG_MIN_LENGTH = 6;
+
+enum class Field {
+    I16,
+    U16,
+    I32,
+};
+
+// ======================================= Scalar Kernels ======================================= //
+template <Field Type>
+static void decode_field_scalar(const can_frame *frames, size_t count, size_t offset,
+                                double scale, double *out) {
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *data = frames[i].data + offset;
+        if constexpr (Type == Field::I32) {
+            const uint32_t raw = uint32_t(data[0]) | (uint32_t(data[1]) << 8) |
+                                 (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+            out[i] = static_cast<int32_t>(raw) * scale;
+        } else if constexpr (Type == Field::I16) {
+            out[i] = static_cast<int16_t>(data[0] | (data[1] << 8)) * scale;
+        } else {
+            out[i] = static_cast<uint16_t>(data[0] | (data[1] << 8)) * scale;
+        }
+    }
+}
+
+#if defined(__x86_64__)
+// ======================================== SSE2 Kernels ======================================== //
+// Two frames per iteration. The field is shifted to the top of each 64-bit payload so that it
+// ends up in the high dword (sign or zero extended), and the two high dwords are packed together
+template <Field Type>
+static void decode_field_sse2(const can_frame *frames, size_t count, size_t offset, double scale,
+                              double *out) {
+    const int width = Type == Field::I32 ? 32 : 16;
+    const __m128i shift = _mm_cvtsi32_si128(64 - width - static_cast<int>(offset) * 8);
+    const __m128d factor = _mm_set1_pd(scale);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frames + i + 1));
+        __m128i fields = _mm_sll_epi64(_mm_unpackhi_epi64(a, b), shift);
+        if constexpr (Type == Field::I16) {
+            fields = _mm_srai_epi32(fields, 16);
+        } else if constexpr (Type == Field::U16) {
+            fields = _mm_srli_epi32(fields, 16);
+        }
+        const __m128i packed = _mm_shuffle_epi32(fields, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_cvtepi32_pd(packed), factor));
+    }
+    decode_field_scalar<Type>(frames + i, count - i, offset, scale, out + i);
+}
+
+// ======================================== AVX2 Kernels ======================================== //
+// Four frames per iteration. After unpacking, each 128-bit lane holds two payloads and a byte
+// shuffle moves their fields into the first two dwords of the lane
+template <Field Type>
+__attribute__((target("avx2"))) static void
+decode_field_avx2(const can_frame *frames, size_t count, size_t offset, double scale,
+                  double *out) {
+    const size_t width = Type == Field::I32 ? 4 : 2;
+    // Signed 16-bit fields go to the top of the dword so an arithmetic shift sign extends them
+    const size_t position = Type == Field::I16 ? 2 : 0;
+    alignas(32) std::array<uint8_t, 32> mask{};
+    mask.fill(0x80);
+    for (size_t lane = 0; lane < 2; lane++) {
+        for (size_t payload = 0; payload < 2; payload++) {
+            for (size_t byte = 0; byte < width; byte++) {
+                mask[lane * 16 + payload * 4 + position + byte] =
+                    static_cast<uint8_t>(payload * 8 + offset + byte);
+            }
+        }
+    }
+    const __m256i shuffle = _mm256_load_si256(reinterpret_cast<const __m256i *>(mask.data()));
+    // Lane 0 holds the fields of frames 0 and 2, lane 1 the ones of frames 1 and 3
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256d factor = _mm256_set1_pd(scale);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(frames + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(frames + i + 2));
+        __m256i fields = _mm256_shuffle_epi8(_mm256_unpackhi_epi64(a, b), shuffle);
+        if constexpr (Type == Field::I16) {
+            fields = _mm256_srai_epi32(fields, 16);
+        }
+        const __m128i packed =
+            _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(fields, order));
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_cvtepi32_pd(packed), factor));
+    }
+    decode_field_scalar<Type>(frames + i, count - i, offset, scale, out + i);
+}
+#endif
+
+// ========================================== Dispatch ========================================== //
+Simd detect_simd() {
+#if defined(__x86_64__)
+    static const Simd simd = __builtin_cpu_supports("avx2") ? Simd::AVX2 : Simd::SSE2;
+    return simd;
+#else
+    return Simd::SCALAR;
+#endif
+}
+
+template <Field Type>
+static void decode_field(Simd simd, std::span<const can_frame> frames, size_t offset,
+                         double scale, double *out) {
+    switch (simd) {
+#if defined(__x86_64__)
+    case Simd::AVX2:
+        return decode_field_avx2<Type>(frames.data(), frames.size(), offset, scale, out);
+    case Simd::SSE2:
+        return decode_field_sse2<Type>(frames.data(), frames.size(), offset, scale, out);
+#endif
+    default:
+        return decode_field_scalar<Type>(frames.data(), frames.size(), offset, scale, out);
+    }
+}
+
+static Simd supported(Simd simd) { return std::min(simd, detect_simd()); }
+
+// Checked without branches first, so the kernels only run on chunks that are known to be valid
+static std::expected<void, std::string> validate(std::span<const can_frame> frames, size_t first,
+                                                 uint32_t expected_pgn, size_t min_length) {
+    bool invalid = false;
+    for (const auto &frame : frames) {
+        invalid |= (((frame.can_id >> 8) & 0x3FFFF) != expected_pgn) | (frame.can_dlc < min_length);
+    }
+    if (!invalid) [[likely]] {
+        return {};
+    }
+    for (size_t i = 0; i < frames.size(); i++) {
+        const uint32_t frame_pgn = (frames[i].can_id >> 8) & 0x3FFFF;
+        if (frame_pgn != expected_pgn) {
+            return std::unexpected(std::format("Frame {} is PGN {}, expected {}", first + i,
+                                               frame_pgn, expected_pgn));
+        }
+        if (frames[i].can_dlc < min_length) {
+            return std::unexpected(
+                std::format("Frame {}: PGN {} payload too short: got {} bytes, expected {}",
+                            first + i, frame_pgn, frames[i].can_dlc, min_length));
+        }
+    }
+    return {};
+}
+
+// Validate and decode one chunk at a time so the frames are only read from memory once. If a
+// frame is invalid, whatever was decoded of the batch is dropped again
+template <typename Out, typename Decoder>
+static std::expected<void, std::string> decode_chunks(std::span<const can_frame> frames,
+                                                      Out &out, uint32_t expected_pgn,
+                                                      size_t min_length, Decoder decoder) {
+    const size_t start = out.size();
+    out.resize(start + frames.size());
+    for (size_t first = 0; first < frames.size(); first += CHUNK) {
+        const auto chunk = frames.subspan(first, std::min(CHUNK, frames.size() - first));
+        if (auto valid = validate(chunk, first, expected_pgn, min_length); !valid) {
+            out.resize(start);
+            return valid;
+        }
+        decoder(chunk, start + first);
+    }
+    return {};
+}
+
+// ===================================== Public Batch Types ===================================== //
+void Attitude::resize(size_t n) {
+    sid.resize(n);
+    yaw.resize(n);
+    pitch.resize(n);
+    roll.resize(n);
+}
+
+void Position::resize(size_t n) {
+    latitude.resize(n);
+    longitude.resize(n);
+}
+
+void CogSog::resize(size_t n) {
+    sid.resize(n);
+    cog_reference.resize(n);
+    cog.resize(n);
+    sog.resize(n);
+}
+
+// ================================== Public API Implementation ================================= //
+std::expected<void, std::string> decode(std::span<const can_frame> frames, Attitude &out,
+                                        Simd simd) {
+    simd = supported(simd);
+    return decode_chunks(frames, out, pgn::ATTITUDE, ATTITUDE_MIN_LENGTH,
+                         [&](std::span<const can_frame> chunk, size_t at) {
+                             for (size_t i = 0; i < chunk.size(); i++) {
+                                 out.sid[at + i] = chunk[i].data[0];
+                             }
+                             decode_field<Field::I16>(simd, chunk, 1, 0.0001, &out.yaw[at]);
+                             decode_field<Field::I16>(simd, chunk, 3, 0.0001, &out.pitch[at]);
+                             decode_field<Field::I16>(simd, chunk, 5, 0.0001, &out.roll[at]);
+                         });
+}
+
+std::expected<void, std::string> decode(std::span<const can_frame> frames, Position &out,
+                                        Simd simd) {
+    simd = supported(simd);
+    return decode_chunks(frames, out, pgn::POSITION, POSITION_MIN_LENGTH,
+                         [&](std::span<const can_frame> chunk, size_t at) {
+                             decode_field<Field::I32>(simd, chunk, 0, 1e-07, &out.latitude[at]);
+                             decode_field<Field::I32>(simd, chunk, 4, 1e-07, &out.longitude[at]);
+                         });
+}
+
+std::expected<void, std::string> decode(std::span<const can_frame> frames, CogSog &out,
+                                        Simd simd) {
+    simd = supported(simd);
+    return decode_chunks(frames, out, pgn::COG_SOG, COGSOG_MIN_LENGTH,
+                         [&](std::span<const can_frame> chunk, size_t at) {
+                             for (size_t i = 0; i < chunk.size(); i++) {
+                                 out.sid[at + i] = chunk[i].data[0];
+                                 out.cog_reference[at + i] = chunk[i].data[1] & 0x03;
+                             }
+                             decode_field<Field::U16>(simd, chunk, 2, 0.0001, &out.cog[at]);
+                             decode_field<Field::U16>(simd, chunk, 4, 0.01, &out.sog[at]);
+                         });
+}
+
+} // namespace batch
+} // namespace nmea
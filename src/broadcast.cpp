@@ -0,0 +1,89 @@
+#include "nmea/broadcast.hpp"
+#include "ring_slot.hpp"
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace nmea {
+
+using internal::RingSlot;
+
+// ======================================= BroadcastRing ======================================== //
+BroadcastRing::BroadcastRing(BroadcastConfig config)
+    : m_capacity(std::bit_ceil(std::max<size_t>(config.capacity, 1))),
+      m_slots(std::make_unique<RingSlot[]>(m_capacity)) {}
+
+BroadcastRing::~BroadcastRing() = default;
+
+void BroadcastRing::write(const can_frame &frame, Clock::time_point timestamp) {
+    write_entry(frame, nullptr, timestamp);
+}
+
+void BroadcastRing::write(const can_frame &frame, const NmeaMessage &message,
+                          Clock::time_point timestamp) {
+    write_entry(frame, &message, timestamp);
+}
+
+void BroadcastRing::write_entry(const can_frame &frame, const NmeaMessage *message,
+                                Clock::time_point timestamp) {
+    const uint64_t sequence = m_head.load(std::memory_order_relaxed);
+    m_slots[sequence & (m_capacity - 1)].write(sequence,
+                                               internal::ring_payload(frame, message, timestamp));
+    m_head.store(sequence + 1, std::memory_order_seq_cst);
+
+    // Pairs with the increment in `wait()`: either the reader sees the new head, or this sees
+    // the reader and wakes it up under the lock
+    if (m_waiters.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard lock(m_mutex);
+        m_cv.notify_all();
+    }
+}
+
+BroadcastReader BroadcastRing::subscribe(std::vector<uint32_t> pgns) const {
+    return BroadcastReader(*this, std::move(pgns));
+}
+
+// ====================================== BroadcastReader ======================================= //
+BroadcastReader::BroadcastReader(const BroadcastRing &ring, std::vector<uint32_t> pgns)
+    : m_ring(&ring), m_pgns(std::move(pgns)),
+      m_next(ring.m_head.load(std::memory_order_acquire)) {
+    std::ranges::sort(m_pgns);
+}
+
+bool BroadcastReader::wants(uint32_t pgn) const {
+    return m_pgns.empty() || std::ranges::binary_search(m_pgns, pgn);
+}
+
+std::expected<std::optional<RingEntry>, std::string> BroadcastReader::next() {
+    while (true) {
+        const uint64_t sequence = m_next;
+        auto payload = internal::read_slot(m_ring->m_slots.get(), m_ring->m_capacity,
+                                           m_ring->m_head, m_next, m_lost);
+        if (!payload) {
+            return std::unexpected(payload.error());
+        }
+        if (!*payload) {
+            return std::nullopt;
+        }
+        if (wants((*payload)->pgn)) {
+            return internal::ring_entry(sequence, **payload);
+        }
+    }
+}
+
+bool BroadcastReader::wait(std::chrono::milliseconds timeout) const {
+    auto written = [&] { return m_ring->m_head.load(std::memory_order_seq_cst) > m_next; };
+    if (written()) {
+        return true;
+    }
+    m_ring->m_waiters.fetch_add(1, std::memory_order_seq_cst);
+    bool result;
+    {
+        std::unique_lock lock(m_ring->m_mutex);
+        result = m_ring->m_cv.wait_for(lock, timeout, written);
+    }
+    m_ring->m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+}
+
+} // namespace nmea
@@ -0,0 +1,166 @@
+#include "nmea/bus_load.hpp"
+#include <algorithm>
+#include <linux/can.h>
+
+namespace nmea {
+
+// CRC delimiter (1), ACK slot and delimiter (2), end of frame (7) and inter-frame space (3). These
+// fields have a fixed form and are never stuffed
+constexpr uint32_t FIXED_TRAILER_BITS = 13;
+
+namespace {
+
+// Tracks the stuffed length and CRC of the bits from the start of frame to the end of the CRC
+class BitStuffer {
+public:
+    void push(uint32_t value, int bits) {
+        for (int i = bits - 1; i >= 0; i--) {
+            push_bit(((value >> i) & 1) != 0);
+        }
+    }
+
+    void push_data(uint32_t value, int bits) {
+        for (int i = bits - 1; i >= 0; i--) {
+            const bool bit = ((value >> i) & 1) != 0;
+            const bool crc_next = bit != ((m_crc >> 14) & 1);
+            m_crc = static_cast<uint16_t>((m_crc << 1) & 0x7FFF);
+            if (crc_next) {
+                m_crc ^= 0x4599;
+            }
+            push_bit(bit);
+        }
+    }
+
+    uint16_t crc() const { return m_crc; }
+    uint32_t length() const { return m_length; }
+
+private:
+    void push_bit(bool bit) {
+        m_length++;
+        if (m_run > 0 && bit == m_last) {
+            m_run++;
+        } else {
+            m_last = bit;
+            m_run = 1;
+        }
+        if (m_run == 5) {
+            // Stuff bit of the opposite level, which also starts the next run
+            m_length++;
+            m_last = !bit;
+            m_run = 1;
+        }
+    }
+
+    uint32_t m_length = 0;
+    int m_run = 0;
+    bool m_last = false;
+    uint16_t m_crc = 0;
+};
+
+} // namespace
+
+BusLoad::BusLoad(BusLoadConfig config)
+    : m_config(config),
+      m_bucket_width(std::max<Clock::duration>(
+          std::chrono::duration_cast<Clock::duration>(config.window) / BUCKETS,
+          Clock::duration(1))) {}
+
+uint32_t BusLoad::frame_bits(const can_frame &frame) {
+    const uint8_t dlc = std::min<uint8_t>(frame.can_dlc, CAN_MAX_DLEN);
+    const bool remote = (frame.can_id & CAN_RTR_FLAG) != 0;
+
+    BitStuffer stuffer;
+    stuffer.push_data(0, 1); // Start of frame
+    if (frame.can_id & CAN_EFF_FLAG) {
+        const uint32_t id = frame.can_id & CAN_EFF_MASK;
+        stuffer.push_data(id >> 18, 11);
+        stuffer.push_data(0b11, 2); // SRR and IDE
+        stuffer.push_data(id & 0x3FFFF, 18);
+        stuffer.push_data(remote, 1);
+        stuffer.push_data(0, 2); // r1 and r0
+    } else {
+        stuffer.push_data(frame.can_id & CAN_SFF_MASK, 11);
+        stuffer.push_data(remote, 1);
+        stuffer.push_data(0, 2); // IDE and r0
+    }
+    stuffer.push_data(frame.can_dlc & 0x0F, 4);
+    if (!remote) {
+        for (uint8_t i = 0; i < dlc; i++) {
+            stuffer.push_data(frame.data[i], 8);
+        }
+    }
+    stuffer.push(stuffer.crc(), 15);
+
+    return stuffer.length() + FIXED_TRAILER_BITS;
+}
+
+uint64_t BusLoad::epoch(Clock::time_point now) const {
+    const auto since = now.time_since_epoch();
+    return since.count() > 0 ? static_cast<uint64_t>(since / m_bucket_width) : 0;
+}
+
+void BusLoad::add(Window &window, uint64_t epoch, uint32_t bits) {
+    auto &bucket = window[epoch % BUCKETS];
+    if (bucket.epoch != epoch) {
+        bucket = Bucket{.epoch = epoch, .frames = 0, .bits = 0};
+    }
+    bucket.frames++;
+    bucket.bits += bits;
+}
+
+BusUsage BusLoad::usage(const Window &window, uint64_t epoch) const {
+    BusUsage result{.frames = 0, .bits = 0, .load = 0.0};
+    for (const auto &bucket : window) {
+        if (bucket.epoch <= epoch && epoch - bucket.epoch < BUCKETS) {
+            result.frames += bucket.frames;
+            result.bits += bucket.bits;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(m_bucket_width * BUCKETS).count();
+    if (m_config.bitrate > 0) {
+        result.load = static_cast<double>(result.bits) / (m_config.bitrate * seconds);
+    }
+    return result;
+}
+
+void BusLoad::record(const can_frame &frame, Clock::time_point now) {
+    const uint32_t bits = frame_bits(frame);
+    const uint64_t current = epoch(now);
+
+    // PDU1 PGNs (PF below 240) carry the destination address in place of the low byte
+    const uint32_t id = frame.can_id & CAN_EFF_MASK;
+    const uint32_t pf = (id >> 16) & 0xFF;
+    const uint32_t pgn = pf < 240 ? (id >> 8) & 0x3FF00 : (id >> 8) & 0x3FFFF;
+
+    add(m_total, current, bits);
+    add(m_sources[id & 0xFF], current, bits);
+    add(m_pgns[pgn], current, bits);
+}
+
+BusUsage BusLoad::total(Clock::time_point now) const { return usage(m_total, epoch(now)); }
+
+BusUsage BusLoad::pgn(uint32_t pgn, Clock::time_point now) const {
+    auto iter = m_pgns.find(pgn);
+    if (iter == m_pgns.end()) {
+        return BusUsage{.frames = 0, .bits = 0, .load = 0.0};
+    }
+    return usage(iter->second, epoch(now));
+}
+
+BusUsage BusLoad::source(uint8_t source, Clock::time_point now) const {
+    return usage(m_sources[source], epoch(now));
+}
+
+std::vector<std::pair<uint32_t, BusUsage>> BusLoad::pgns(Clock::time_point now) const {
+    const uint64_t current = epoch(now);
+    std::vector<std::pair<uint32_t, BusUsage>> result;
+    for (const auto &[pgn, window] : m_pgns) {
+        auto pgn_usage = usage(window, current);
+        if (pgn_usage.frames > 0) {
+            result.emplace_back(pgn, pgn_usage);
+        }
+    }
+    return result;
+}
+
+} // namespace nmea
@@ -1,18 +1,87 @@
 #include "nmea/connection.hpp"
+#include "nmea/message.hpp"
 #include "utils.hpp"
 
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <vector>
 
 #include <linux/can.h>
+#include <linux/can/j1939.h>
 #include <linux/can/raw.h>
 
 namespace nmea {
-std::expected<connection_t, std::string> connect(std::string_view interface) {
-    int sockfd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+static std::string socket_error(std::string_view what) {
+    return std::format("{}: {}", what, std::strerror(errno));
+}
+
+// Buffer sizes are capped by the sysctl limits unless forced, which only privileged processes can
+static bool set_buffer_size(int sockfd, int option, int force_option, int size) {
+    return setsockopt(sockfd, SOL_SOCKET, force_option, &size, sizeof(size)) == 0 ||
+           setsockopt(sockfd, SOL_SOCKET, option, &size, sizeof(size)) == 0;
+}
+
+static std::expected<void, std::string> configure(int sockfd, const ConnectOptions &options) {
+    if (options.receive_buffer &&
+        !set_buffer_size(sockfd, SO_RCVBUF, SO_RCVBUFFORCE, *options.receive_buffer)) {
+        return std::unexpected(socket_error("Unable to set receive buffer size"));
+    }
+    if (options.send_buffer &&
+        !set_buffer_size(sockfd, SO_SNDBUF, SO_SNDBUFFORCE, *options.send_buffer)) {
+        return std::unexpected(socket_error("Unable to set send buffer size"));
+    }
+    if (options.busy_poll) {
+        const auto usecs = static_cast<int>(options.busy_poll->count());
+        if (setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof(usecs)) == -1) {
+            return std::unexpected(socket_error("Unable to enable busy polling"));
+        }
+    }
+    if (options.priority &&
+        setsockopt(sockfd, SOL_SOCKET, SO_PRIORITY, &*options.priority, sizeof(int)) == -1) {
+        return std::unexpected(socket_error("Unable to set socket priority"));
+    }
+    if (options.nonblocking) {
+        const int flags = fcntl(sockfd, F_GETFL);
+        if (flags == -1 || fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) == -1) {
+            return std::unexpected(socket_error("Unable to make socket non-blocking"));
+        }
+    }
+
+    if (options.protocol == Protocol::RAW) {
+        const int loopback = options.loopback;
+        const int recv_own = options.receive_own_messages;
+        const can_err_mask_t error_mask = options.error_mask;
+        if (setsockopt(sockfd, SOL_CAN_RAW, CAN_RAW_LOOPBACK, &loopback, sizeof(loopback)) == -1) {
+            return std::unexpected(socket_error("Unable to set loopback"));
+        }
+        if (setsockopt(sockfd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &recv_own,
+                       sizeof(recv_own)) == -1) {
+            return std::unexpected(socket_error("Unable to set reception of own messages"));
+        }
+        if (setsockopt(sockfd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &error_mask,
+                       sizeof(error_mask)) == -1) {
+            return std::unexpected(socket_error("Unable to set error frame mask"));
+        }
+    }
+    return {};
+}
+
+std::expected<connection_t, std::string> connect(std::string_view interface, Protocol protocol) {
+    return connect(interface, ConnectOptions{.protocol = protocol});
+}
+
+std::expected<connection_t, std::string> connect(std::string_view interface,
+                                                 const ConnectOptions &options) {
+    const bool j1939 = options.protocol == Protocol::J1939;
+    int sockfd =
+        j1939 ? socket(PF_CAN, SOCK_DGRAM, CAN_J1939) : socket(PF_CAN, SOCK_RAW, CAN_RAW);
     if (sockfd == -1) {
         return std::unexpected("Error while opening socket");
     }
@@ -25,11 +94,25 @@ std::expected<connection_t, std::string> connect(std::string_view interface) {
         return std::unexpected("Network interface not found");
     }
 
+    // Before binding, so that no frame is queued with the default options
+    if (auto configured = configure(sockfd, options); !configured) {
+        return std::unexpected(configured.error());
+    }
+
     sockaddr_can addr{
         .can_family = AF_CAN,
         .can_ifindex = ifr.ifr_ifindex,
         .can_addr = {},
     };
+    if (j1939) {
+        // Receive every PGN from every address. The source address is bound when sending
+        addr.can_addr.j1939 = {.name = J1939_NO_NAME, .pgn = J1939_NO_PGN, .addr = J1939_NO_ADDR};
+        const int enable = 1;
+        if (setsockopt(sockfd, SOL_CAN_J1939, SO_J1939_PROMISC, &enable, sizeof(enable)) == -1 ||
+            setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable)) == -1) {
+            return std::unexpected("Error while configuring J1939 socket");
+        }
+    }
 
     res = bind(sockfd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
     if (res == -1) {
@@ -39,4 +122,50 @@ std::expected<connection_t, std::string> connect(std::string_view interface) {
     guard.release();
     return sockfd;
 }
+
+// PDU1 PGNs (PF below 240) carry the destination address in place of the low byte, which must
+// not be compared
+static uint32_t pgn_mask(uint32_t pgn) {
+    return ((pgn >> 8) & 0xFF) < 240 ? J1939_PGN_PDU1_MAX : J1939_PGN_MAX;
+}
+
+std::expected<void, std::string> filter_pgns(connection_t conn, std::span<const uint32_t> pgns) {
+    int protocol = 0;
+    socklen_t length = sizeof(protocol);
+    if (getsockopt(conn, SOL_SOCKET, SO_PROTOCOL, &protocol, &length) == -1) {
+        return std::unexpected(socket_error("Unable to get socket protocol"));
+    }
+
+    if (protocol == CAN_J1939) {
+        std::vector<j1939_filter> filters;
+        for (uint32_t pgn : pgns) {
+            filters.push_back(j1939_filter{.name = 0,
+                                           .name_mask = 0,
+                                           .pgn = pgn,
+                                           .pgn_mask = pgn_mask(pgn),
+                                           .addr = 0,
+                                           .addr_mask = 0});
+        }
+        if (setsockopt(conn, SOL_CAN_J1939, SO_J1939_FILTER, filters.data(),
+                       static_cast<socklen_t>(filters.size() * sizeof(j1939_filter))) == -1) {
+            return std::unexpected(socket_error("Unable to set PGN filter"));
+        }
+        return {};
+    }
+
+    // The data packets of transport protocol transfers do not carry the PGN of the message, so
+    // every transfer is let through and the ones of other PGNs are dropped once reassembled
+    std::vector<uint32_t> wanted{pgn::TP_CM, pgn::TP_DT};
+    wanted.insert(wanted.end(), pgns.begin(), pgns.end());
+    std::vector<can_filter> filters;
+    for (uint32_t id : wanted) {
+        filters.push_back(can_filter{.can_id = CAN_EFF_FLAG | (id << 8),
+                                     .can_mask = CAN_EFF_FLAG | (pgn_mask(id) << 8)});
+    }
+    if (setsockopt(conn, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(),
+                   static_cast<socklen_t>(filters.size() * sizeof(can_filter))) == -1) {
+        return std::unexpected(socket_error("Unable to set PGN filter"));
+    }
+    return {};
+}
 } // namespace nmea
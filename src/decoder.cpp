@@ -0,0 +1,104 @@
+#include "nmea/decoder.hpp"
+#include <algorithm>
+#include <format>
+#include <linux/can.h>
+#include <span>
+#include <utility>
+
+namespace nmea {
+
+std::expected<void, std::string> Decoder::handle_tp_bam(uint8_t source, const can_frame &frame) {
+    // Reuse the buffer of the previous transfer from the source
+    auto [iter, inserted] = m_tp_transfers.try_emplace(
+        source, TpTransfer{.pgn = 0,
+                           .priority = 0,
+                           .destination = 0,
+                           .total_size = 0,
+                           .total_packets = 0,
+                           .next_packet = 0,
+                           .buffer = std::pmr::vector<uint8_t>(
+                               m_tp_transfers.get_allocator().resource())});
+    auto &transfer = iter->second;
+    transfer.total_size = static_cast<uint16_t>(frame.data[1] | (frame.data[2] << 8));
+    transfer.total_packets = frame.data[3];
+    transfer.priority = static_cast<uint8_t>((frame.can_id >> 26) & 0x07);
+    transfer.destination = static_cast<uint8_t>((frame.can_id >> 8) & 0xFF);
+    transfer.pgn =
+        uint32_t(frame.data[5]) | (uint32_t(frame.data[6]) << 8) | (uint32_t(frame.data[7]) << 16);
+
+    // The data packets are copied using total_size, so it must agree with the packet count
+    if (transfer.total_packets == 0 || transfer.total_packets != (transfer.total_size + 6) / 7) {
+        transfer.next_packet = 0;
+        return std::unexpected(
+            std::format("Invalid TP BAM from source {:02X}: {} bytes in {} packets", source,
+                        transfer.total_size, transfer.total_packets));
+    }
+
+    transfer.next_packet = 1;
+    transfer.buffer.resize(transfer.total_size);
+    return {};
+}
+
+std::optional<std::expected<Payload, std::string>>
+Decoder::handle_tp_dt(uint8_t source, const can_frame &frame) {
+    auto iter = m_tp_transfers.find(source);
+    if (iter == m_tp_transfers.end() || iter->second.next_packet == 0) {
+        return std::unexpected(std::format("Unexpected TP data packet from source {:02X}", source));
+    }
+    auto &transfer = iter->second;
+    const uint8_t seq = frame.data[0];
+    if (seq != transfer.next_packet) {
+        const uint8_t expected = transfer.next_packet;
+        transfer.next_packet = 0;
+        return std::unexpected(
+            std::format("Out of order TP packet: expected {}, got {}", expected, seq));
+    }
+    const size_t offset = (seq - 1) * 7;
+    const size_t bytes = std::min<size_t>(7, transfer.total_size - offset);
+    std::copy(frame.data + 1, frame.data + 1 + static_cast<ptrdiff_t>(bytes),
+              transfer.buffer.begin() + static_cast<ptrdiff_t>(offset));
+    transfer.next_packet++;
+    if (seq < transfer.total_packets) {
+        // Not all packets have been sent yet
+        return std::nullopt;
+    }
+    transfer.next_packet = 0;
+    return Payload{.pgn = transfer.pgn,
+                   .priority = transfer.priority,
+                   .source = source,
+                   .destination = transfer.destination,
+                   .data = transfer.buffer};
+}
+
+std::optional<std::expected<Payload, std::string>> Decoder::reassemble(const can_frame &frame) {
+    // Only received when asked for with `ConnectOptions::error_mask`
+    if (frame.can_id & CAN_ERR_FLAG) {
+        return std::unexpected(
+            std::format("CAN error frame with class {:03X}", frame.can_id & CAN_ERR_MASK));
+    }
+    const uint8_t source = frame.can_id & 0xFF;
+    const uint8_t pf = (frame.can_id >> 16) & 0xFF;
+
+    // Handle transport protocol
+    // Ref: https://embeddedflakes.com/j1939-transport-protocol/
+    if (pf == 0xEC && frame.data[0] == 0x20) {
+        if (auto result = handle_tp_bam(source, frame); !result) {
+            return std::unexpected(result.error());
+        }
+        return std::nullopt;
+    }
+    if (pf == 0xEB) {
+        return handle_tp_dt(source, frame);
+    }
+    const size_t length = std::min<size_t>(frame.can_dlc, CAN_MAX_DLEN);
+    // PDU1 PGNs (PF below 240) carry the destination address in place of the low byte
+    const bool pdu1 = pf < 240;
+    const uint32_t pgn = (frame.can_id >> 8) & 0x3FFFF;
+    return Payload{.pgn = pdu1 ? pgn & 0x3FF00 : pgn,
+                   .priority = static_cast<uint8_t>((frame.can_id >> 26) & 0x07),
+                   .source = source,
+                   .destination = static_cast<uint8_t>(pdu1 ? pgn & 0xFF : 0xFF),
+                   .data = std::span<const uint8_t>(frame.data, length)};
+}
+
+} // namespace nmea
@@ -1,47 +1,93 @@
 #include "nmea/device.hpp"
 #include "nmea/message.hpp"
+#include "utils.hpp"
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <format>
 #include <future>
 #include <linux/can.h>
+#include <memory>
+#include <memory_resource>
 #include <poll.h>
-#include <unistd.h>
+#include <span>
+#include <string>
 #include <utility>
+#include <vector>
 
 namespace nmea {
 
 constexpr uint32_t PGN_ADDRESS_CLAIM_PRIORITY = 6u;
+constexpr uint32_t PGN_ADDRESS_CLAIM = 60928u;
 constexpr uint32_t PGN_ADDRESS_CLAIM_PF = 0xEEu;
+constexpr uint32_t PGN_REQUEST_PF = 0xEAu;
+constexpr uint32_t PGN_ACKNOWLEDGEMENT_PF = 0xE8u;
+constexpr uint32_t PGN_HEARTBEAT = 126993u;
+constexpr uint32_t PGN_HEARTBEAT_PRIORITY = 7u;
+constexpr uint32_t PGN_PRODUCT_INFO = 126996u;
+constexpr uint32_t PGN_PRODUCT_INFO_PRIORITY = 6u;
+constexpr uint32_t PGN_CONFIGURATION_INFO = 126998u;
 constexpr uint32_t DESTINATION_GLOBAL = 0xFFu;
+// Largest payload of a TP transfer: 255 packets of 7 bytes
+constexpr size_t MAX_TP_SIZE = 255 * 7;
+// Stack arena of `send_batch()`, enough for the payloads of a burst of a few dozen messages
+constexpr size_t BATCH_STORAGE_SIZE = 4096;
 constexpr uint8_t NULL_ADDRESS = 254u;
+constexpr size_t PRODUCT_INFO_SIZE = 134;
+constexpr size_t PRODUCT_INFO_STRING_SIZE = 32;
+// Three strings of at most 70 characters, each after a length and an encoding byte, stay within
+// the 223 bytes of a Fast Packet
+constexpr size_t CONFIGURATION_INFO_STRING_SIZE = 70;
+// A Fast Packet has at most 32 frames, the index is 5 bits
+constexpr size_t MAX_FAST_PACKET_FRAMES = 32;
 
-Device::Device(connection_t conn) : m_conn(conn) {}
+Device::Device(connection_t conn) : Device(socket_transport(conn)) {}
+
+Device::Device(std::unique_ptr<Transport> transport)
+    : m_transport(std::move(transport)), m_address_map(std::make_unique<AddressMap>()),
+      m_send_queue(std::make_unique<internal::SendQueue>()) {}
 
 Device::~Device() {
     if (m_claim_future.valid()) {
         m_claim_future.wait();
     }
-    if (m_conn != -1) {
-        close(m_conn);
-    }
 }
 
 Device::Device(Device &&other) noexcept
-    : m_conn(std::exchange(other.m_conn, -1)), m_address(std::move(other.m_address)),
-      m_claim_future(std::move(other.m_claim_future)) {}
+    : m_transport(std::move(other.m_transport)), m_address_map(std::move(other.m_address_map)),
+      m_send_queue(std::move(other.m_send_queue)),
+      m_address(std::move(other.m_address)), m_name(other.m_name),
+      m_device_name(other.m_device_name), m_claim_future(std::move(other.m_claim_future)),
+      m_reader(other.m_reader.load()),
+      m_product_info(std::move(other.m_product_info)),
+      m_configuration_info(std::move(other.m_configuration_info)),
+      m_fast_packet_sequence(other.m_fast_packet_sequence),
+      m_heartbeat_interval(other.m_heartbeat_interval), m_next_heartbeat(other.m_next_heartbeat),
+      m_heartbeat_sequence(other.m_heartbeat_sequence), m_watch(std::move(other.m_watch)) {}
 
 Device &Device::operator=(Device &&other) noexcept {
     if (this != &other) {
         if (m_claim_future.valid()) {
             m_claim_future.wait();
         }
-        if (m_conn != -1) {
-            close(m_conn);
-        }
-        m_conn = std::exchange(other.m_conn, -1);
+        m_transport = std::move(other.m_transport);
+        m_address_map = std::move(other.m_address_map);
+        m_send_queue = std::move(other.m_send_queue);
         m_address = std::move(other.m_address);
+        m_name = other.m_name;
+        m_device_name = other.m_device_name;
         m_claim_future = std::move(other.m_claim_future);
+        m_reader = other.m_reader.load();
+        m_product_info = std::move(other.m_product_info);
+        m_configuration_info = std::move(other.m_configuration_info);
+        m_fast_packet_sequence = other.m_fast_packet_sequence;
+        m_heartbeat_interval = other.m_heartbeat_interval;
+        m_next_heartbeat = other.m_next_heartbeat;
+        m_heartbeat_sequence = other.m_heartbeat_sequence;
+        m_watch = std::move(other.m_watch);
     }
 
     return *this;
@@ -62,8 +108,7 @@ static uint64_t pack_name(const DeviceName &name) {
     return n;
 }
 
-static std::expected<void, std::string> send_address_claim(int sockfd, uint8_t sa,
-                                                           uint64_t packed_name) {
+static can_frame address_claim_frame(uint8_t sa, uint64_t packed_name) {
     can_frame frame{};
     frame.can_id = CAN_EFF_FLAG | (PGN_ADDRESS_CLAIM_PRIORITY << 26) |
                    (PGN_ADDRESS_CLAIM_PF << 16) | (DESTINATION_GLOBAL << 8) | sa;
@@ -71,112 +116,160 @@ static std::expected<void, std::string> send_address_claim(int sockfd, uint8_t s
     for (int i = 0; i < 8; ++i) {
         frame.data[i] = static_cast<uint8_t>(packed_name >> (i * 8));
     }
-    if (::write(sockfd, &frame, sizeof(frame)) < 0) {
+    return frame;
+}
+
+static std::expected<void, std::string> send_address_claim(Transport &transport, uint8_t sa,
+                                                           uint64_t packed_name) {
+    if (!transport.write(address_claim_frame(sa, packed_name))) {
         return std::unexpected("Failed to send address claim frame");
     }
     return {};
 }
 
-static std::expected<bool, std::string> wait_for_response(int sockfd, uint8_t &address,
-                                                          DeviceName name, uint64_t packed_name) {
-    using namespace std::chrono;
-    auto deadline = steady_clock::now() + milliseconds(250);
-    while (true) {
-        auto remaining = duration_cast<milliseconds>(deadline - steady_clock::now());
-        if (remaining.count() <= 0) {
-            break;
-        }
-
-        pollfd pfd{.fd = sockfd, .events = POLLIN, .revents = 0};
-        if (::poll(&pfd, 1, static_cast<int>(remaining.count())) <= 0) {
-            break;
-        }
-
-        can_frame frame{};
-        if (::read(sockfd, &frame, sizeof(frame)) != sizeof(frame)) {
-            continue;
-        }
+static std::expected<void, std::string> send_address_claim_request(Transport &transport) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (PGN_ADDRESS_CLAIM_PRIORITY << 26) | (PGN_REQUEST_PF << 16) |
+                   (DESTINATION_GLOBAL << 8) | NULL_ADDRESS;
+    frame.can_dlc = 3;
+    frame.data[0] = static_cast<uint8_t>(PGN_ADDRESS_CLAIM);
+    frame.data[1] = static_cast<uint8_t>(PGN_ADDRESS_CLAIM >> 8);
+    frame.data[2] = static_cast<uint8_t>(PGN_ADDRESS_CLAIM >> 16);
+    if (!transport.write(frame)) {
+        return std::unexpected("Failed to send request for address claim");
+    }
+    return {};
+}
 
-        if (((frame.can_id >> 16) & 0xFF) != PGN_ADDRESS_CLAIM_PF) {
-            continue;
-        }
-        if ((frame.can_id & 0xFF) != address) {
-            continue;
-        }
+/// Check a frame read while claiming `address`, recording it if it is an address claim. Returns
+/// true if a device with a higher priority NAME claimed `address`
+static std::expected<bool, std::string> lost_claim(Transport &transport, AddressMap &map,
+                                                   const can_frame &frame, uint8_t address,
+                                                   DeviceName name, uint64_t packed_name) {
+    if (((frame.can_id >> 16) & 0xFF) != PGN_ADDRESS_CLAIM_PF) {
+        return false;
+    }
+    map.observe(frame);
+    if ((frame.can_id & 0xFF) != address) {
+        return false;
+    }
 
-        uint64_t res_name = 0;
-        for (int i = 0; i < 8; ++i) {
-            res_name |= static_cast<uint64_t>(frame.data[i]) << (i * 8);
-        }
+    uint64_t res_name = 0;
+    for (int i = 0; i < 8; ++i) {
+        res_name |= static_cast<uint64_t>(frame.data[i]) << (i * 8);
+    }
 
-        if (res_name < packed_name) {
-            if (name.arbitrary_address_capable) {
-                address = static_cast<uint8_t>((address + 1) % 252);
-                return true;
-            } else {
-                auto _ = send_address_claim(sockfd, NULL_ADDRESS, packed_name);
-                return std::unexpected("Address conflict. Device not arbitrary address capable");
-            }
+    if (res_name < packed_name) {
+        if (name.arbitrary_address_capable) {
+            return true;
+        } else {
+            auto _ = send_address_claim(transport, NULL_ADDRESS, packed_name);
+            return std::unexpected("Address conflict. Device not arbitrary address capable");
         }
     }
-
     return false;
 }
 
-static std::expected<uint8_t, std::string> start_address_claim(int sockfd, DeviceName name) {
+Task<std::expected<void, std::string>> Device::claim_address(DeviceName name) {
+    Transport &transport = *m_transport;
+    AddressMap &map = *m_address_map;
     auto packed_name = pack_name(name);
-    uint8_t address = static_cast<uint8_t>(name.unique_number % 252);
-    const uint8_t start_address = address;
+    const auto preferred = static_cast<uint8_t>(name.unique_number % (MAX_CLAIMABLE_ADDRESS + 1));
 
-    do {
-        if (auto sent = send_address_claim(sockfd, address, packed_name); !sent) {
-            return std::unexpected(sent.error());
+    // Every device answers the request with its own claim during our first claim window, so a
+    // conflict there leaves the map complete enough to pick a free address straight away
+    if (auto sent = send_address_claim_request(transport); !sent) {
+        co_return std::unexpected(sent.error());
+    }
+
+    // A device that is not arbitrary address capable may only ever claim its preferred address
+    std::optional<uint8_t> address = preferred;
+    if (name.arbitrary_address_capable) {
+        address = map.free_address(preferred, packed_name);
+    } else if (map.taken(preferred, packed_name)) {
+        auto _ = send_address_claim(transport, NULL_ADDRESS, packed_name);
+        co_return std::unexpected("Address conflict. Device not arbitrary address capable");
+    }
+    while (address) {
+        if (auto sent = send_address_claim(transport, *address, packed_name); !sent) {
+            co_return std::unexpected(sent.error());
         }
-        auto response = wait_for_response(sockfd, address, name, packed_name);
-        if (!response) {
-            return std::unexpected(response.error());
+
+        // Listen for a claim window, recording every address claim seen
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(250);
+        bool lost = false;
+        while (!lost && co_await frame_available(transport, deadline)) {
+            can_frame frame{};
+            if (!transport.read(frame)) {
+                continue;
+            }
+            auto response = lost_claim(transport, map, frame, *address, name, packed_name);
+            if (!response) {
+                co_return std::unexpected(response.error());
+            }
+            lost = *response;
         }
-        if (!response.value()) {
-            return address;
+        if (!lost) {
+            map.record(*address, packed_name);
+            m_name = packed_name;
+            m_device_name = name;
+            m_address = *address;
+            co_return std::expected<void, std::string>{};
         }
-    } while (address != start_address);
+        address = map.free_address(
+            static_cast<uint8_t>((*address + 1) % (MAX_CLAIMABLE_ADDRESS + 1)), packed_name);
+    }
+
+    co_return std::unexpected("No available addresses on the network");
+}
 
-    return std::unexpected("No available addresses on the network");
+std::expected<void, std::string> Device::begin_reading(Reader reader) {
+    auto current = Reader::None;
+    if (m_reader.compare_exchange_strong(current, reader)) {
+        return {};
+    }
+    if (current == Reader::Claim) {
+        return std::unexpected("Address claim already in progress");
+    }
+    return std::unexpected("Device is already processing frames");
 }
 
 std::shared_future<std::expected<void, std::string>> Device::claim(DeviceName name) {
-    if (m_claim_future.valid() &&
-        m_claim_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    if (auto reading = begin_reading(Reader::Claim); !reading) {
         std::promise<std::expected<void, std::string>> p;
-        p.set_value(std::unexpected<std::string>("Address claim already in progress"));
+        p.set_value(std::unexpected(reading.error()));
         return p.get_future().share();
     }
-    m_claim_future =
-        std::async(std::launch::async, [this, name]() -> std::expected<void, std::string> {
-            auto result = start_address_claim(m_conn, name);
-            if (!result) {
-                return std::unexpected(result.error());
-            }
-            m_address = result.value();
-            return {};
-        }).share();
+    m_claim_future = std::async(std::launch::async, [this, name] {
+                         auto done = scope_exit([this] { m_reader = Reader::None; });
+                         Executor executor;
+                         return executor.block_on(claim_address(name));
+                     }).share();
     return m_claim_future;
 }
 
-static std::expected<void, std::string> send_single_frame(int sockfd, uint32_t can_id,
-                                                          const std::vector<uint8_t> &data) {
-    can_frame frame{};
-    frame.can_id = can_id;
-    frame.can_dlc = static_cast<uint8_t>(data.size());
-    std::copy(data.begin(), data.end(), frame.data);
-    if (::write(sockfd, &frame, sizeof(frame)) < 0) {
-        return std::unexpected("Failed to send message");
+Task<std::expected<void, std::string>> Device::claim_async(DeviceName name) {
+    if (auto reading = begin_reading(Reader::Claim); !reading) {
+        co_return std::unexpected(reading.error());
     }
-    return {};
+    // Also cleared if the coroutine is destroyed before it completes
+    auto done = scope_exit([this] { m_reader = Reader::None; });
+    co_return co_await claim_address(name);
 }
 
-static std::expected<void, std::string> send_tp(int sockfd, uint8_t priority, uint8_t source,
-                                                uint32_t pgn, const std::vector<uint8_t> &data) {
+// Append the frames of a message: a single frame, or a TP BAM and its data packets
+static void append_frames(std::vector<can_frame> &frames, uint8_t priority, uint8_t source,
+                          uint32_t pgn, std::span<const uint8_t> data) {
+    if (data.size() <= 8) {
+        can_frame frame{};
+        frame.can_id =
+            CAN_EFF_FLAG | (uint32_t(priority) << 26) | (pgn << 8) | uint32_t(source);
+        frame.can_dlc = static_cast<uint8_t>(data.size());
+        std::copy(data.begin(), data.end(), frame.data);
+        frames.push_back(frame);
+        return;
+    }
+
     const auto total_packets = static_cast<uint8_t>((data.size() + 6) / 7);
 
     can_frame bam{};
@@ -190,9 +283,7 @@ static std::expected<void, std::string> send_tp(int sockfd, uint8_t priority, ui
     bam.data[5] = static_cast<uint8_t>(pgn);
     bam.data[6] = static_cast<uint8_t>(pgn >> 8);
     bam.data[7] = static_cast<uint8_t>(pgn >> 16);
-    if (::write(sockfd, &bam, sizeof(bam)) < 0) {
-        return std::unexpected("Failed to send TP BAM frame");
-    }
+    frames.push_back(bam);
 
     for (uint8_t seq = 1; seq <= total_packets; seq++) {
         can_frame dt{};
@@ -205,25 +296,166 @@ static std::expected<void, std::string> send_tp(int sockfd, uint8_t priority, ui
             const size_t idx = offset + i;
             dt.data[i + 1] = idx < data.size() ? data[idx] : 0xFF;
         }
-        if (::write(sockfd, &dt, sizeof(dt)) < 0) {
-            return std::unexpected("Failed to send TP data frame");
+        frames.push_back(dt);
+    }
+}
+
+namespace internal {
+struct OutgoingMessage {
+    pmr::SerializedMessage message;
+    uint8_t priority;
+};
+
+struct SendRequest {
+    std::span<const OutgoingMessage> messages;
+    uint8_t source;
+    /// Frames written as they are, after the messages, eg. the answers to ISO Requests
+    std::span<const can_frame> frames{};
+    SendRequest *next = nullptr;
+    /// Number of messages written in full, in order, and the error that stopped the others
+    size_t sent = 0;
+    std::expected<void, std::string> result{};
+    std::atomic<bool> done = false;
+};
+
+// Lock-free stack of the requests waiting to be written. Whichever producer sets `writing` becomes
+// the writer and drains the stack for everybody, so one thread writes at a time and a transfer is
+// never interleaved with another. The requests live on the stacks of their producers, which wait
+// for `completed` to move on before returning
+struct SendQueue {
+    std::atomic<SendRequest *> head = nullptr;
+    std::atomic<bool> writing = false;
+    std::atomic<uint64_t> completed = 0;
+    // Only used by the writer, so that its buffers are reused from one request to the next
+    Packet packet{};
+    std::vector<can_frame> frames{};
+    // Number of frames up to the end of each message of the request
+    std::vector<size_t> ends{};
+};
+} // namespace internal
+
+static void write_frames(Transport &transport, internal::SendRequest &request) {
+    auto written = transport.write_batch(request.frames);
+    if (!written) {
+        request.result = std::unexpected(written.error());
+    } else if (*written < request.frames.size()) {
+        request.result = std::unexpected(
+            std::format("Only {} of {} frames were written", *written, request.frames.size()));
+    }
+}
+
+static void write_request(Transport &transport, internal::SendQueue &queue,
+                          internal::SendRequest &request) {
+    if (!request.frames.empty()) {
+        write_frames(transport, request);
+        return;
+    }
+    if (transport.reassembles()) {
+        // The transport segments the packets itself, with ETP beyond the TP limit
+        Packet &packet = queue.packet;
+        for (const auto &outgoing : request.messages) {
+            packet.pgn = outgoing.message.pgn;
+            packet.priority = outgoing.priority;
+            packet.source = request.source;
+            packet.destination = static_cast<uint8_t>(DESTINATION_GLOBAL);
+            packet.data.assign(outgoing.message.data.begin(), outgoing.message.data.end());
+            request.result = transport.write_packet(packet);
+            if (!request.result) {
+                return;
+            }
+            request.sent++;
         }
+        return;
     }
 
-    return {};
+    // Every frame of the request is handed to the transport at once, eg. a single `sendmmsg()`
+    queue.frames.clear();
+    queue.ends.clear();
+    for (const auto &outgoing : request.messages) {
+        append_frames(queue.frames, outgoing.priority, request.source, outgoing.message.pgn,
+                      outgoing.message.data);
+        queue.ends.push_back(queue.frames.size());
+    }
+    auto written = transport.write_batch(queue.frames);
+    if (!written) {
+        request.result = std::unexpected(written.error());
+        return;
+    }
+    // A message is only sent once its last frame was written
+    request.sent = static_cast<size_t>(std::ranges::upper_bound(queue.ends, *written) -
+                                       queue.ends.begin());
+    if (*written < queue.frames.size()) {
+        request.result = std::unexpected(
+            std::format("Only {} of {} frames were written", *written, queue.frames.size()));
+    }
+}
+
+static void drain(Transport &transport, internal::SendQueue &queue) {
+    while (internal::SendRequest *batch = queue.head.exchange(nullptr)) {
+        // The stack holds the newest request first
+        internal::SendRequest *ordered = nullptr;
+        while (batch) {
+            auto *next = batch->next;
+            batch->next = ordered;
+            ordered = batch;
+            batch = next;
+        }
+        while (ordered) {
+            // The producer may return as soon as its request is done
+            auto *next = ordered->next;
+            write_request(transport, queue, *ordered);
+            ordered->done.store(true, std::memory_order_release);
+            ordered = next;
+        }
+        queue.completed.fetch_add(1, std::memory_order_release);
+        queue.completed.notify_all();
+    }
+}
+
+// Queue `request` and wait until it has been written, by this thread or another
+static void submit(Transport &transport, internal::SendQueue &queue,
+                   internal::SendRequest &request) {
+    auto *head = queue.head.load(std::memory_order_relaxed);
+    do {
+        request.next = head;
+    } while (!queue.head.compare_exchange_weak(head, &request));
+
+    while (true) {
+        if (!queue.writing.exchange(true)) {
+            drain(transport, queue);
+            queue.writing.store(false);
+            // A request pushed after the last drain may belong to a producer that saw us writing
+            // and is waiting for us
+            if (queue.head.load() != nullptr) {
+                continue;
+            }
+            break;
+        }
+        const auto completed = queue.completed.load(std::memory_order_acquire);
+        if (request.done.load(std::memory_order_acquire)) {
+            break;
+        }
+        queue.completed.wait(completed, std::memory_order_acquire);
+    }
 }
 
 std::expected<void, std::string> Device::send(const NmeaMessage &msg, uint8_t priority) {
     if (!m_address) {
         return std::unexpected("Device has not claimed an address");
     }
-    auto serialized = serialize(msg);
-    const uint32_t can_id =
-        CAN_EFF_FLAG | (uint32_t(priority) << 26) | (serialized.pgn << 8) | uint32_t(*m_address);
-    if (serialized.data.size() <= 8) {
-        return send_single_frame(m_conn, can_id, serialized.data);
-    }
-    return send_tp(m_conn, priority, *m_address, serialized.pgn, serialized.data);
+    // Serialize on the stack. Only payloads beyond the size of a TP transfer go to the heap
+    std::array<std::byte, MAX_TP_SIZE> storage;
+    std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size());
+    const internal::OutgoingMessage outgoing{
+        .message = serialize(msg, std::pmr::polymorphic_allocator<uint8_t>(&arena)),
+        .priority = priority,
+    };
+    internal::SendRequest request{
+        .messages = std::span(&outgoing, 1),
+        .source = *m_address,
+    };
+    submit(*m_transport, *m_send_queue, request);
+    return std::move(request.result);
 }
 
 std::expected<void, std::string> Device::send(const NmeaMessage &msg) {
@@ -231,4 +463,326 @@ std::expected<void, std::string> Device::send(const NmeaMessage &msg) {
     return send(msg, priority);
 }
 
+std::expected<size_t, std::string> Device::send_batch(std::span<const NmeaMessage> messages) {
+    if (!m_address) {
+        return std::unexpected("Device has not claimed an address");
+    }
+    // A burst of updates fits on the stack, larger batches continue on the heap
+    std::array<std::byte, BATCH_STORAGE_SIZE> storage;
+    std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size());
+    std::pmr::vector<internal::OutgoingMessage> outgoing(&arena);
+    outgoing.reserve(messages.size());
+    for (const auto &msg : messages) {
+        outgoing.push_back({
+            .message = serialize(msg, std::pmr::polymorphic_allocator<uint8_t>(&arena)),
+            .priority =
+                std::visit([](const auto &m) { return message::default_priority(m); }, msg),
+        });
+    }
+    internal::SendRequest request{
+        .messages = outgoing,
+        .source = *m_address,
+    };
+    submit(*m_transport, *m_send_queue, request);
+    if (!request.result && request.sent == 0) {
+        return std::unexpected(std::move(request.result.error()));
+    }
+    return request.sent;
+}
+
+Task<std::expected<void, std::string>> Device::send_async(NmeaMessage msg) {
+    if (m_transport->fd() >= 0) {
+        co_await writable(m_transport->fd());
+    }
+    co_return send(msg);
+}
+
+Task<std::expected<void, std::string>> Device::send_async(NmeaMessage msg, uint8_t priority) {
+    if (m_transport->fd() >= 0) {
+        co_await writable(m_transport->fd());
+    }
+    co_return send(msg, priority);
+}
+
+// ==================================== Network management ===================================== //
+// Fast Packet: the first byte of every frame holds the sequence counter in its upper 3 bits and
+// the frame index in the lower 5. The first frame also carries the total length. The source
+// address and the sequence are filled in when sending
+static void fast_packet_frames(uint32_t pgn, std::span<const uint8_t> data,
+                               std::vector<can_frame> &frames) {
+    frames.clear();
+    size_t position = 0;
+    for (size_t index = 0; index == 0 || position < data.size(); index++) {
+        can_frame frame{};
+        frame.can_id = CAN_EFF_FLAG | (PGN_PRODUCT_INFO_PRIORITY << 26) | (pgn << 8);
+        frame.can_dlc = 8;
+        frame.data[0] = static_cast<uint8_t>(index);
+        size_t byte = 1;
+        if (index == 0) {
+            frame.data[byte++] = static_cast<uint8_t>(data.size());
+        }
+        for (; byte < 8; byte++) {
+            frame.data[byte] = position < data.size() ? data[position++] : 0xFF;
+        }
+        frames.push_back(frame);
+    }
+}
+
+void Device::set_product_info(const ProductInfo &info) {
+    std::array<uint8_t, PRODUCT_INFO_SIZE> data{};
+    data[0] = static_cast<uint8_t>(info.nmea2000_version);
+    data[1] = static_cast<uint8_t>(info.nmea2000_version >> 8);
+    data[2] = static_cast<uint8_t>(info.product_code);
+    data[3] = static_cast<uint8_t>(info.product_code >> 8);
+    size_t offset = 4;
+    for (const std::string *field :
+         {&info.model_id, &info.software_version, &info.model_version, &info.serial_code}) {
+        auto end = std::copy_n(field->begin(), std::min(field->size(), PRODUCT_INFO_STRING_SIZE),
+                               data.begin() + offset);
+        std::fill(end, data.begin() + offset + PRODUCT_INFO_STRING_SIZE, 0xFF);
+        offset += PRODUCT_INFO_STRING_SIZE;
+    }
+    data[offset++] = info.certification_level;
+    data[offset] = info.load_equivalency;
+
+    fast_packet_frames(PGN_PRODUCT_INFO, data, m_product_info);
+}
+
+void Device::set_configuration_info(const ConfigurationInfo &info) {
+    std::vector<uint8_t> data;
+    for (const std::string *field : {&info.installation_description1,
+                                     &info.installation_description2,
+                                     &info.manufacturer_information}) {
+        // Variable length string: the length including both header bytes, then 1 for ASCII
+        const size_t length = std::min(field->size(), CONFIGURATION_INFO_STRING_SIZE);
+        data.push_back(static_cast<uint8_t>(length + 2));
+        data.push_back(1);
+        data.insert(data.end(), field->data(), field->data() + length);
+    }
+    fast_packet_frames(PGN_CONFIGURATION_INFO, data, m_configuration_info);
+}
+
+void Device::set_heartbeat_interval(std::chrono::milliseconds interval) {
+    m_heartbeat_interval = interval;
+    // Announce the new interval with the next call to `heartbeat()`
+    m_next_heartbeat = Clock::time_point{};
+}
+
+std::expected<void, std::string> Device::handle(const can_frame &frame) {
+    // Requests are the only frames answered, so everything else is rejected by this one test
+    if (((frame.can_id >> 16) & 0xFF) != PGN_REQUEST_PF || !(frame.can_id & CAN_EFF_FLAG) ||
+        frame.can_dlc < 3 || !m_address) {
+        return {};
+    }
+    const auto destination = static_cast<uint8_t>(frame.can_id >> 8);
+    if (destination != DESTINATION_GLOBAL && destination != *m_address) {
+        return {};
+    }
+    const uint32_t pgn = frame.data[0] | (uint32_t(frame.data[1]) << 8) |
+                         (uint32_t(frame.data[2]) << 16);
+    return answer_request(pgn, static_cast<uint8_t>(frame.can_id),
+                          destination == DESTINATION_GLOBAL);
+}
+
+std::expected<void, std::string> Device::answer_request(uint32_t pgn, uint8_t requester,
+                                                        bool global) {
+    const uint8_t address = *m_address;
+    switch (pgn) {
+    case PGN_ADDRESS_CLAIM: {
+        const can_frame claim = address_claim_frame(address, m_name);
+        if (!send_frames(std::span(&claim, 1))) {
+            return std::unexpected("Failed to send address claim frame");
+        }
+        return {};
+    }
+    case PGN_HEARTBEAT:
+        // Answered out of schedule, the next one stays due at the same time
+        return send_heartbeat();
+    case PGN_PRODUCT_INFO:
+        if (m_product_info.empty()) {
+            break;
+        }
+        if (!send_fast_packet(m_product_info)) {
+            return std::unexpected("Failed to send product information");
+        }
+        return {};
+    case PGN_CONFIGURATION_INFO:
+        if (m_configuration_info.empty()) {
+            break;
+        }
+        if (!send_fast_packet(m_configuration_info)) {
+            return std::unexpected("Failed to send configuration information");
+        }
+        return {};
+    default:
+        break;
+    }
+
+    // Only requests addressed to this device are rejected, global ones would cause a NACK storm
+    if (global) {
+        return {};
+    }
+    can_frame nack{};
+    nack.can_id = CAN_EFF_FLAG | (PGN_ADDRESS_CLAIM_PRIORITY << 26) |
+                  (PGN_ACKNOWLEDGEMENT_PF << 16) | (DESTINATION_GLOBAL << 8) | address;
+    nack.can_dlc = 8;
+    nack.data[0] = 1; // Negative acknowledgement
+    nack.data[1] = 0xFF;
+    nack.data[2] = 0xFF;
+    nack.data[3] = 0xFF;
+    nack.data[4] = requester;
+    nack.data[5] = static_cast<uint8_t>(pgn);
+    nack.data[6] = static_cast<uint8_t>(pgn >> 8);
+    nack.data[7] = static_cast<uint8_t>(pgn >> 16);
+    if (!send_frames(std::span(&nack, 1))) {
+        return std::unexpected("Failed to send negative acknowledgement");
+    }
+    return {};
+}
+
+std::expected<void, std::string> Device::send_frames(std::span<const can_frame> frames) {
+    internal::SendRequest request{
+        .messages = {},
+        .source = *m_address,
+        .frames = frames,
+    };
+    submit(*m_transport, *m_send_queue, request);
+    return std::move(request.result);
+}
+
+std::expected<void, std::string> Device::send_fast_packet(std::span<const can_frame> frames) {
+    std::array<can_frame, MAX_FAST_PACKET_FRAMES> buffer;
+    const auto sequence = static_cast<uint8_t>(m_fast_packet_sequence++ << 5);
+    for (size_t i = 0; i < frames.size(); i++) {
+        buffer[i] = frames[i];
+        buffer[i].can_id |= *m_address;
+        buffer[i].data[0] |= sequence;
+    }
+    return send_frames(std::span(buffer.data(), frames.size()));
+}
+
+std::expected<void, std::string> Device::send_heartbeat() {
+    const auto interval = static_cast<uint16_t>(
+        std::min<std::chrono::milliseconds::rep>(m_heartbeat_interval.count() / 10, 0xFFFE));
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (PGN_HEARTBEAT_PRIORITY << 26) | (PGN_HEARTBEAT << 8) |
+                   uint32_t(*m_address);
+    frame.can_dlc = 8;
+    frame.data[0] = static_cast<uint8_t>(interval);
+    frame.data[1] = static_cast<uint8_t>(interval >> 8);
+    frame.data[2] = m_heartbeat_sequence;
+    // Both controllers error active and the equipment operational, reserved bits set
+    frame.data[3] = 0xC0;
+    std::fill(frame.data + 4, frame.data + 8, 0xFF);
+    if (!send_frames(std::span(&frame, 1))) {
+        return std::unexpected("Failed to send heartbeat");
+    }
+    m_heartbeat_sequence = static_cast<uint8_t>((m_heartbeat_sequence + 1) % 253);
+    return {};
+}
+
+std::expected<Device::Clock::time_point, std::string> Device::heartbeat(Clock::time_point now) {
+    if (!m_address) {
+        return Clock::time_point::max();
+    }
+    if (now >= m_next_heartbeat) {
+        if (auto sent = send_heartbeat(); !sent) {
+            return std::unexpected(sent.error());
+        }
+        m_next_heartbeat = now + m_heartbeat_interval;
+    }
+    return m_next_heartbeat;
+}
+
+std::expected<void, std::string> Device::process(std::chrono::milliseconds timeout) {
+    using namespace std::chrono;
+    if (auto reading = begin_reading(Reader::Process); !reading) {
+        return std::unexpected(reading.error());
+    }
+    auto done = scope_exit([this] { m_reader = Reader::None; });
+    const auto deadline = Clock::now() + timeout;
+    while (true) {
+        auto link = update_link();
+        if (!link) {
+            return std::unexpected(link.error());
+        }
+        const bool down = *link == InterfaceMonitor::LinkState::Down;
+        const auto now = Clock::now();
+        auto until = deadline;
+        if (!down) {
+            auto next = heartbeat(now);
+            if (!next) {
+                return std::unexpected(next.error());
+            }
+            until = std::min(deadline, *next);
+        }
+        const auto wait = ceil<milliseconds>(std::max(until - now, Clock::duration::zero()));
+        if (!wait_frame(wait) || down) {
+            if (Clock::now() >= deadline) {
+                return {};
+            }
+            continue;
+        }
+
+        can_frame frame{};
+        if (auto result = m_transport->read(frame); !result) {
+            // Unless the monitor saw the interface go down, in which case the next round waits
+            // for it to come back
+            auto state = update_link();
+            if (!state) {
+                return std::unexpected(state.error());
+            }
+            if (*state != InterfaceMonitor::LinkState::Up) {
+                continue;
+            }
+            return std::unexpected(result.error());
+        }
+        if (auto result = handle(frame); !result) {
+            return std::unexpected(result.error());
+        }
+    }
+}
+
+// ======================================== Reconnection ======================================== //
+std::expected<void, std::string> Device::set_interface_monitor(InterfaceMonitor *monitor) {
+    m_watch.reset();
+    if (!monitor) {
+        return {};
+    }
+    auto watch = monitor->watch(*m_transport);
+    if (!watch) {
+        return std::unexpected(watch.error());
+    }
+    m_watch = std::move(*watch);
+    return {};
+}
+
+std::expected<InterfaceMonitor::LinkState, std::string> Device::update_link() {
+    if (!m_watch) {
+        return InterfaceMonitor::LinkState::Up;
+    }
+    auto state = m_watch->update();
+    if (!state) {
+        return state;
+    }
+    // The other devices may have taken the address meanwhile, eg. if the whole bus was reset
+    if (*state == InterfaceMonitor::LinkState::Reconnected && m_device_name) {
+        Executor executor;
+        if (auto claimed = executor.block_on(claim_address(*m_device_name)); !claimed) {
+            return std::unexpected(claimed.error());
+        }
+    }
+    return state;
+}
+
+bool Device::wait_frame(std::chrono::milliseconds timeout) {
+    if (!m_watch) {
+        return m_transport->wait(timeout);
+    }
+    // The watch also wakes up on link changes, which are handled by the next `update_link()`
+    pollfd pfd{.fd = m_watch->fd(), .events = POLLIN, .revents = 0};
+    return ::poll(&pfd, 1, static_cast<int>(timeout.count())) > 0 &&
+           m_transport->wait(std::chrono::milliseconds(0));
+}
+
 } // namespace nmea
@@ -0,0 +1,294 @@
+#include "nmea/interface_monitor.hpp"
+#include "utils.hpp"
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <poll.h>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace nmea {
+static std::string error_message(std::string_view what) {
+    return std::format("{}: {}", what, std::strerror(errno));
+}
+
+static bool is_up(unsigned int flags) { return (flags & IFF_UP) && (flags & IFF_RUNNING); }
+
+// Current state of the interface, false if it does not exist
+static bool query_up(int fd, const std::string &interface) {
+    ifreq ifr{};
+    interface.copy(ifr.ifr_name, IFNAMSIZ - 1);
+    return ioctl(fd, SIOCGIFFLAGS, &ifr) == 0 && is_up(static_cast<uint16_t>(ifr.ifr_flags));
+}
+
+// ====================================== Monitor Lifetime ====================================== //
+std::expected<std::unique_ptr<InterfaceMonitor>, std::string>
+InterfaceMonitor::create(std::string interface, ConnectOptions options) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd == -1) {
+        return std::unexpected(error_message("Unable to open netlink socket"));
+    }
+    auto guard = scope_exit([&] { close(fd); });
+
+    sockaddr_nl addr{};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK;
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == -1) {
+        return std::unexpected(error_message("Unable to subscribe to link events"));
+    }
+    int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd == -1) {
+        return std::unexpected(error_message("Unable to create event file descriptor"));
+    }
+
+    guard.release();
+    return std::unique_ptr<InterfaceMonitor>(
+        new InterfaceMonitor(fd, wake_fd, std::move(interface), std::move(options)));
+}
+
+InterfaceMonitor::InterfaceMonitor(int netlink_fd, int wake_fd, std::string interface,
+                                   ConnectOptions options)
+    : m_netlink_fd(netlink_fd), m_wake_fd(wake_fd), m_interface(std::move(interface)),
+      m_options(std::move(options)) {
+    // Only queried once subscribed, so that no change is missed in between
+    m_up = query_up(m_netlink_fd, m_interface);
+    m_thread = std::thread([this] { run(); });
+}
+
+InterfaceMonitor::InterfaceMonitor(std::string interface, ConnectOptions options)
+    : m_interface(std::move(interface)), m_options(std::move(options)) {}
+
+InterfaceMonitor::~InterfaceMonitor() {
+    if (m_thread.joinable()) {
+        m_stopping = true;
+        wake();
+        m_thread.join();
+    }
+    if (m_netlink_fd != -1) {
+        close(m_netlink_fd);
+    }
+    if (m_wake_fd != -1) {
+        close(m_wake_fd);
+    }
+}
+
+void InterfaceMonitor::wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(m_wake_fd, &one, sizeof(one));
+}
+
+// ========================================= Link State ========================================= //
+bool InterfaceMonitor::up() const {
+    std::lock_guard lock(m_mutex);
+    return m_up;
+}
+
+uint64_t InterfaceMonitor::generation() const {
+    std::lock_guard lock(m_mutex);
+    return m_generation;
+}
+
+void InterfaceMonitor::wait_up() const {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_up; });
+}
+
+bool InterfaceMonitor::wait_up(std::chrono::milliseconds timeout) const {
+    std::unique_lock lock(m_mutex);
+    return m_cv.wait_for(lock, timeout, [this] { return m_up; });
+}
+
+std::expected<connection_t, std::string> InterfaceMonitor::connect() const {
+    return nmea::connect(m_interface, m_options);
+}
+
+void InterfaceMonitor::set_state(bool up, bool removed) {
+    std::lock_guard lock(m_mutex);
+    const bool ended = (m_up && !up) || removed;
+    if (ended) {
+        m_generation++;
+    }
+    if (ended || m_up != up) {
+        const uint64_t one = 1;
+        for (int fd : m_watch_fds) {
+            [[maybe_unused]] auto written = ::write(fd, &one, sizeof(one));
+        }
+    }
+    m_up = up;
+    m_cv.notify_all();
+}
+
+// ============================================ Watch =========================================== //
+std::expected<std::unique_ptr<InterfaceMonitor::Watch>, std::string>
+InterfaceMonitor::watch(Transport &transport) {
+    if (transport.fd() == -1) {
+        return std::unexpected("Transport has no socket to watch");
+    }
+    int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd == -1) {
+        return std::unexpected(error_message("Unable to create event file descriptor"));
+    }
+    auto event_guard = scope_exit([&] { close(event_fd); });
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        return std::unexpected(error_message("Unable to create epoll instance"));
+    }
+    auto epoll_guard = scope_exit([&] { close(epoll_fd); });
+
+    for (int fd : {event_fd, transport.fd()}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            return std::unexpected(error_message("Unable to watch the socket"));
+        }
+    }
+
+    event_guard.release();
+    epoll_guard.release();
+    return std::unique_ptr<Watch>(new Watch(*this, transport, event_fd, epoll_fd));
+}
+
+InterfaceMonitor::Watch::Watch(InterfaceMonitor &monitor, Transport &transport, int event_fd,
+                               int epoll_fd)
+    : m_monitor(monitor), m_transport(transport), m_event_fd(event_fd), m_epoll_fd(epoll_fd) {
+    std::lock_guard lock(m_monitor.m_mutex);
+    m_generation = m_monitor.m_generation;
+    m_monitor.m_watch_fds.push_back(m_event_fd);
+}
+
+InterfaceMonitor::Watch::~Watch() {
+    {
+        std::lock_guard lock(m_monitor.m_mutex);
+        std::erase(m_monitor.m_watch_fds, m_event_fd);
+    }
+    close(m_epoll_fd);
+    close(m_event_fd);
+}
+
+std::expected<InterfaceMonitor::LinkState, std::string> InterfaceMonitor::Watch::update() {
+    // Cleared before the state is read, so that a change from then on is signalled again
+    uint64_t count = 0;
+    [[maybe_unused]] auto nbytes = ::read(m_event_fd, &count, sizeof(count));
+
+    uint64_t generation = 0;
+    bool up = false;
+    {
+        std::lock_guard lock(m_monitor.m_mutex);
+        generation = m_monitor.m_generation;
+        up = m_monitor.m_up;
+    }
+    if (generation == m_generation) {
+        return LinkState::Up;
+    }
+    if (m_socket_watched) {
+        // The socket may stay readable with frames from before the interface went down, which
+        // must not wake the reader until there is a new one
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, m_transport.fd(), nullptr);
+        m_socket_watched = false;
+    }
+    if (!up) {
+        return LinkState::Down;
+    }
+
+    auto reconnected = reconnect();
+    if (!reconnected) {
+        // Signalled again, so that a reader waiting on the watch retries instead of blocking
+        const uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(m_event_fd, &one, sizeof(one));
+        return std::unexpected(reconnected.error());
+    }
+    m_generation = generation;
+    return LinkState::Reconnected;
+}
+
+std::expected<void, std::string> InterfaceMonitor::Watch::reconnect() {
+    auto conn = m_monitor.connect();
+    if (!conn) {
+        return std::unexpected(conn.error());
+    }
+    if (auto reconnected = m_transport.reconnect(*conn); !reconnected) {
+        return reconnected;
+    }
+    // The descriptor is the same, but it refers to the new socket, which has to be added again
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = m_transport.fd();
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_transport.fd(), &event) == -1) {
+        return std::unexpected(error_message("Unable to watch the socket"));
+    }
+    m_socket_watched = true;
+    return {};
+}
+
+// ========================================= Link Events ======================================== //
+void InterfaceMonitor::run() {
+    std::array<pollfd, 2> fds{
+        pollfd{.fd = m_netlink_fd, .events = POLLIN, .revents = 0},
+        pollfd{.fd = m_wake_fd, .events = POLLIN, .revents = 0},
+    };
+    while (!m_stopping) {
+        if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR) {
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t count = 0;
+            [[maybe_unused]] auto nbytes = ::read(m_wake_fd, &count, sizeof(count));
+        }
+        if (fds[0].revents & POLLIN) {
+            read_events();
+        }
+    }
+}
+
+void InterfaceMonitor::read_events() {
+    alignas(nlmsghdr) std::array<char, 16 * 1024> buffer;
+    while (true) {
+        const auto received = recv(m_netlink_fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (received < 0) {
+            if (errno == ENOBUFS) {
+                // The socket overflowed and events were lost, possibly a removal and return of the
+                // interface, so the state is queried again and the sockets are replaced regardless
+                set_state(query_up(m_netlink_fd, m_interface), true);
+                continue;
+            }
+            return;
+        }
+
+        auto length = static_cast<int>(received);
+        for (auto *header = reinterpret_cast<nlmsghdr *>(buffer.data()); NLMSG_OK(header, length);
+             header = NLMSG_NEXT(header, length)) {
+            if (header->nlmsg_type != RTM_NEWLINK && header->nlmsg_type != RTM_DELLINK) {
+                continue;
+            }
+            const auto *info = static_cast<const ifinfomsg *>(NLMSG_DATA(header));
+            std::string_view name;
+            auto attributes_length = static_cast<int>(IFLA_PAYLOAD(header));
+            for (const auto *attribute = IFLA_RTA(info); RTA_OK(attribute, attributes_length);
+                 attribute = RTA_NEXT(attribute, attributes_length)) {
+                if (attribute->rta_type == IFLA_IFNAME) {
+                    name = static_cast<const char *>(RTA_DATA(attribute));
+                }
+            }
+            if (name != m_interface) {
+                continue;
+            }
+            // A removed interface may come back under the same name but with a new index, which
+            // the sockets bound to the old one never see, even if it was not up when removed
+            const bool removed = header->nlmsg_type == RTM_DELLINK;
+            set_state(!removed && is_up(info->ifi_flags), removed);
+        }
+    }
+}
+
+} // namespace nmea
@@ -0,0 +1,376 @@
+#include "nmea/json.hpp"
+#include "nmea/visit.hpp"
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace nmea {
+
+// ======================================= Output Helpers ======================================= //
+template <typename T> static void append_number(std::string &out, T value) {
+    if constexpr (std::is_floating_point_v<T>) {
+        // JSON has no representation for them
+        if (!std::isfinite(value)) {
+            out += "null";
+            return;
+        }
+    }
+    std::array<char, 32> buf;
+    auto [end, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+    out.append(buf.data(), end);
+}
+
+static void append_padded(std::string &out, int value, int width) {
+    std::array<char, 8> buf;
+    auto [end, ec] = std::to_chars(buf.data(), buf.data() + buf.size(), value);
+    for (auto digits = end - buf.data(); digits < width; digits++) {
+        out += '0';
+    }
+    out.append(buf.data(), end);
+}
+
+static void append_string(std::string &out, std::string_view value) {
+    out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += "\\u00";
+            out += "0123456789abcdef"[(c >> 4) & 0x0F];
+            out += "0123456789abcdef"[c & 0x0F];
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// ISO 8601 in UTC with milliseconds, eg. 2024-05-01T12:30:00.250Z
+static void append_timestamp(std::string &out, JsonEncoder::Clock::time_point timestamp) {
+    using namespace std::chrono;
+    const auto ms = time_point_cast<milliseconds>(timestamp);
+    const auto day = floor<days>(ms);
+    const year_month_day date(day);
+    const hh_mm_ss time(ms - day);
+
+    out += '"';
+    append_padded(out, static_cast<int>(date.year()), 4);
+    out += '-';
+    append_padded(out, static_cast<int>(static_cast<unsigned>(date.month())), 2);
+    out += '-';
+    append_padded(out, static_cast<int>(static_cast<unsigned>(date.day())), 2);
+    out += 'T';
+    append_padded(out, static_cast<int>(time.hours().count()), 2);
+    out += ':';
+    append_padded(out, static_cast<int>(time.minutes().count()), 2);
+    out += ':';
+    append_padded(out, static_cast<int>(time.seconds().count()), 2);
+    out += '.';
+    append_padded(out, static_cast<int>(time.subseconds().count()), 3);
+    out += "Z\"";
+}
+
+// Appends `"key":value`, with a leading comma unless it is the first member of the object
+class ObjectWriter {
+public:
+    explicit ObjectWriter(std::string &out) : m_out(out) { m_out += '{'; }
+    ~ObjectWriter() { m_out += '}'; }
+
+    ObjectWriter(const ObjectWriter &other) = delete;
+    ObjectWriter &operator=(const ObjectWriter &other) = delete;
+    ObjectWriter(ObjectWriter &&other) noexcept = delete;
+    ObjectWriter &operator=(ObjectWriter &&other) noexcept = delete;
+
+    template <typename T> void member(std::string_view name, T value) {
+        key(name);
+        append_number(m_out, value);
+    }
+
+    void key(std::string_view name) {
+        if (!m_first) {
+            m_out += ',';
+        }
+        m_first = false;
+        append_string(m_out, name);
+        m_out += ':';
+    }
+
+private:
+    std::string &m_out;
+    bool m_first = true;
+};
+
+// ======================================== Signal K Paths ====================================== //
+// Temperature source (PGN 130312 and 130311). Sources without a Signal K path are left out
+static std::optional<std::string_view> temperature_path(uint8_t source) {
+    switch (source) {
+    case 0:
+        return "environment.water.temperature";
+    case 1:
+        return "environment.outside.temperature";
+    case 2:
+        return "environment.inside.temperature";
+    case 3:
+        return "environment.inside.engineRoom.temperature";
+    case 4:
+        return "environment.inside.mainCabin.temperature";
+    case 7:
+        return "environment.inside.refrigerator.temperature";
+    case 8:
+        return "environment.inside.heating.temperature";
+    case 9:
+        return "environment.outside.dewPointTemperature";
+    case 13:
+        return "environment.inside.freezer.temperature";
+    default:
+        return std::nullopt;
+    }
+}
+
+// Writes the `values` array of a Signal K update
+class ValuesWriter {
+public:
+    explicit ValuesWriter(std::string &out) : m_out(out) { m_out += '['; }
+    ~ValuesWriter() { m_out += ']'; }
+
+    ValuesWriter(const ValuesWriter &other) = delete;
+    ValuesWriter &operator=(const ValuesWriter &other) = delete;
+    ValuesWriter(ValuesWriter &&other) noexcept = delete;
+    ValuesWriter &operator=(ValuesWriter &&other) noexcept = delete;
+
+    void value(std::string_view path, double value) {
+        begin(path);
+        append_number(m_out, value);
+        m_out += '}';
+    }
+
+    /// Value that is an object with numeric members, eg. navigation.position
+    template <typename... Members> void object(std::string_view path, Members... members) {
+        begin(path);
+        {
+            ObjectWriter object(m_out);
+            (object.member(members.first, members.second), ...);
+        }
+        m_out += '}';
+    }
+
+private:
+    void begin(std::string_view path) {
+        if (!m_first) {
+            m_out += ',';
+        }
+        m_first = false;
+        m_out += "{\"path\":";
+        append_string(m_out, path);
+        m_out += ",\"value\":";
+    }
+
+    std::string &m_out;
+    bool m_first = true;
+};
+
+using Member = std::pair<std::string_view, double>;
+
+static uint32_t pgn_of(const NmeaMessage &msg) {
+    return std::visit([](const auto &m) { return message::pgn_of(m); }, msg);
+}
+
+static void write_values(ValuesWriter &values, const NmeaMessage &msg) {
+    nmea::visit(
+        msg,
+        [&](const message::CogSog &m) {
+            values.value(m.cog_reference == 0 ? "navigation.courseOverGroundTrue"
+                                              : "navigation.courseOverGroundMagnetic",
+                         m.cog);
+            values.value("navigation.speedOverGround", m.sog);
+        },
+        [&](const message::Temperature &m) {
+            if (auto path = temperature_path(m.source)) {
+                values.value(*path, m.actual_temperature);
+            }
+        },
+        [&](const message::VesselSpeedComponents &m) {
+            values.value("navigation.speedThroughWater", m.longitudinal.water);
+            values.value("navigation.speedThroughWaterTransverse", m.transverse.water);
+        },
+        [&](const message::Attitude &m) {
+            values.object("navigation.attitude", Member{"yaw", m.yaw}, Member{"pitch", m.pitch},
+                          Member{"roll", m.roll});
+        },
+        [&](const message::VesselHeading &m) {
+            if (m.reference == DirectionReference::TRUE) {
+                values.value("navigation.headingTrue", m.heading);
+            } else if (m.reference == DirectionReference::MAGNETIC) {
+                values.value("navigation.headingMagnetic", m.heading);
+            }
+            values.value("navigation.magneticDeviation", m.deviation);
+            values.value("navigation.magneticVariation", m.variation);
+        },
+        [&](const message::RateOfTurn &m) { values.value("navigation.rateOfTurn", m.rate); },
+        [&](const message::Heave &m) { values.value("environment.heave", m.heave); },
+        [&](const message::Position &m) {
+            values.object("navigation.position", Member{"latitude", m.latitude},
+                          Member{"longitude", m.longitude});
+        },
+        [&](const message::EnvironmentalParameters &m) {
+            if (auto path = temperature_path(m.temperature_source)) {
+                values.value(*path, m.temperature);
+            }
+            // Signal K has relative humidity as a ratio
+            values.value(m.humidity_source == 0 ? "environment.inside.relativeHumidity"
+                                                : "environment.outside.relativeHumidity",
+                         m.humidity / 100);
+            values.value("environment.outside.pressure", m.atmospheric_pressure);
+        },
+        [&](const message::ActualPressure &m) {
+            // Only atmospheric pressure has a Signal K path
+            if (m.source == 0) {
+                values.value("environment.outside.pressure", m.pressure);
+            }
+        });
+}
+
+// ========================================= JSON Lines ========================================= //
+static void write_fields(ObjectWriter &object, const NmeaMessage &msg) {
+    nmea::visit(
+        msg,
+        [&](const message::CogSog &m) {
+            object.member("sid", m.sid);
+            object.member("cog_reference", m.cog_reference);
+            object.member("cog", m.cog);
+            object.member("sog", m.sog);
+        },
+        [&](const message::Temperature &m) {
+            object.member("sid", m.sid);
+            object.member("instance", m.instance);
+            object.member("source", m.source);
+            object.member("actual_temperature", m.actual_temperature);
+            object.member("set_temperature", m.set_temperature);
+        },
+        [&](const message::VesselSpeedComponents &m) {
+            object.member("longitudinal_water", m.longitudinal.water);
+            object.member("longitudinal_ground", m.longitudinal.ground);
+            object.member("transverse_water", m.transverse.water);
+            object.member("transverse_ground", m.transverse.ground);
+            object.member("stern_water", m.stern.water);
+            object.member("stern_ground", m.stern.ground);
+        },
+        [&](const message::Attitude &m) {
+            object.member("sid", m.sid);
+            object.member("yaw", m.yaw);
+            object.member("pitch", m.pitch);
+            object.member("roll", m.roll);
+        },
+        [&](const message::VesselHeading &m) {
+            object.member("sid", m.sid);
+            object.member("heading", m.heading);
+            object.member("deviation", m.deviation);
+            object.member("variation", m.variation);
+            object.member("reference", std::to_underlying(m.reference));
+        },
+        [&](const message::RateOfTurn &m) {
+            object.member("sid", m.sid);
+            object.member("rate", m.rate);
+        },
+        [&](const message::Heave &m) {
+            object.member("sid", m.sid);
+            object.member("heave", m.heave);
+        },
+        [&](const message::Position &m) {
+            object.member("latitude", m.latitude);
+            object.member("longitude", m.longitude);
+        },
+        [&](const message::EnvironmentalParameters &m) {
+            object.member("sid", m.sid);
+            object.member("temperature_source", m.temperature_source);
+            object.member("humidity_source", m.humidity_source);
+            object.member("temperature", m.temperature);
+            object.member("humidity", m.humidity);
+            object.member("atmospheric_pressure", m.atmospheric_pressure);
+        },
+        [&](const message::ActualPressure &m) {
+            object.member("sid", m.sid);
+            object.member("instance", m.instance);
+            object.member("source", m.source);
+            object.member("pressure", m.pressure);
+        });
+}
+
+// ================================== Public API Implementation ================================= //
+JsonEncoder::JsonEncoder(JsonEncoderConfig config) : m_config(std::move(config)) {}
+
+void JsonEncoder::begin_batch() {
+    if (m_finished) {
+        // Keeps the capacity from the previous batches
+        m_buffer.clear();
+        m_finished = false;
+    }
+}
+
+void JsonEncoder::add(const NmeaMessage &msg, uint8_t source, Clock::time_point timestamp) {
+    begin_batch();
+    if (m_config.format == JsonFormat::SIGNALK_DELTA) {
+        add_signalk(msg, source, timestamp);
+    } else {
+        add_json_line(msg, source);
+    }
+    m_pending++;
+}
+
+void JsonEncoder::add_signalk(const NmeaMessage &msg, uint8_t source,
+                              Clock::time_point timestamp) {
+    if (m_pending == 0) {
+        m_buffer += "{\"context\":";
+        append_string(m_buffer, m_config.context);
+        m_buffer += ",\"updates\":[";
+    } else {
+        m_buffer += ',';
+    }
+
+    ObjectWriter update(m_buffer);
+    update.key("source");
+    {
+        ObjectWriter source_object(m_buffer);
+        source_object.key("label");
+        append_string(m_buffer, m_config.label);
+        source_object.key("type");
+        append_string(m_buffer, "NMEA2000");
+        source_object.member("pgn", pgn_of(msg));
+        // Signal K has the source address as a string
+        source_object.key("src");
+        m_buffer += '"';
+        append_number(m_buffer, source);
+        m_buffer += '"';
+    }
+    update.key("timestamp");
+    append_timestamp(m_buffer, timestamp);
+    update.key("values");
+    ValuesWriter values(m_buffer);
+    write_values(values, msg);
+}
+
+void JsonEncoder::add_json_line(const NmeaMessage &msg, uint8_t source) {
+    {
+        ObjectWriter object(m_buffer);
+        object.member("pgn", pgn_of(msg));
+        object.member("src", source);
+        write_fields(object, msg);
+    }
+    m_buffer += '\n';
+}
+
+std::string_view JsonEncoder::finish() {
+    begin_batch();
+    if (m_pending > 0 && m_config.format == JsonFormat::SIGNALK_DELTA) {
+        m_buffer += "]}\n";
+    }
+    m_pending = 0;
+    m_finished = true;
+    return m_buffer;
+}
+
+} // namespace nmea
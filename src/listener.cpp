@@ -1,96 +1,204 @@
 #include "nmea/listener.hpp"
 #include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
 #include <format>
 #include <linux/can.h>
-#include <unistd.h>
+#include <memory>
+#include <poll.h>
 #include <utility>
 
 namespace nmea {
 
-Listener::Listener(connection_t conn) : m_conn(conn) {}
+Listener::Listener(connection_t conn, std::pmr::memory_resource *resource)
+    : Listener(socket_transport(conn), resource) {}
 
-Listener::~Listener() {
-    if (m_conn != -1) {
-        close(m_conn);
+Listener::Listener(std::unique_ptr<Transport> transport, std::pmr::memory_resource *resource)
+    : m_transport(std::move(transport)), m_decoder(resource) {}
+
+std::expected<NmeaMessage, std::string> Listener::read() {
+    while (true) {
+        if (auto ready = wait_frame(); !ready) {
+            return std::unexpected(ready.error());
+        }
+        auto result = read_next();
+        if (!result) {
+            return std::unexpected(result.error());
+        }
+        if (*result) {
+            return std::move(**result);
+        }
     }
 }
 
-Listener::Listener(Listener &&other) noexcept : m_conn(std::exchange(other.m_conn, -1)) {}
-
-Listener &Listener::operator=(Listener &&other) noexcept {
-    if (this != &other) {
-        if (m_conn != -1) {
-            close(m_conn);
+Task<std::expected<NmeaMessage, std::string>> Listener::next() {
+    while (true) {
+        if (auto ready = co_await frame_ready(); !ready) {
+            co_return std::unexpected(ready.error());
+        }
+        auto result = read_next();
+        if (!result) {
+            co_return std::unexpected(result.error());
+        }
+        if (*result) {
+            co_return std::move(**result);
         }
-        m_conn = std::exchange(other.m_conn, -1);
     }
-
-    return *this;
 }
 
-void Listener::handle_tp_bam(uint8_t source, const can_frame &frame) {
-    TpTransfer transfer;
-    transfer.total_size = static_cast<uint16_t>(frame.data[1] | (frame.data[2] << 8));
-    transfer.total_packets = frame.data[3];
-    transfer.pgn =
-        uint32_t(frame.data[5]) | (uint32_t(frame.data[6]) << 8) | (uint32_t(frame.data[7]) << 16);
-    transfer.next_packet = 1;
-    transfer.buffer.resize(transfer.total_size);
-    m_tp_transfers[source] = std::move(transfer);
+// ======================================== Reconnection ======================================== //
+std::expected<void, std::string> Listener::set_interface_monitor(InterfaceMonitor *monitor) {
+    m_watch.reset();
+    if (!monitor) {
+        return {};
+    }
+    auto watch = monitor->watch(*m_transport);
+    if (!watch) {
+        return std::unexpected(watch.error());
+    }
+    m_watch = std::move(*watch);
+    return {};
 }
 
-std::optional<std::expected<NmeaMessage, std::string>>
-Listener::handle_tp_dt(uint8_t source, const can_frame &frame) {
-    auto iter = m_tp_transfers.find(source);
-    if (iter == m_tp_transfers.end()) {
-        return std::unexpected(std::format("Unexpected TP data packet from source {:02X}", source));
-    }
-    auto &transfer = iter->second;
-    const uint8_t seq = frame.data[0];
-    if (seq != transfer.next_packet) {
-        m_tp_transfers.erase(iter);
-        return std::unexpected(
-            std::format("Out of order TP packet: expected {}, got {}", transfer.next_packet, seq));
-    }
-    const size_t offset = (seq - 1) * 7;
-    const size_t bytes = std::min<size_t>(7, transfer.total_size - offset);
-    std::copy(frame.data + 1, frame.data + 1 + static_cast<ptrdiff_t>(bytes),
-              transfer.buffer.begin() + static_cast<ptrdiff_t>(offset));
-    transfer.next_packet++;
-    if (seq < transfer.total_packets) {
-        // Not all packets have been sent yet
-        return std::nullopt;
+std::expected<void, std::string> Listener::wait_frame() {
+    if (!m_watch) {
+        // Reading blocks on the transport itself
+        return {};
+    }
+    while (true) {
+        auto state = m_watch->update();
+        if (!state) {
+            return std::unexpected(state.error());
+        }
+        if (*state != InterfaceMonitor::LinkState::Down &&
+            m_transport->wait(std::chrono::milliseconds(0))) {
+            return {};
+        }
+        // Readable when a frame arrives or the link state changes
+        pollfd pfd{.fd = m_watch->fd(), .events = POLLIN, .revents = 0};
+        if (::poll(&pfd, 1, -1) == -1 && errno != EINTR) {
+            return std::unexpected(std::format("Failed to poll: {}", std::strerror(errno)));
+        }
     }
-    auto result = parse(transfer.pgn << 8, transfer.buffer);
-    m_tp_transfers.erase(iter);
-    return result;
 }
 
-std::expected<NmeaMessage, std::string> Listener::read() {
+Task<std::expected<void, std::string>> Listener::frame_ready() {
+    if (!m_watch) {
+        co_await frame_available(*m_transport);
+        co_return std::expected<void, std::string>();
+    }
     while (true) {
-        can_frame frame{};
-        auto nbytes = ::read(m_conn, &frame, sizeof(frame));
-        if (nbytes < 0) {
-            return std::unexpected("Unable to read from socket");
+        auto state = m_watch->update();
+        if (!state) {
+            co_return std::unexpected(state.error());
         }
-        if (nbytes < static_cast<ssize_t>(sizeof(frame))) {
-            return std::unexpected("Incomplete CAN frame");
+        if (*state != InterfaceMonitor::LinkState::Down &&
+            m_transport->wait(std::chrono::milliseconds(0))) {
+            co_return std::expected<void, std::string>();
         }
+        co_await readable(m_watch->fd());
+    }
+}
 
-        const uint8_t source = frame.can_id & 0xFF;
-        const uint8_t pf = (frame.can_id >> 16) & 0xFF;
+bool Listener::link_lost() {
+    if (!m_watch) {
+        return false;
+    }
+    auto state = m_watch->update();
+    return !state || *state != InterfaceMonitor::LinkState::Up;
+}
 
-        // Handle transport protocol
-        // Ref: https://embeddedflakes.com/j1939-transport-protocol/
-        if (pf == 0xEC && frame.data[0] == 0x20) {
-            handle_tp_bam(source, frame);
-        } else if (pf == 0xEB) {
-            if (auto result = handle_tp_dt(source, frame)) {
-                return *result;
+std::expected<Listener::Decoded, std::string> Listener::read_next() {
+    if (m_transport->reassembles()) {
+        if (auto result = m_transport->read_packet(m_packet); !result) {
+            if (link_lost()) {
+                return Decoded();
             }
+            return std::unexpected(result.error());
+        }
+        return process(m_packet);
+    }
+    can_frame frame{};
+    if (auto result = m_transport->read(frame); !result) {
+        if (link_lost()) {
+            return Decoded();
+        }
+        return std::unexpected(result.error());
+    }
+    return process(frame);
+}
+
+Listener::Decoded Listener::process(const can_frame &frame) {
+    if (m_bus_load) {
+        m_bus_load->record(frame);
+    }
+    if (m_address_map) {
+        m_address_map->observe(frame);
+    }
+
+    m_last_source = frame.can_id & 0xFF;
+
+    Decoded result;
+    if (auto payload = m_decoder.reassemble(frame)) {
+        if (*payload) {
+            const auto &complete = **payload;
+            result = decode({.pgn = complete.pgn,
+                             .priority = complete.priority,
+                             .source = complete.source,
+                             .destination = complete.destination,
+                             .data = complete.data});
         } else {
-            return parse(frame.can_id, frame.data);
+            result = std::unexpected(std::move(payload->error()));
         }
     }
+    publish(frame, result);
+    return result;
 }
+
+Listener::Decoded Listener::process(const Packet &packet) {
+    // The hooks only see the first frame of a packet that spans several frames
+    can_frame frame{};
+    frame.can_id = packet.can_id();
+    frame.can_dlc = static_cast<uint8_t>(std::min<size_t>(packet.data.size(), CAN_MAX_DLEN));
+    std::copy_n(packet.data.begin(), frame.can_dlc, frame.data);
+    if (m_bus_load) {
+        m_bus_load->record(frame);
+    }
+    if (m_address_map) {
+        m_address_map->observe(frame);
+    }
+
+    m_last_source = packet.source;
+
+    Decoded result = decode({.pgn = packet.pgn,
+                             .priority = packet.priority,
+                             .source = packet.source,
+                             .destination = packet.destination,
+                             .data = packet.data});
+    publish(frame, result);
+    return result;
+}
+
+Listener::Decoded Listener::decode(const UnknownMessage &payload) {
+    if (m_unknown_handler && !is_supported(payload.pgn)) {
+        m_unknown_handler(payload);
+        return std::nullopt;
+    }
+    return parse(payload.pgn << 8, payload.data);
+}
+
+void Listener::publish(const can_frame &frame, const Decoded &result) {
+    const NmeaMessage *message = result && result->has_value() ? &**result : nullptr;
+    if (m_shm_ring) {
+        message ? m_shm_ring->write(frame, *message) : m_shm_ring->write(frame);
+    }
+    if (m_broadcast) {
+        message ? m_broadcast->write(frame, *message) : m_broadcast->write(frame);
+    }
+    if (m_stream_server) {
+        message ? m_stream_server->publish(frame, *message) : m_stream_server->publish(frame);
+    }
+}
+
 } // namespace nmea
@@ -1,316 +1,257 @@
 #include "nmea/message.hpp"
 #include "nmea/definitions.hpp"
+#include "nmea/parse.hpp"
 #include "nmea/visit.hpp"
 #include <cmath>
 #include <cstdint>
 #include <format>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace nmea {
-static uint16_t read_u16(std::span<const uint8_t> data, size_t idx) {
-    return static_cast<uint16_t>(data[idx] | (data[idx + 1] << 8));
-}
-
-static uint32_t read_u32(std::span<const uint8_t> data, size_t idx) {
-    return static_cast<uint32_t>(data[idx] | (data[idx + 1] << 8) | (data[idx + 2] << 16) |
-                                 (data[idx + 3] << 24));
-}
-
-static int16_t read_i16(std::span<const uint8_t> data, size_t idx) {
-    return static_cast<int16_t>(data[idx] | (data[idx + 1] << 8));
-}
-
-static int32_t read_i32(std::span<const uint8_t> data, size_t idx) {
-    return static_cast<int32_t>(data[idx] | (data[idx + 1] << 8) | (data[idx + 2] << 16) |
-                                (data[idx + 3] << 24));
-}
-
-static void write_u16(std::vector<uint8_t> &data, size_t idx, uint16_t val) {
+template <typename Data> static void write_u16(Data &data, size_t idx, uint16_t val) {
     data[idx] = static_cast<uint8_t>(val);
     data[idx + 1] = static_cast<uint8_t>(val >> 8);
 }
 
-static void write_u32(std::vector<uint8_t> &data, size_t idx, uint32_t val) {
+template <typename Data> static void write_u32(Data &data, size_t idx, uint32_t val) {
     data[idx] = static_cast<uint8_t>(val);
     data[idx + 1] = static_cast<uint8_t>(val >> 8);
     data[idx + 2] = static_cast<uint8_t>(val >> 16);
     data[idx + 3] = static_cast<uint8_t>(val >> 24);
 }
 
-// ============================== 129026 - COG & SOG, Rapid Update ============================== //
-static message::CogSog parse_cogsog(std::span<const uint8_t> data) {
-    message::CogSog msg{};
-
-    msg.sid = data[0];
-    msg.cog_reference = data[1] & 0x03;
-    msg.cog = read_u16(data, 2) * 0.0001;
-    msg.sog = read_u16(data, 4) * 0.01;
-
-    return msg;
+template <typename Wire, typename T> static Wire unscale(T value, double resolution) {
+    if constexpr (std::is_integral_v<T>) {
+        return static_cast<Wire>(value);
+    } else {
+        return static_cast<Wire>(std::lround(value / resolution));
+    }
 }
 
-static SerializedMessage serialize_cogsog(const message::CogSog &msg) {
-    std::vector<uint8_t> data(8, 0);
+// ============================== 129026 - COG & SOG, Rapid Update ============================== //
+template <typename P, typename A>
+static BasicSerializedMessage<A> serialize_cogsog(const message::BasicCogSog<P> &msg,
+                                                  const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
     data[0] = msg.sid;
     data[1] = msg.cog_reference & 0x03;
-    write_u16(data, 2, static_cast<uint16_t>(std::lround(msg.cog / 0.0001)));
-    write_u16(data, 4, static_cast<uint16_t>(std::lround(msg.sog / 0.01)));
-    return {pgn::COG_SOG, data};
+    write_u16(data, 2, unscale<uint16_t>(msg.cog, 0.0001));
+    write_u16(data, 4, unscale<uint16_t>(msg.sog, 0.01));
+    return {pgn::COG_SOG, std::move(data)};
 }
 
 // ==================================== 130312 - Temperature ==================================== //
-static message::Temperature parse_temperature(std::span<const uint8_t> data) {
-    message::Temperature msg{};
-
-    msg.sid = data[0];
-    msg.instance = data[1];
-    msg.source = data[2];
-    msg.actual_temperature = read_u16(data, 3) * 0.01;
-    msg.set_temperature = read_u16(data, 5) * 0.01;
-
-    return msg;
-}
-
-static SerializedMessage serialize_temperature(const message::Temperature &msg) {
-    std::vector<uint8_t> data(8, 0);
+template <typename P, typename A>
+static BasicSerializedMessage<A> serialize_temperature(const message::BasicTemperature<P> &msg,
+                                                       const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
     data[0] = msg.sid;
     data[1] = msg.instance;
     data[2] = msg.source;
-    write_u16(data, 3, static_cast<uint16_t>(std::lround(msg.actual_temperature / 0.01)));
-    write_u16(data, 5, static_cast<uint16_t>(std::lround(msg.set_temperature / 0.01)));
-    return {pgn::TEMPERATURE, data};
+    write_u16(data, 3, unscale<uint16_t>(msg.actual_temperature, 0.01));
+    write_u16(data, 5, unscale<uint16_t>(msg.set_temperature, 0.01));
+    return {pgn::TEMPERATURE, std::move(data)};
 }
 
 // ============================== 130578 - Vessel Speed Components ============================== //
-static message::VesselSpeedComponents parse_vessel_speed_components(std::span<const uint8_t> data) {
-    message::VesselSpeedComponents msg{};
-
-    msg.longitudinal.water = read_i16(data, 0) * 0.001;
-    msg.transverse.water = read_i16(data, 2) * 0.001;
-    msg.longitudinal.ground = read_i16(data, 4) * 0.001;
-    msg.transverse.ground = read_i16(data, 6) * 0.001;
-    msg.stern.water = read_i16(data, 8) * 0.001;
-    msg.stern.ground = read_i16(data, 10) * 0.001;
-
-    return msg;
-}
-
-static SerializedMessage
-serialize_vessel_speed_components(const message::VesselSpeedComponents &msg) {
-    std::vector<uint8_t> data(12, 0);
-
-    write_u16(data, 0, static_cast<uint16_t>(std::lround(msg.longitudinal.water / 0.001)));
-    write_u16(data, 2, static_cast<uint16_t>(std::lround(msg.transverse.water / 0.001)));
-    write_u16(data, 4, static_cast<uint16_t>(std::lround(msg.longitudinal.ground / 0.001)));
-    write_u16(data, 6, static_cast<uint16_t>(std::lround(msg.transverse.ground / 0.001)));
-    write_u16(data, 8, static_cast<uint16_t>(std::lround(msg.stern.water / 0.001)));
-    write_u16(data, 10, static_cast<uint16_t>(std::lround(msg.stern.ground / 0.001)));
-
-    return {pgn::VESSEL_SPEED, data};
+template <typename P, typename A>
+static BasicSerializedMessage<A>
+serialize_vessel_speed_components(const message::BasicVesselSpeedComponents<P> &msg,
+                                  const A &allocator) {
+    std::vector<uint8_t, A> data(12, 0, allocator);
+
+    write_u16(data, 0, unscale<uint16_t>(msg.longitudinal.water, 0.001));
+    write_u16(data, 2, unscale<uint16_t>(msg.transverse.water, 0.001));
+    write_u16(data, 4, unscale<uint16_t>(msg.longitudinal.ground, 0.001));
+    write_u16(data, 6, unscale<uint16_t>(msg.transverse.ground, 0.001));
+    write_u16(data, 8, unscale<uint16_t>(msg.stern.water, 0.001));
+    write_u16(data, 10, unscale<uint16_t>(msg.stern.ground, 0.001));
+
+    return {pgn::VESSEL_SPEED, std::move(data)};
 }
 
 // ====================================== 127250 - Heading ====================================== //
-static message::VesselHeading parse_vessel_heading(std::span<const uint8_t> data) {
-    message::VesselHeading msg{};
-
-    msg.sid = data[0];
-    msg.heading = read_u16(data, 1) * 0.0001;
-    msg.deviation = read_i16(data, 3) * 0.0001;
-    msg.variation = read_i16(data, 5) * 0.0001;
-    msg.reference = static_cast<DirectionReference>(data[7] & 0x3);
-
-    return msg;
-}
-
-static SerializedMessage serialize_vessel_heading(const message::VesselHeading &msg) {
-    std::vector<uint8_t> data(8, 0);
+template <typename P, typename A>
+static BasicSerializedMessage<A> serialize_vessel_heading(const message::BasicVesselHeading<P> &msg,
+                                                          const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
 
     data[0] = msg.sid;
-    write_u16(data, 1, static_cast<uint16_t>(std::lround(msg.heading / 0.0001)));
-    write_u16(data, 3, static_cast<uint16_t>(std::lround(msg.deviation / 0.0001)));
-    write_u16(data, 5, static_cast<uint16_t>(std::lround(msg.variation / 0.0001)));
+    write_u16(data, 1, unscale<uint16_t>(msg.heading, 0.0001));
+    write_u16(data, 3, unscale<uint16_t>(msg.deviation, 0.0001));
+    write_u16(data, 5, unscale<uint16_t>(msg.variation, 0.0001));
     data[7] = std::to_underlying(msg.reference);
 
-    return {pgn::VESSEL_HEADING, data};
+    return {pgn::VESSEL_HEADING, std::move(data)};
 }
 
 // ==================================== 127251 - Rate of Turn =================================== //
-static message::RateOfTurn parse_rate_of_turn(std::span<const uint8_t> data) {
-    message::RateOfTurn msg{};
-
-    msg.sid = data[0];
-    msg.rate = read_u32(data, 1) * 3.125e-08;
-
-    return msg;
-}
-
-static SerializedMessage serialize_rate_of_turn(const message::RateOfTurn &msg) {
-    std::vector<uint8_t> data(8, 0);
+template <typename P, typename A>
+static BasicSerializedMessage<A> serialize_rate_of_turn(const message::BasicRateOfTurn<P> &msg,
+                                                        const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
 
     data[0] = msg.sid;
-    write_u32(data, 1, static_cast<uint32_t>(std::lround(msg.rate / 3.125e-08)));
+    write_u32(data, 1, unscale<uint32_t>(msg.rate, 3.125e-08));
 
-    return {pgn::RATE_OF_TURN, data};
+    return {pgn::RATE_OF_TURN, std::move(data)};
 }
 
 // ======================================= 127252 - Heave ======================================= //
-static message::Heave parse_heave(std::span<const uint8_t> data) {
-    message::Heave msg{};
-
-    msg.sid = data[0];
-    msg.heave = read_u16(data, 1) * 0.01;
-
-    return msg;
-}
-
-static SerializedMessage serialize_heave(const message::Heave &msg) {
-    std::vector<uint8_t> data(8, 0);
+template <typename P, typename A>
+static BasicSerializedMessage<A> serialize_heave(const message::BasicHeave<P> &msg,
+                                                 const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
 
     data[0] = msg.sid;
-    write_u16(data, 1, static_cast<uint16_t>(std::lround(msg.heave / 0.01)));
+    write_u16(data, 1, unscale<uint16_t>(msg.heave, 0.01));
 
-    return {pgn::HEAVE, data};
+    return {pgn::HEAVE, std::move(data)};
 }
 
 // ===================================== 127257 - Attitude ====================================== //
-static message::Attitude parse_attitude(std::span<const uint8_t> data) {
-    message::Attitude msg{};
-
-    msg.sid = data[0];
-    msg.yaw = read_i16(data, 1) * 0.0001;
-    msg.pitch = read_i16(data, 3) * 0.0001;
-    msg.roll = read_i16(data, 5) * 0.0001;
-
-    return msg;
-}
-
-static SerializedMessage serialize_attitude(const message::Attitude &msg) {
-    std::vector<uint8_t> data(8, 0);
+template <typename P, typename A>
+static BasicSerializedMessage<A> serialize_attitude(const message::BasicAttitude<P> &msg,
+                                                    const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
 
     data[0] = msg.sid;
-    write_u16(data, 1, static_cast<uint16_t>(std::lround(msg.yaw / 0.0001)));
-    write_u16(data, 3, static_cast<uint16_t>(std::lround(msg.pitch / 0.0001)));
-    write_u16(data, 5, static_cast<uint16_t>(std::lround(msg.roll / 0.0001)));
+    write_u16(data, 1, unscale<uint16_t>(msg.yaw, 0.0001));
+    write_u16(data, 3, unscale<uint16_t>(msg.pitch, 0.0001));
+    write_u16(data, 5, unscale<uint16_t>(msg.roll, 0.0001));
 
-    return {pgn::ATTITUDE, data};
+    return {pgn::ATTITUDE, std::move(data)};
 }
 
 // ============================== 129025 - Position, Rapid Update =============================== //
-static message::Position parse_position(std::span<const uint8_t> data) {
-    message::Position msg{};
+template <typename P, typename A>
+static BasicSerializedMessage<A> serialize_position(const message::BasicPosition<P> &msg,
+                                                    const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
 
-    msg.latitude = read_i32(data, 0) * 1e-07;
-    msg.longitude = read_i32(data, 4) * 1e-07;
+    write_u32(data, 0, unscale<uint32_t>(msg.latitude, 1e-07));
+    write_u32(data, 4, unscale<uint32_t>(msg.longitude, 1e-07));
 
-    return msg;
-}
-
-static SerializedMessage serialize_position(const message::Position &msg) {
-    std::vector<uint8_t> data(8, 0);
-
-    write_u32(data, 0, static_cast<uint32_t>(std::lround(msg.latitude / 1e-07)));
-    write_u32(data, 4, static_cast<uint32_t>(std::lround(msg.longitude / 1e-07)));
-
-    return {pgn::POSITION, data};
+    return {pgn::POSITION, std::move(data)};
 }
 
 // ============================= 130311 - Environmental Parameters ============================== //
-static message::EnvironmentalParameters
-parse_environmental_parameters(std::span<const uint8_t> data) {
-    message::EnvironmentalParameters msg{};
-
-    msg.sid = data[0];
-    msg.temperature_source = data[1] & 0x3F;
-    msg.humidity_source = data[1] & 0xC0;
-    msg.temperature = read_u16(data, 2) * 0.01;
-    msg.humidity = read_i16(data, 4) * 0.004;
-    msg.atmospheric_pressure = read_u16(data, 6);
-
-    return msg;
-}
-
-static SerializedMessage
-serialize_environmental_parameters(const message::EnvironmentalParameters &msg) {
-    std::vector<uint8_t> data(8, 0);
+template <typename P, typename A>
+static BasicSerializedMessage<A>
+serialize_environmental_parameters(const message::BasicEnvironmentalParameters<P> &msg,
+                                   const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
 
     data[0] = msg.sid;
     data[1] = static_cast<uint8_t>(msg.temperature_source) |
               static_cast<uint8_t>(msg.humidity_source << 6);
-    write_u16(data, 2, static_cast<uint16_t>(std::lround(msg.temperature / 0.01)));
-    write_u16(data, 4, static_cast<uint16_t>(std::lround(msg.humidity / 0.004)));
+    write_u16(data, 2, unscale<uint16_t>(msg.temperature, 0.01));
+    write_u16(data, 4, unscale<uint16_t>(msg.humidity, 0.004));
     write_u16(data, 6, static_cast<uint16_t>(std::lround(msg.atmospheric_pressure)));
 
-    return {pgn::ENVIRONMENTAL_PARAMETERS, data};
+    return {pgn::ENVIRONMENTAL_PARAMETERS, std::move(data)};
 }
 
 // ================================== 130314 - Actual Pressure ================================== //
-static message::ActualPressure parse_actual_pressure(std::span<const uint8_t> data) {
-    message::ActualPressure msg{};
-
-    msg.sid = data[0];
-    msg.instance = data[1];
-    msg.source = data[2];
-    msg.pressure = read_i32(data, 3) * 0.1;
-
-    return msg;
-}
-
-static SerializedMessage serialize_actual_pressure(const message::ActualPressure &msg) {
-    std::vector<uint8_t> data(8, 0);
+template <typename P, typename A>
+static BasicSerializedMessage<A>
+serialize_actual_pressure(const message::BasicActualPressure<P> &msg,
+                          const A &allocator) {
+    std::vector<uint8_t, A> data(8, 0, allocator);
 
     data[0] = msg.sid;
     data[1] = msg.instance;
     data[2] = msg.source;
-    write_u32(data, 3, static_cast<uint32_t>(std::lround(msg.pressure / 0.1)));
+    write_u32(data, 3, unscale<uint32_t>(msg.pressure, 0.1));
 
-    return {pgn::ACTUAL_PRESSURE, data};
+    return {pgn::ACTUAL_PRESSURE, std::move(data)};
 }
 
 // ================================== Public API Implementation ================================= //
-std::expected<NmeaMessage, std::string> parse(uint32_t id, std::span<const uint8_t> data) {
+template <typename P>
+std::expected<BasicNmeaMessage<P>, std::string> parse(uint32_t id, std::span<const uint8_t> data) {
     auto msg_pgn = (id >> 8) & 0x3FFFF;
     switch (msg_pgn) {
     case pgn::COG_SOG:
-        return parse_cogsog(data);
+        return parse_as<message::BasicCogSog<P>>(data);
     case pgn::TEMPERATURE:
-        return parse_temperature(data);
+        return parse_as<message::BasicTemperature<P>>(data);
     case pgn::VESSEL_SPEED:
-        return parse_vessel_speed_components(data);
+        return parse_as<message::BasicVesselSpeedComponents<P>>(data);
     case pgn::ATTITUDE:
-        return parse_attitude(data);
+        return parse_as<message::BasicAttitude<P>>(data);
     case pgn::VESSEL_HEADING:
-        return parse_vessel_heading(data);
+        return parse_as<message::BasicVesselHeading<P>>(data);
     case pgn::RATE_OF_TURN:
-        return parse_rate_of_turn(data);
+        return parse_as<message::BasicRateOfTurn<P>>(data);
     case pgn::HEAVE:
-        return parse_heave(data);
+        return parse_as<message::BasicHeave<P>>(data);
     case pgn::POSITION:
-        return parse_position(data);
+        return parse_as<message::BasicPosition<P>>(data);
     case pgn::ENVIRONMENTAL_PARAMETERS:
-        return parse_environmental_parameters(data);
+        return parse_as<message::BasicEnvironmentalParameters<P>>(data);
     case pgn::ACTUAL_PRESSURE:
-        return parse_actual_pressure(data);
+        return parse_as<message::BasicActualPressure<P>>(data);
     default:
         return std::unexpected(std::format("PGN {} not supported", msg_pgn));
     }
 }
 
-SerializedMessage serialize(const NmeaMessage &msg) {
+template <typename P, typename A>
+BasicSerializedMessage<A> serialize(const BasicNmeaMessage<P> &msg, const A &allocator) {
     return nmea::visit(
-        msg, [](const message::CogSog &m) { return serialize_cogsog(m); },
-        [](const message::Temperature &m) { return serialize_temperature(m); },
-        [](const message::VesselSpeedComponents &m) {
-            return serialize_vessel_speed_components(m);
+        msg, [&](const message::BasicCogSog<P> &m) { return serialize_cogsog(m, allocator); },
+        [&](const message::BasicTemperature<P> &m) { return serialize_temperature(m, allocator); },
+        [&](const message::BasicVesselSpeedComponents<P> &m) {
+            return serialize_vessel_speed_components(m, allocator);
         },
-        [](const message::Attitude &m) { return serialize_attitude(m); },
-        [](const message::VesselHeading &m) { return serialize_vessel_heading(m); },
-        [](const message::RateOfTurn &m) { return serialize_rate_of_turn(m); },
-        [](const message::Heave &m) { return serialize_heave(m); },
-        [](const message::Position &m) { return serialize_position(m); },
-        [](const message::EnvironmentalParameters &m) {
-            return serialize_environmental_parameters(m);
+        [&](const message::BasicAttitude<P> &m) { return serialize_attitude(m, allocator); },
+        [&](const message::BasicVesselHeading<P> &m) {
+            return serialize_vessel_heading(m, allocator);
         },
-        [](const message::ActualPressure &m) { return serialize_actual_pressure(m); });
+        [&](const message::BasicRateOfTurn<P> &m) { return serialize_rate_of_turn(m, allocator); },
+        [&](const message::BasicHeave<P> &m) { return serialize_heave(m, allocator); },
+        [&](const message::BasicPosition<P> &m) { return serialize_position(m, allocator); },
+        [&](const message::BasicEnvironmentalParameters<P> &m) {
+            return serialize_environmental_parameters(m, allocator);
+        },
+        [&](const message::BasicActualPressure<P> &m) {
+            return serialize_actual_pressure(m, allocator);
+        });
 }
+
+template std::expected<BasicNmeaMessage<policy::Raw>, std::string>
+parse<policy::Raw>(uint32_t id, std::span<const uint8_t> data);
+template std::expected<BasicNmeaMessage<policy::Float>, std::string>
+parse<policy::Float>(uint32_t id, std::span<const uint8_t> data);
+template std::expected<BasicNmeaMessage<policy::Double>, std::string>
+parse<policy::Double>(uint32_t id, std::span<const uint8_t> data);
+
+using Allocator = std::allocator<uint8_t>;
+using PmrAllocator = std::pmr::polymorphic_allocator<uint8_t>;
+// The template arguments are explicit so that the overloads for `NmeaMessage` and
+// `CompactNmeaMessage` in the header are not picked instead
+template BasicSerializedMessage<Allocator>
+serialize<policy::Raw, Allocator>(const BasicNmeaMessage<policy::Raw> &msg,
+                                  const Allocator &allocator);
+template BasicSerializedMessage<Allocator>
+serialize<policy::Float, Allocator>(const BasicNmeaMessage<policy::Float> &msg,
+                                    const Allocator &allocator);
+template BasicSerializedMessage<Allocator>
+serialize<policy::Double, Allocator>(const BasicNmeaMessage<policy::Double> &msg,
+                                     const Allocator &allocator);
+template BasicSerializedMessage<PmrAllocator>
+serialize<policy::Raw, PmrAllocator>(const BasicNmeaMessage<policy::Raw> &msg,
+                                     const PmrAllocator &allocator);
+template BasicSerializedMessage<PmrAllocator>
+serialize<policy::Float, PmrAllocator>(const BasicNmeaMessage<policy::Float> &msg,
+                                       const PmrAllocator &allocator);
+template BasicSerializedMessage<PmrAllocator>
+serialize<policy::Double, PmrAllocator>(const BasicNmeaMessage<policy::Double> &msg,
+                                        const PmrAllocator &allocator);
+
 } // namespace nmea
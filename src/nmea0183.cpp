@@ -0,0 +1,294 @@
+#include "nmea/nmea0183.hpp"
+#include "nmea/visit.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <numbers>
+
+namespace nmea {
+namespace nmea0183 {
+
+constexpr double DEGREES_PER_RADIAN = 180.0 / std::numbers::pi;
+constexpr double KNOTS_PER_MPS = 3600.0 / 1852.0;
+constexpr double KMH_PER_MPS = 3.6;
+constexpr double KELVIN_OFFSET = 273.15;
+constexpr double PASCALS_PER_BAR = 100000.0;
+
+constexpr uint8_t TEMPERATURE_SOURCE_SEA = 0;
+constexpr uint8_t TEMPERATURE_SOURCE_OUTSIDE = 1;
+constexpr uint8_t PRESSURE_SOURCE_ATMOSPHERIC = 0;
+
+// ====================================== Sentence Builder ====================================== //
+// Appends comma separated fields to a sentence. Room for the checksum is always kept, and a
+// sentence that does not fit is dropped by `finish()`
+class SentenceBuilder {
+public:
+    SentenceBuilder(Sentence &sentence, SentenceType type, std::array<char, 2> talker,
+                    std::string_view formatter)
+        : m_sentence(sentence) {
+        m_sentence.m_type = type;
+        m_sentence.m_size = 0;
+        put('$');
+        put(talker[0]);
+        put(talker[1]);
+        append(formatter);
+    }
+
+    SentenceBuilder &field(double value, int decimals) {
+        put(',');
+        char *begin = m_sentence.m_data.data() + m_sentence.m_size;
+        auto [end, ec] = std::to_chars(begin, limit(), value, std::chars_format::fixed, decimals);
+        if (ec != std::errc()) {
+            m_overflow = true;
+            return *this;
+        }
+        m_sentence.m_size = static_cast<size_t>(end - m_sentence.m_data.data());
+        return *this;
+    }
+
+    SentenceBuilder &field(std::string_view text) {
+        put(',');
+        append(text);
+        return *this;
+    }
+
+    SentenceBuilder &empty() {
+        put(',');
+        return *this;
+    }
+
+    // Latitude or longitude as [d]ddmm.mmmm, followed by its hemisphere
+    SentenceBuilder &coordinate(double degrees, int degree_digits, char positive, char negative) {
+        // Rounded as a whole, so that eg. 59.99999 minutes carries into the degrees
+        const auto total = std::llround(std::abs(degrees) * 60.0 * 10000.0);
+        put(',');
+        digits(total / 600000, degree_digits);
+        digits((total / 10000) % 60, 2);
+        put('.');
+        digits(total % 10000, 4);
+        put(',');
+        put(degrees < 0 ? negative : positive);
+        return *this;
+    }
+
+    // UTC time of day as hhmmss.ss
+    SentenceBuilder &time(Gateway::Clock::time_point now) {
+        using namespace std::chrono;
+        const auto since_midnight = duration_cast<milliseconds>(now - floor<days>(now)).count();
+        put(',');
+        digits(since_midnight / 3600000, 2);
+        digits(since_midnight / 60000 % 60, 2);
+        digits(since_midnight / 1000 % 60, 2);
+        put('.');
+        digits(since_midnight / 10 % 100, 2);
+        return *this;
+    }
+
+    // Whether the sentence fit, in which case its checksum is appended
+    bool finish() {
+        if (m_overflow) {
+            return false;
+        }
+        uint8_t checksum = 0;
+        for (size_t i = 1; i < m_sentence.m_size; i++) {
+            checksum ^= static_cast<uint8_t>(m_sentence.m_data[i]);
+        }
+        constexpr std::string_view HEX = "0123456789ABCDEF";
+        auto &data = m_sentence.m_data;
+        data[m_sentence.m_size++] = '*';
+        data[m_sentence.m_size++] = HEX[checksum >> 4];
+        data[m_sentence.m_size++] = HEX[checksum & 0x0F];
+        data[m_sentence.m_size++] = '\r';
+        data[m_sentence.m_size++] = '\n';
+        return true;
+    }
+
+private:
+    // `*hh\r\n`
+    static constexpr size_t CHECKSUM_LENGTH = 5;
+
+    char *limit() { return m_sentence.m_data.data() + MAX_SENTENCE_LENGTH - CHECKSUM_LENGTH; }
+
+    void put(char c) {
+        if (m_sentence.m_size >= MAX_SENTENCE_LENGTH - CHECKSUM_LENGTH) {
+            m_overflow = true;
+            return;
+        }
+        m_sentence.m_data[m_sentence.m_size++] = c;
+    }
+
+    void append(std::string_view text) {
+        for (char c : text) {
+            put(c);
+        }
+    }
+
+    void digits(int64_t value, int width) {
+        int64_t divisor = 1;
+        for (int i = 1; i < width; i++) {
+            divisor *= 10;
+        }
+        for (; divisor > 0; divisor /= 10) {
+            put(static_cast<char>('0' + value / divisor % 10));
+        }
+    }
+
+    Sentence &m_sentence;
+    bool m_overflow = false;
+};
+
+// ========================================= Conversions ======================================== //
+static double degrees(double radians) { return radians * DEGREES_PER_RADIAN; }
+
+// Degrees in 0..360
+static double bearing(double radians) {
+    const double result = std::fmod(degrees(radians), 360.0);
+    return result < 0 ? result + 360.0 : result;
+}
+
+static double celsius(double kelvin) { return kelvin - KELVIN_OFFSET; }
+
+// Magnetic deviation and variation are sent as a positive angle and a direction
+static void magnetic_offset(SentenceBuilder &builder, double radians) {
+    builder.field(std::abs(degrees(radians)), 1).field(radians < 0 ? "W" : "E");
+}
+
+// ================================== Public API Implementation ================================= //
+Gateway::Gateway(GatewayConfig config) : m_config(config) {}
+
+void Gateway::set_interval(SentenceType type, std::chrono::milliseconds interval) {
+    m_config.intervals[static_cast<size_t>(type)] = interval;
+}
+
+bool Gateway::due(SentenceType type, size_t message_index, Clock::time_point now) {
+    const auto index = static_cast<size_t>(type);
+    auto &last_sent = m_last_sent[index][message_index];
+    if (last_sent != Clock::time_point{} && now - last_sent < m_config.intervals[index]) {
+        return false;
+    }
+    last_sent = now;
+    return true;
+}
+
+Sentences Gateway::convert(const NmeaMessage &msg, Clock::time_point now) {
+    Sentences result;
+    // Starts a sentence if one of its type is due, and keeps it if it fits
+    auto build = [&](SentenceType type, std::string_view formatter, auto &&fields) {
+        if (!due(type, msg.index(), now)) {
+            return;
+        }
+        SentenceBuilder builder(result.m_sentences[result.m_size], type, m_config.talker,
+                                formatter);
+        fields(builder);
+        if (builder.finish()) {
+            result.m_size++;
+        }
+    };
+
+    nmea::visit(
+        msg,
+        [&](const message::VesselHeading &m) {
+            if (m.reference == DirectionReference::MAGNETIC) {
+                build(SentenceType::HDG, "HDG", [&](SentenceBuilder &b) {
+                    b.field(bearing(m.heading), 1);
+                    magnetic_offset(b, m.deviation);
+                    magnetic_offset(b, m.variation);
+                });
+                build(SentenceType::HDT, "HDT", [&](SentenceBuilder &b) {
+                    b.field(bearing(m.heading + m.deviation + m.variation), 1).field("T");
+                });
+            } else if (m.reference == DirectionReference::TRUE) {
+                build(SentenceType::HDT, "HDT", [&](SentenceBuilder &b) {
+                    b.field(bearing(m.heading), 1).field("T");
+                });
+            }
+        },
+        [&](const message::CogSog &m) {
+            build(SentenceType::VTG, "VTG", [&](SentenceBuilder &b) {
+                if (m.cog_reference == 0) {
+                    b.field(bearing(m.cog), 1).field("T").empty().field("M");
+                } else {
+                    b.empty().field("T").field(bearing(m.cog), 1).field("M");
+                }
+                b.field(m.sog * KNOTS_PER_MPS, 1).field("N");
+                b.field(m.sog * KMH_PER_MPS, 1).field("K").field("A");
+            });
+        },
+        [&](const message::RateOfTurn &m) {
+            build(SentenceType::ROT, "ROT", [&](SentenceBuilder &b) {
+                b.field(degrees(m.rate) * 60.0, 1).field("A");
+            });
+        },
+        [&](const message::Temperature &m) {
+            if (m.source == TEMPERATURE_SOURCE_SEA) {
+                build(SentenceType::MTW, "MTW", [&](SentenceBuilder &b) {
+                    b.field(celsius(m.actual_temperature), 1).field("C");
+                });
+                return;
+            }
+            build(SentenceType::XDR, "XDR", [&](SentenceBuilder &b) {
+                b.field("C").field(celsius(m.actual_temperature), 1).field("C");
+                if (m.source == TEMPERATURE_SOURCE_OUTSIDE) {
+                    b.field("TempAir");
+                } else {
+                    // Names the temperature after its instance, eg. Temp2
+                    std::array<char, 8> name{'T', 'e', 'm', 'p'};
+                    auto [end, ec] = std::to_chars(name.data() + 4, name.data() + name.size(),
+                                                   m.instance);
+                    b.field(std::string_view(name.data(), end));
+                }
+            });
+        },
+        [&](const message::EnvironmentalParameters &m) {
+            if (m.temperature_source == TEMPERATURE_SOURCE_SEA) {
+                build(SentenceType::MTW, "MTW", [&](SentenceBuilder &b) {
+                    b.field(celsius(m.temperature), 1).field("C");
+                });
+            }
+            build(SentenceType::XDR, "XDR", [&](SentenceBuilder &b) {
+                if (m.temperature_source == TEMPERATURE_SOURCE_OUTSIDE) {
+                    b.field("C").field(celsius(m.temperature), 1).field("C").field("TempAir");
+                }
+                b.field("H").field(m.humidity, 1).field("P").field("Humidity");
+                b.field("P").field(m.atmospheric_pressure / PASCALS_PER_BAR, 5).field("B");
+                b.field("Barometer");
+            });
+        },
+        [&](const message::ActualPressure &m) {
+            if (m.source != PRESSURE_SOURCE_ATMOSPHERIC) {
+                return;
+            }
+            build(SentenceType::XDR, "XDR", [&](SentenceBuilder &b) {
+                b.field("P").field(m.pressure / PASCALS_PER_BAR, 5).field("B").field("Barometer");
+            });
+        },
+        [&](const message::Attitude &m) {
+            build(SentenceType::XDR, "XDR", [&](SentenceBuilder &b) {
+                b.field("A").field(degrees(m.pitch), 1).field("D").field("PTCH");
+                b.field("A").field(degrees(m.roll), 1).field("D").field("ROLL");
+            });
+        },
+        [&](const message::Heave &m) {
+            build(SentenceType::XDR, "XDR", [&](SentenceBuilder &b) {
+                b.field("D").field(m.heave, 2).field("M").field("HEAVE");
+            });
+        },
+        [&](const message::Position &m) {
+            build(SentenceType::GLL, "GLL", [&](SentenceBuilder &b) {
+                b.coordinate(m.latitude, 2, 'N', 'S').coordinate(m.longitude, 3, 'E', 'W');
+                b.time(now).field("A").field("A");
+            });
+        },
+        [&](const message::VesselSpeedComponents &m) {
+            build(SentenceType::VHW, "VHW", [&](SentenceBuilder &b) {
+                b.empty().field("T").empty().field("M");
+                b.field(m.longitudinal.water * KNOTS_PER_MPS, 1).field("N");
+                b.field(m.longitudinal.water * KMH_PER_MPS, 1).field("K");
+            });
+        });
+    return result;
+}
+
+} // namespace nmea0183
+} // namespace nmea
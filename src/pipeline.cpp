@@ -0,0 +1,304 @@
+#include "nmea/pipeline.hpp"
+#include "nmea/decoder.hpp"
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <linux/can.h>
+#include <utility>
+
+namespace nmea {
+namespace internal {
+
+struct SequencedFrame {
+    uint64_t sequence;
+    can_frame frame;
+};
+
+struct PipelineShard {
+    explicit PipelineShard(size_t capacity) : input(capacity) {}
+
+    std::mutex mutex;
+    std::condition_variable input_cv;  // Frames were queued, or the pipeline was closed
+    std::condition_variable space_cv;  // Frames were decoded, which frees their slots
+    std::condition_variable output_cv; // Messages were decoded, or the worker finished
+    std::condition_variable drain_cv;  // Messages were taken by the consumer
+
+    // Ring of the frames to decode, filled by ingest without taking the mutex. The worker decodes
+    // all of [input_head, input_tail) at once and only then frees the slots, under the mutex, as
+    // it queues their messages, so the frame at the head is outstanding until its message is
+    std::vector<SequencedFrame> input;
+    std::atomic<uint64_t> input_head = 0;
+    std::atomic<uint64_t> input_tail = 0;
+    // Set while the worker sleeps on `input_cv`, so that ingest only notifies it then
+    std::atomic<bool> waiting = false;
+
+    std::deque<DecodedMessage> output;
+    std::atomic<bool> closed = false;
+    std::atomic<bool> stopping = false;
+    bool finished = false;
+
+    Decoder decoder; // Only used by the worker
+    std::thread worker;
+
+    // Messages taken over from `output` at once, which are only used by the consumer
+    std::deque<DecodedMessage> taken;
+
+    // Lowest sequence that may still produce a message on this shard, once `taken` is empty.
+    // Called with the mutex held
+    uint64_t outstanding() const {
+        if (!output.empty()) {
+            return output.front().sequence;
+        }
+        const uint64_t head = input_head.load(std::memory_order_relaxed);
+        if (head != input_tail.load(std::memory_order_acquire)) {
+            return input[head % input.size()].sequence;
+        }
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    // Take over the queued messages, with the mutex held
+    void take() {
+        if (taken.empty()) {
+            taken.swap(output);
+        }
+    }
+};
+
+} // namespace internal
+
+constexpr auto INGEST_POLL_INTERVAL = std::chrono::milliseconds(100);
+
+Pipeline::Pipeline(PipelineConfig config) : m_capacity(std::max<size_t>(config.capacity, 1)) {
+    size_t workers = config.workers;
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Sources are the shard key, so any more workers would never be used
+    workers = std::min<size_t>(workers, 256);
+
+    m_shards.reserve(workers);
+    for (size_t i = 0; i < workers; i++) {
+        m_shards.push_back(std::make_unique<internal::PipelineShard>(m_capacity));
+    }
+    for (auto &shard : m_shards) {
+        shard->worker = std::thread([this, &shard = *shard] { work(shard); });
+    }
+}
+
+Pipeline::Pipeline(std::unique_ptr<Transport> transport, PipelineConfig config)
+    : Pipeline(config) {
+    m_transport = std::move(transport);
+    auto ingest_thread = start_thread(config.ingest_thread, [this] { ingest(); });
+    if (!ingest_thread) {
+        m_ingest_error = ingest_thread.error();
+        close();
+        return;
+    }
+    m_ingest = std::move(*ingest_thread);
+}
+
+Pipeline::~Pipeline() {
+    m_stopping = true;
+    for (auto &shard : m_shards) {
+        {
+            std::lock_guard lock(shard->mutex);
+            shard->stopping = true;
+        }
+        shard->input_cv.notify_all();
+        shard->space_cv.notify_all();
+        shard->drain_cv.notify_all();
+    }
+    if (m_ingest.joinable()) {
+        m_ingest.join();
+    }
+    for (auto &shard : m_shards) {
+        shard->worker.join();
+    }
+}
+
+void Pipeline::notify_progress() {
+    {
+        std::lock_guard lock(m_progress_mutex);
+        m_progress.fetch_add(1, std::memory_order_release);
+    }
+    m_progress_cv.notify_all();
+}
+
+void Pipeline::work(internal::PipelineShard &shard) {
+    std::vector<DecodedMessage> decoded;
+    uint64_t head = 0;
+    while (true) {
+        uint64_t tail = shard.input_tail.load(std::memory_order_acquire);
+        if (tail == head) {
+            std::unique_lock lock(shard.mutex);
+            // Ingest publishes a frame before it checks the flag, and the flag is set before the
+            // ring is checked again, so either ingest notifies or the frame is seen here
+            shard.waiting = true;
+            shard.input_cv.wait(lock, [&] {
+                tail = shard.input_tail.load();
+                return tail != head || shard.closed || shard.stopping;
+            });
+            shard.waiting = false;
+            if (shard.stopping || tail == head) {
+                shard.finished = true;
+                break;
+            }
+        }
+
+        // Decodes everything that is queued so the lock is held once per batch, not per frame
+        for (uint64_t i = head; i < tail; i++) {
+            const auto &[sequence, frame] = shard.input[i % shard.input.size()];
+            if (auto result = shard.decoder.decode(frame)) {
+                decoded.push_back({
+                    .sequence = sequence,
+                    .source = static_cast<uint8_t>(frame.can_id & 0xFF),
+                    .message = std::move(*result),
+                });
+            }
+        }
+
+        {
+            std::unique_lock lock(shard.mutex);
+            shard.drain_cv.wait(
+                lock, [&] { return shard.output.size() < m_capacity || shard.stopping; });
+            std::ranges::move(decoded, std::back_inserter(shard.output));
+            shard.input_head.store(tail, std::memory_order_release);
+        }
+        head = tail;
+        decoded.clear();
+        shard.space_cv.notify_all();
+        shard.output_cv.notify_all();
+        notify_progress();
+    }
+    shard.output_cv.notify_all();
+    notify_progress();
+}
+
+void Pipeline::push(const can_frame &frame) {
+    auto &shard = *m_shards[(frame.can_id & 0xFF) % m_shards.size()];
+    // Only ingest moves the tail
+    const uint64_t tail = shard.input_tail.load(std::memory_order_relaxed);
+    if (tail - shard.input_head.load(std::memory_order_acquire) == m_capacity) {
+        std::unique_lock lock(shard.mutex);
+        shard.space_cv.wait(lock, [&] {
+            return tail - shard.input_head.load(std::memory_order_acquire) < m_capacity ||
+                   shard.stopping;
+        });
+    }
+    if (shard.closed || shard.stopping) {
+        return;
+    }
+
+    const uint64_t sequence = m_ingested.load(std::memory_order_relaxed);
+    shard.input[tail % m_capacity] = {sequence, frame};
+    shard.input_tail.store(tail + 1);
+    m_ingested.store(sequence + 1, std::memory_order_release);
+    if (shard.waiting) {
+        // Taking the mutex orders the notification after the worker started waiting
+        { std::lock_guard lock(shard.mutex); }
+        shard.input_cv.notify_one();
+    }
+}
+
+void Pipeline::close() {
+    for (auto &shard : m_shards) {
+        {
+            std::lock_guard lock(shard->mutex);
+            shard->closed = true;
+        }
+        shard->input_cv.notify_all();
+    }
+    notify_progress();
+}
+
+std::optional<DecodedMessage> Pipeline::next() {
+    while (true) {
+        const uint64_t seen = m_progress.load(std::memory_order_acquire);
+        // Frames ingested after this point have higher sequences than any frame seen below, but
+        // frames ingested while the shards are scanned could be missed
+        const uint64_t ingested = m_ingested.load(std::memory_order_acquire);
+
+        // Every sequence below the lowest outstanding one has been consumed already, so if that
+        // sequence is at the head of the messages of a shard it is the next one in ingest order.
+        // The messages taken over from a shard all come before any it still has, so only the
+        // shards without any left are locked
+        uint64_t lowest = std::numeric_limits<uint64_t>::max();
+        internal::PipelineShard *ready = nullptr;
+        bool finished = true;
+        for (auto &shard : m_shards) {
+            uint64_t outstanding = 0;
+            if (shard->taken.empty()) {
+                {
+                    std::lock_guard lock(shard->mutex);
+                    shard->take();
+                    finished = finished && shard->finished && shard->taken.empty();
+                    outstanding = shard->taken.empty() ? shard->outstanding()
+                                                       : shard->taken.front().sequence;
+                }
+                if (!shard->taken.empty()) {
+                    shard->drain_cv.notify_all();
+                }
+            } else {
+                finished = false;
+                outstanding = shard->taken.front().sequence;
+            }
+            if (outstanding < lowest) {
+                lowest = outstanding;
+                ready = shard->taken.empty() ? nullptr : shard.get();
+            }
+        }
+
+        if (ready && lowest < ingested) {
+            std::optional<DecodedMessage> msg = std::move(ready->taken.front());
+            ready->taken.pop_front();
+            return msg;
+        }
+        if (finished) {
+            return std::nullopt;
+        }
+        std::unique_lock progress_lock(m_progress_mutex);
+        m_progress_cv.wait(progress_lock, [&] { return m_progress != seen; });
+    }
+}
+
+std::optional<DecodedMessage> Pipeline::next(size_t shard_index) {
+    auto &shard = *m_shards.at(shard_index);
+    if (shard.taken.empty()) {
+        {
+            std::unique_lock lock(shard.mutex);
+            shard.output_cv.wait(lock, [&] { return !shard.output.empty() || shard.finished; });
+            shard.take();
+        }
+        if (shard.taken.empty()) {
+            return std::nullopt;
+        }
+        shard.drain_cv.notify_all();
+    }
+    std::optional<DecodedMessage> msg = std::move(shard.taken.front());
+    shard.taken.pop_front();
+    return msg;
+}
+
+std::optional<std::string> Pipeline::ingest_error() const {
+    std::lock_guard lock(m_progress_mutex);
+    return m_ingest_error;
+}
+
+void Pipeline::ingest() {
+    while (!m_stopping) {
+        if (!m_transport->wait(INGEST_POLL_INTERVAL)) {
+            continue;
+        }
+        can_frame frame{};
+        if (auto result = m_transport->read(frame); !result) {
+            std::lock_guard lock(m_progress_mutex);
+            m_ingest_error = result.error();
+            break;
+        }
+        push(frame);
+    }
+    close();
+}
+
+} // namespace nmea
@@ -0,0 +1,141 @@
+#include "nmea/publisher.hpp"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace nmea {
+
+// ===================================== Change Detection ======================================= //
+// The SID only groups messages sampled at the same time, so it never counts as a change
+static bool exceeds(double tolerance, std::initializer_list<std::pair<double, double>> fields) {
+    return std::ranges::any_of(fields, [tolerance](const auto &field) {
+        return std::abs(field.first - field.second) > tolerance;
+    });
+}
+
+static bool changed(const message::CogSog &a, const message::CogSog &b, double tolerance) {
+    return a.cog_reference != b.cog_reference ||
+           exceeds(tolerance, {{a.cog, b.cog}, {a.sog, b.sog}});
+}
+
+static bool changed(const message::Temperature &a, const message::Temperature &b,
+                    double tolerance) {
+    return a.instance != b.instance || a.source != b.source ||
+           exceeds(tolerance, {{a.actual_temperature, b.actual_temperature},
+                               {a.set_temperature, b.set_temperature}});
+}
+
+static bool changed(const message::VesselSpeedComponents &a,
+                    const message::VesselSpeedComponents &b, double tolerance) {
+    return exceeds(tolerance, {{a.longitudinal.water, b.longitudinal.water},
+                               {a.longitudinal.ground, b.longitudinal.ground},
+                               {a.transverse.water, b.transverse.water},
+                               {a.transverse.ground, b.transverse.ground},
+                               {a.stern.water, b.stern.water},
+                               {a.stern.ground, b.stern.ground}});
+}
+
+static bool changed(const message::Attitude &a, const message::Attitude &b, double tolerance) {
+    return exceeds(tolerance, {{a.yaw, b.yaw}, {a.pitch, b.pitch}, {a.roll, b.roll}});
+}
+
+static bool changed(const message::VesselHeading &a, const message::VesselHeading &b,
+                    double tolerance) {
+    return a.reference != b.reference ||
+           exceeds(tolerance, {{a.heading, b.heading},
+                               {a.deviation, b.deviation},
+                               {a.variation, b.variation}});
+}
+
+static bool changed(const message::RateOfTurn &a, const message::RateOfTurn &b,
+                    double tolerance) {
+    return exceeds(tolerance, {{a.rate, b.rate}});
+}
+
+static bool changed(const message::Heave &a, const message::Heave &b, double tolerance) {
+    return exceeds(tolerance, {{a.heave, b.heave}});
+}
+
+static bool changed(const message::Position &a, const message::Position &b, double tolerance) {
+    return exceeds(tolerance, {{a.latitude, b.latitude}, {a.longitude, b.longitude}});
+}
+
+static bool changed(const message::EnvironmentalParameters &a,
+                    const message::EnvironmentalParameters &b, double tolerance) {
+    return a.temperature_source != b.temperature_source ||
+           a.humidity_source != b.humidity_source ||
+           exceeds(tolerance, {{a.temperature, b.temperature},
+                               {a.humidity, b.humidity},
+                               {a.atmospheric_pressure, b.atmospheric_pressure}});
+}
+
+static bool changed(const message::ActualPressure &a, const message::ActualPressure &b,
+                    double tolerance) {
+    return a.instance != b.instance || a.source != b.source ||
+           exceeds(tolerance, {{a.pressure, b.pressure}});
+}
+
+// ================================== Public API Implementation ================================= //
+std::optional<Publisher::Clock::time_point> Publisher::due(const Entry &entry) {
+    if (!entry.config || !entry.latest) {
+        return std::nullopt;
+    }
+    if (!entry.sent) {
+        return entry.sent_at;
+    }
+
+    const bool is_changed = std::visit(
+        [&](const auto &latest) {
+            using T = std::decay_t<decltype(latest)>;
+            return changed(latest, std::get<T>(*entry.sent), entry.config->tolerance);
+        },
+        *entry.latest);
+    if (is_changed) {
+        return entry.sent_at + entry.config->interval;
+    }
+    if (entry.config->max_interval.count() > 0) {
+        return entry.sent_at + std::max(entry.config->interval, entry.config->max_interval);
+    }
+    return std::nullopt;
+}
+
+std::expected<void, std::string> Publisher::update(const NmeaMessage &msg) {
+    auto &entry = m_entries[msg.index()];
+    if (!entry.config) {
+        return std::unexpected("Message type has not been configured for publishing");
+    }
+    entry.latest = msg;
+    return {};
+}
+
+std::expected<size_t, std::string> Publisher::flush(Clock::time_point now) {
+    size_t sent = 0;
+    for (auto &entry : m_entries) {
+        auto when = due(entry);
+        if (!when || *when > now) {
+            continue;
+        }
+        if (auto result = m_device.send(*entry.latest); !result) {
+            return std::unexpected(result.error());
+        }
+        entry.sent = entry.latest;
+        entry.sent_at = now;
+        sent++;
+    }
+    return sent;
+}
+
+std::optional<Publisher::Clock::time_point> Publisher::next_due() const {
+    std::optional<Clock::time_point> next;
+    for (const auto &entry : m_entries) {
+        if (auto when = due(entry); when && (!next || *when < *next)) {
+            next = when;
+        }
+    }
+    return next;
+}
+
+} // namespace nmea
@@ -0,0 +1,92 @@
+#include "ring_slot.hpp"
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <variant>
+
+namespace nmea::internal {
+
+// PDU1 PGNs (PF below 240) carry the destination address in place of the low byte
+static uint32_t frame_pgn(const can_frame &frame) {
+    const uint32_t pgn = (frame.can_id >> 8) & 0x3FFFF;
+    return ((pgn >> 8) & 0xFF) < 240 ? pgn & 0x3FF00 : pgn;
+}
+
+RingPayload ring_payload(const can_frame &frame, const NmeaMessage *message,
+                         std::chrono::system_clock::time_point timestamp) {
+    return {
+        .timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            timestamp.time_since_epoch())
+                            .count(),
+        .frame = frame,
+        .pgn = message ? std::visit([](const auto &m) { return message::pgn_of(m); }, *message)
+                       : frame_pgn(frame),
+        .has_message = message != nullptr,
+        .message = message ? *message : NmeaMessage{},
+    };
+}
+
+RingEntry ring_entry(uint64_t sequence, const RingPayload &payload) {
+    RingEntry entry{
+        .sequence = sequence,
+        .timestamp = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(payload.timestamp_ns))),
+        .frame = payload.frame,
+        .message = std::nullopt,
+    };
+    if (payload.has_message) {
+        entry.message = payload.message;
+    }
+    return entry;
+}
+
+void RingSlot::write(uint64_t sequence, const RingPayload &payload) {
+    std::array<uint64_t, WORDS> copy{};
+    std::memcpy(copy.data(), &payload, sizeof(payload));
+
+    version.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < copy.size(); i++) {
+        words[i].store(copy[i], std::memory_order_relaxed);
+    }
+    version.store(2 * sequence + 2, std::memory_order_release);
+}
+
+std::expected<std::optional<RingPayload>, std::string>
+read_slot(const RingSlot *slots, uint64_t capacity, const std::atomic<uint64_t> &head,
+          uint64_t &next, uint64_t &lost) {
+    const uint64_t sequence = next;
+    const RingSlot &slot = slots[sequence & (capacity - 1)];
+    const uint64_t written = 2 * sequence + 2;
+
+    const uint64_t version = slot.version.load(std::memory_order_acquire);
+    if (version < written) {
+        // Not written yet, or still being written
+        return std::nullopt;
+    }
+    if (version == written) {
+        std::array<uint64_t, RingSlot::WORDS> copy;
+        for (size_t i = 0; i < copy.size(); i++) {
+            copy[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Only use the copy if the writer did not start to overwrite the slot meanwhile
+        if (slot.version.load(std::memory_order_relaxed) == written) {
+            next++;
+            RingPayload payload;
+            std::memcpy(static_cast<void *>(&payload), copy.data(), sizeof(payload));
+            return payload;
+        }
+    }
+
+    // Lapped by the writer. Resume at the oldest entry that is still in the ring
+    const uint64_t newest = head.load(std::memory_order_acquire);
+    const uint64_t oldest = newest > capacity ? newest - capacity : 0;
+    next = std::max(oldest, sequence + 1);
+    const uint64_t skipped = next - sequence;
+    lost += skipped;
+    return std::unexpected(std::format("Reader overrun, {} entries lost", skipped));
+}
+
+} // namespace nmea::internal
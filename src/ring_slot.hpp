@@ -0,0 +1,57 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include "nmea/shm_ring.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <linux/can.h>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+namespace nmea::internal {
+
+// Entry as it is stored in a ring slot. Copied in and out of the slots as raw words, so it must
+// not need any constructor
+struct RingPayload {
+    int64_t timestamp_ns;
+    can_frame frame;
+    // PGN of the message the frame completed, or else of the frame, to filter entries on
+    uint32_t pgn;
+    bool has_message;
+    NmeaMessage message;
+};
+static_assert(std::is_trivially_copyable_v<RingPayload>);
+
+RingPayload ring_payload(const can_frame &frame, const NmeaMessage *message,
+                         std::chrono::system_clock::time_point timestamp);
+RingEntry ring_entry(uint64_t sequence, const RingPayload &payload);
+
+// Slot of a ring with a single writer, which is a seqlock. Its version is odd while the writer
+// updates it, and 2 * (sequence + 1) once it holds the entry of `sequence`. The payload is stored
+// as atomic words so that a reader copying a slot while the writer overwrites it is not a data
+// race: the copy is simply thrown away when the version changed. The words are lock-free, so
+// slots can also be shared between processes
+struct alignas(64) RingSlot {
+    static constexpr size_t WORDS = (sizeof(RingPayload) + 7) / 8;
+
+    std::atomic<uint64_t> version = 0;
+    std::array<std::atomic<uint64_t>, WORDS> words{};
+
+    void write(uint64_t sequence, const RingPayload &payload);
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// Read the entry at `next` from a ring of `capacity` slots whose writer is at `head`, and move
+// `next` past it. Returns nullopt if the reader caught up with the writer. If the writer lapped
+// the reader, `next` moves to the oldest entry still in the ring, the entries skipped are added
+// to `lost` and an error tells how many they were
+std::expected<std::optional<RingPayload>, std::string>
+read_slot(const RingSlot *slots, uint64_t capacity, const std::atomic<uint64_t> &head,
+          uint64_t &next, uint64_t &lost);
+
+} // namespace nmea::internal
@@ -0,0 +1,203 @@
+#include "nmea/shm_ring.hpp"
+#include "ring_slot.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace nmea {
+namespace internal {
+
+constexpr uint64_t SHM_MAGIC = 0x474e4952'41454d4e; // "NMEARING"
+// Bumped whenever the layout of the header or the slots changes
+constexpr uint32_t SHM_VERSION = 2;
+
+struct alignas(64) ShmHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t capacity;
+    // Sequence of the next entry to be written
+    alignas(64) std::atomic<uint64_t> head;
+
+    RingSlot *slots() { return reinterpret_cast<RingSlot *>(this + 1); }
+    const RingSlot *slots() const { return reinterpret_cast<const RingSlot *>(this + 1); }
+};
+
+static size_t mapping_size(uint64_t capacity) {
+    return sizeof(ShmHeader) + capacity * sizeof(RingSlot);
+}
+
+} // namespace internal
+
+using internal::RingSlot;
+using internal::ShmHeader;
+
+// ======================================= ShmRingWriter ======================================== //
+std::expected<ShmRingWriter, std::string> ShmRingWriter::create(const std::string &name,
+                                                                ShmRingConfig config) {
+    const uint64_t capacity = std::bit_ceil(std::max<size_t>(config.capacity, 1));
+    const size_t size = internal::mapping_size(capacity);
+
+    // A previous ring of the same name is unlinked so readers that still map it are not corrupted
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return std::unexpected(
+            std::format("Unable to create shared memory {}: {}", name, std::strerror(errno)));
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        auto error = std::format("Unable to size shared memory {}: {}", name, std::strerror(errno));
+        close(fd);
+        shm_unlink(name.c_str());
+        return std::unexpected(error);
+    }
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return std::unexpected(
+            std::format("Unable to map shared memory {}: {}", name, std::strerror(errno)));
+    }
+
+    // The memory is zeroed, which is a valid state for all slots. Readers check the magic last
+    auto *header = new (memory) ShmHeader{};
+    for (uint64_t i = 0; i < capacity; i++) {
+        new (header->slots() + i) RingSlot{};
+    }
+    header->version = internal::SHM_VERSION;
+    header->slot_size = sizeof(RingSlot);
+    header->capacity = capacity;
+    std::atomic_ref(header->magic).store(internal::SHM_MAGIC, std::memory_order_release);
+    return ShmRingWriter(name, header, size);
+}
+
+ShmRingWriter::ShmRingWriter(std::string name, ShmHeader *header, size_t size)
+    : m_name(std::move(name)), m_header(header), m_size(size) {}
+
+ShmRingWriter::~ShmRingWriter() {
+    if (m_header) {
+        munmap(m_header, m_size);
+        shm_unlink(m_name.c_str());
+    }
+}
+
+ShmRingWriter::ShmRingWriter(ShmRingWriter &&other) noexcept
+    : m_name(std::move(other.m_name)), m_header(std::exchange(other.m_header, nullptr)),
+      m_size(std::exchange(other.m_size, 0)) {}
+
+ShmRingWriter &ShmRingWriter::operator=(ShmRingWriter &&other) noexcept {
+    if (this != &other) {
+        if (m_header) {
+            munmap(m_header, m_size);
+            shm_unlink(m_name.c_str());
+        }
+        m_name = std::move(other.m_name);
+        m_header = std::exchange(other.m_header, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+size_t ShmRingWriter::capacity() const { return m_header->capacity; }
+
+void ShmRingWriter::write(const can_frame &frame, Clock::time_point timestamp) {
+    write_entry(frame, nullptr, timestamp);
+}
+
+void ShmRingWriter::write(const can_frame &frame, const NmeaMessage &message,
+                          Clock::time_point timestamp) {
+    write_entry(frame, &message, timestamp);
+}
+
+void ShmRingWriter::write_entry(const can_frame &frame, const NmeaMessage *message,
+                                Clock::time_point timestamp) {
+    const uint64_t sequence = m_header->head.load(std::memory_order_relaxed);
+    m_header->slots()[sequence & (m_header->capacity - 1)].write(
+        sequence, internal::ring_payload(frame, message, timestamp));
+    m_header->head.store(sequence + 1, std::memory_order_release);
+}
+
+// ======================================= ShmRingReader ======================================== //
+std::expected<ShmRingReader, std::string> ShmRingReader::open(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return std::unexpected(
+            std::format("Unable to open shared memory {}: {}", name, std::strerror(errno)));
+    }
+    struct stat st {};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(ShmHeader)) {
+        close(fd);
+        return std::unexpected(std::format("Shared memory {} is not a ring", name));
+    }
+    const auto size = static_cast<size_t>(st.st_size);
+    void *memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return std::unexpected(
+            std::format("Unable to map shared memory {}: {}", name, std::strerror(errno)));
+    }
+
+    const auto *header = static_cast<const ShmHeader *>(memory);
+    const bool valid =
+        std::atomic_ref(const_cast<uint64_t &>(header->magic)).load(std::memory_order_acquire) ==
+            internal::SHM_MAGIC &&
+        header->version == internal::SHM_VERSION && header->slot_size == sizeof(RingSlot) &&
+        std::has_single_bit(header->capacity) &&
+        internal::mapping_size(header->capacity) <= size;
+    if (!valid) {
+        munmap(memory, size);
+        return std::unexpected(
+            std::format("Shared memory {} is not a ring of this library version", name));
+    }
+    return ShmRingReader(header, size);
+}
+
+ShmRingReader::ShmRingReader(const ShmHeader *header, size_t size)
+    : m_header(header), m_size(size), m_next(header->head.load(std::memory_order_acquire)) {}
+
+ShmRingReader::~ShmRingReader() {
+    if (m_header) {
+        munmap(const_cast<ShmHeader *>(m_header), m_size);
+    }
+}
+
+ShmRingReader::ShmRingReader(ShmRingReader &&other) noexcept
+    : m_header(std::exchange(other.m_header, nullptr)), m_size(std::exchange(other.m_size, 0)),
+      m_next(other.m_next), m_lost(other.m_lost) {}
+
+ShmRingReader &ShmRingReader::operator=(ShmRingReader &&other) noexcept {
+    if (this != &other) {
+        if (m_header) {
+            munmap(const_cast<ShmHeader *>(m_header), m_size);
+        }
+        m_header = std::exchange(other.m_header, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_next = other.m_next;
+        m_lost = other.m_lost;
+    }
+    return *this;
+}
+
+std::expected<std::optional<RingEntry>, std::string> ShmRingReader::next() {
+    const uint64_t sequence = m_next;
+    auto payload = internal::read_slot(m_header->slots(), m_header->capacity, m_header->head,
+                                       m_next, m_lost);
+    if (!payload) {
+        return std::unexpected(payload.error());
+    }
+    if (!*payload) {
+        return std::nullopt;
+    }
+    return internal::ring_entry(sequence, **payload);
+}
+
+} // namespace nmea
@@ -0,0 +1,462 @@
+#include "nmea/stream_server.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <iterator>
+#include <linux/can.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace nmea {
+namespace internal {
+
+// Records are queued in blocks of this size, which are handed to `sendmsg` together
+constexpr size_t STREAM_BLOCK_SIZE = 4096;
+constexpr size_t STREAM_MAX_IOVECS = 64;
+// A subscription to every PGN there is fits comfortably
+constexpr size_t STREAM_MAX_INPUT = 64 * 1024;
+
+struct StreamClient {
+    int fd;
+    uint8_t subscribed = stream::SUBSCRIBE_RAW | stream::SUBSCRIBE_DECODED;
+    std::vector<uint32_t> pgns; // Sorted. Empty for every PGN
+
+    std::deque<std::vector<uint8_t>> blocks;
+    std::vector<std::vector<uint8_t>> spare_blocks;
+    // Bytes in `blocks` and `sending`, so that a slow client is disconnected before it holds
+    // more than the maximum
+    size_t queued = 0;
+    StreamServer::Clock::time_point first_queued;
+
+    // Only used by the server thread, which writes the blocks taken from `blocks` without holding
+    // the lock, and hands the written ones back to `spare_blocks`
+    std::deque<std::vector<uint8_t>> sending;
+    std::vector<std::vector<uint8_t>> written_blocks;
+    size_t sent = 0;    // Bytes of the first block of `sending` already written
+    size_t written = 0; // Bytes written since the blocks were last handed back
+
+    std::vector<uint8_t> input;
+    // More than the maximum was queued. The client is dropped by the server thread
+    bool overrun = false;
+
+    bool wants(uint8_t type, uint32_t pgn) const {
+        return (subscribed & type) && (pgns.empty() || std::ranges::binary_search(pgns, pgn));
+    }
+
+    void queue(const std::vector<uint8_t> &record, StreamServer::Clock::time_point now) {
+        if (blocks.empty() || blocks.back().size() + record.size() > STREAM_BLOCK_SIZE) {
+            if (spare_blocks.empty()) {
+                blocks.emplace_back().reserve(std::max(STREAM_BLOCK_SIZE, record.size()));
+            } else {
+                blocks.push_back(std::move(spare_blocks.back()));
+                spare_blocks.pop_back();
+            }
+        }
+        blocks.back().insert(blocks.back().end(), record.begin(), record.end());
+        if (queued == 0) {
+            first_queued = now;
+        }
+        queued += record.size();
+    }
+};
+
+} // namespace internal
+
+using internal::StreamClient;
+
+static void put_u16(std::vector<uint8_t> &out, uint16_t value) {
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+static void put_u32(std::vector<uint8_t> &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+static void put_u64(std::vector<uint8_t> &out, uint64_t value) {
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+// Starts a record whose length is filled in by `end_record`
+static void begin_record(std::vector<uint8_t> &out, uint8_t type,
+                         StreamServer::Clock::time_point timestamp) {
+    out.clear();
+    put_u16(out, 0);
+    out.push_back(type);
+    put_u64(out, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                           timestamp.time_since_epoch())
+                                           .count()));
+}
+
+static void end_record(std::vector<uint8_t> &out) {
+    const auto length = static_cast<uint16_t>(out.size() - 2);
+    out[0] = static_cast<uint8_t>(length);
+    out[1] = static_cast<uint8_t>(length >> 8);
+}
+
+// PDU1 PGNs (PF below 240) carry the destination address in place of the low byte
+static uint32_t frame_pgn(const can_frame &frame) {
+    const uint32_t pgn = (frame.can_id >> 8) & 0x3FFFF;
+    return ((pgn >> 8) & 0xFF) < 240 ? pgn & 0x3FF00 : pgn;
+}
+
+static std::string error_message(std::string_view what) {
+    return std::format("{}: {}", what, std::strerror(errno));
+}
+
+// ====================================== Server Lifetime ======================================= //
+std::expected<std::unique_ptr<StreamServer>, std::string>
+StreamServer::unix_socket(const std::string &path, StreamServerConfig config) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        return std::unexpected(std::format("Socket path {} is too long", path));
+    }
+    addr.sun_family = AF_UNIX;
+    std::ranges::copy(path, addr.sun_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return std::unexpected(error_message("Unable to create socket"));
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        auto error = error_message(std::format("Unable to listen on {}", path));
+        close(fd);
+        return std::unexpected(error);
+    }
+    return std::unique_ptr<StreamServer>(new StreamServer(fd, path, 0, config));
+}
+
+std::expected<std::unique_ptr<StreamServer>, std::string>
+StreamServer::tcp(uint16_t port, StreamServerConfig config) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return std::unexpected(error_message("Unable to create socket"));
+    }
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(fd, 16) < 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &addr_len) < 0) {
+        auto error = error_message(std::format("Unable to listen on port {}", port));
+        close(fd);
+        return std::unexpected(error);
+    }
+    return std::unique_ptr<StreamServer>(new StreamServer(fd, "", ntohs(addr.sin_port), config));
+}
+
+StreamServer::StreamServer(int listen_fd, std::string path, uint16_t port,
+                           StreamServerConfig config)
+    : m_config(config), m_listen_fd(listen_fd),
+      m_wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), m_path(std::move(path)), m_port(port) {
+    m_thread = std::thread([this] { run(); });
+}
+
+StreamServer::~StreamServer() {
+    m_stopping = true;
+    wake();
+    m_thread.join();
+    for (auto &client : m_clients) {
+        close(client->fd);
+    }
+    close(m_listen_fd);
+    close(m_wake_fd);
+    if (!m_path.empty()) {
+        unlink(m_path.c_str());
+    }
+}
+
+size_t StreamServer::clients() const {
+    std::lock_guard lock(m_mutex);
+    return m_clients.size();
+}
+
+void StreamServer::wake() {
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(m_wake_fd, &one, sizeof(one));
+}
+
+// ========================================= Publishing ========================================= //
+void StreamServer::publish(const can_frame &frame, Clock::time_point timestamp) {
+    publish_records(frame, nullptr, timestamp);
+}
+
+void StreamServer::publish(const can_frame &frame, const NmeaMessage &message,
+                           Clock::time_point timestamp) {
+    publish_records(frame, &message, timestamp);
+}
+
+void StreamServer::publish_records(const can_frame &frame, const NmeaMessage *message,
+                                   Clock::time_point timestamp) {
+    bool needs_wake = false;
+    std::lock_guard lock(m_mutex);
+    if (m_clients.empty()) {
+        return;
+    }
+
+    // The server thread only has to look again when a client gets its first queued record, for
+    // the coalescing deadline, or has enough queued to be flushed right away
+    auto queue = [&](StreamClient &client) {
+        if (client.overrun) {
+            return;
+        }
+        if (client.queued + m_record.size() > m_config.max_queued) {
+            client.overrun = true;
+            needs_wake = true;
+            return;
+        }
+        const bool was_empty = client.queued == 0;
+        client.queue(m_record, timestamp);
+        needs_wake = needs_wake || was_empty || client.queued >= m_config.flush_threshold;
+    };
+
+    begin_record(m_record, stream::RAW_FRAME, timestamp);
+    put_u32(m_record, frame.can_id);
+    m_record.push_back(frame.can_dlc);
+    m_record.insert(m_record.end(), frame.data, frame.data + std::min<size_t>(frame.can_dlc, 8));
+    end_record(m_record);
+    const uint32_t pgn = frame_pgn(frame);
+    for (auto &client : m_clients) {
+        if (client->wants(stream::SUBSCRIBE_RAW, pgn)) {
+            queue(*client);
+        }
+    }
+
+    if (message) {
+        const uint32_t message_pgn =
+            std::visit([](const auto &m) { return message::pgn_of(m); }, *message);
+        const bool wanted = std::ranges::any_of(m_clients, [&](const auto &client) {
+            return client->wants(stream::SUBSCRIBE_DECODED, message_pgn);
+        });
+        if (wanted) {
+            m_json.add(*message, static_cast<uint8_t>(frame.can_id & 0xFF), timestamp);
+            auto json = m_json.finish();
+            json.remove_suffix(1); // The newline between JSON lines
+            begin_record(m_record, stream::DECODED_MESSAGE, timestamp);
+            m_record.insert(m_record.end(), json.begin(), json.end());
+            end_record(m_record);
+            for (auto &client : m_clients) {
+                if (client->wants(stream::SUBSCRIBE_DECODED, message_pgn)) {
+                    queue(*client);
+                }
+            }
+        }
+    }
+
+    if (needs_wake) {
+        wake();
+    }
+}
+
+// ======================================== Server Thread ======================================= //
+void StreamServer::accept_clients() {
+    while (true) {
+        int fd = accept4(m_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        auto client = std::make_unique<StreamClient>();
+        client->fd = fd;
+        std::lock_guard lock(m_mutex);
+        m_clients.push_back(std::move(client));
+    }
+}
+
+// Whether the client is still connected
+bool StreamServer::read_subscription(StreamClient &client) {
+    std::array<uint8_t, 1024> chunk;
+    while (true) {
+        auto nbytes = ::read(client.fd, chunk.data(), chunk.size());
+        if (nbytes == 0) {
+            return false;
+        }
+        if (nbytes < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        client.input.insert(client.input.end(), chunk.begin(), chunk.begin() + nbytes);
+        if (client.input.size() > internal::STREAM_MAX_INPUT) {
+            return false;
+        }
+
+        size_t offset = 0;
+        while (client.input.size() - offset >= 3) {
+            const size_t length = client.input[offset] | (size_t{client.input[offset + 1]} << 8);
+            if (client.input.size() - offset - 2 < length) {
+                break;
+            }
+            const uint8_t *record = client.input.data() + offset + 2;
+            if (length >= 2 && record[0] == stream::SUBSCRIBE && (length - 2) % 4 == 0) {
+                std::lock_guard lock(m_mutex);
+                client.subscribed = record[1];
+                client.pgns.clear();
+                for (size_t i = 2; i < length; i += 4) {
+                    client.pgns.push_back(static_cast<uint32_t>(record[i]) |
+                                          (static_cast<uint32_t>(record[i + 1]) << 8) |
+                                          (static_cast<uint32_t>(record[i + 2]) << 16) |
+                                          (static_cast<uint32_t>(record[i + 3]) << 24));
+                }
+                std::ranges::sort(client.pgns);
+            }
+            offset += 2 + length;
+        }
+        client.input.erase(client.input.begin(), client.input.begin() + offset);
+    }
+}
+
+// Write whatever the client is sending with a single sendmsg, without holding the lock. Whether
+// the client is still connected
+bool StreamServer::flush(StreamClient &client) {
+    std::array<iovec, internal::STREAM_MAX_IOVECS> iov;
+    size_t count = 0;
+    for (auto &block : client.sending) {
+        if (count == iov.size()) {
+            break;
+        }
+        const size_t skip = count == 0 ? client.sent : 0;
+        iov[count++] = {.iov_base = block.data() + skip, .iov_len = block.size() - skip};
+    }
+
+    msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = count;
+    // A client that went away must not raise SIGPIPE, which would kill the process reading the bus
+    auto written = ::sendmsg(client.fd, &msg, MSG_NOSIGNAL);
+    if (written < 0) {
+        return errno == EAGAIN || errno == EINTR;
+    }
+
+    auto remaining = static_cast<size_t>(written);
+    client.written += remaining;
+    while (remaining > 0) {
+        auto &front = client.sending.front();
+        const size_t left = front.size() - client.sent;
+        if (remaining < left) {
+            client.sent += remaining;
+            break;
+        }
+        remaining -= left;
+        client.sent = 0;
+        front.clear();
+        client.written_blocks.push_back(std::move(front));
+        client.sending.pop_front();
+    }
+    return true;
+}
+
+void StreamServer::run() {
+    std::vector<pollfd> fds;
+    std::vector<bool> connected;
+    while (!m_stopping) {
+        const auto now = Clock::now();
+        int timeout = -1;
+        fds.clear();
+        fds.push_back({.fd = m_listen_fd, .events = POLLIN, .revents = 0});
+        fds.push_back({.fd = m_wake_fd, .events = POLLIN, .revents = 0});
+        {
+            std::lock_guard lock(m_mutex);
+            for (auto &client : m_clients) {
+                short events = POLLIN;
+                if (client->queued > 0) {
+                    const auto due = client->first_queued + m_config.coalesce_delay;
+                    if (client->queued >= m_config.flush_threshold || due <= now) {
+                        events |= POLLOUT;
+                    } else {
+                        const auto wait =
+                            std::chrono::ceil<std::chrono::milliseconds>(due - now).count();
+                        timeout = timeout < 0 ? static_cast<int>(wait)
+                                              : std::min(timeout, static_cast<int>(wait));
+                    }
+                }
+                fds.push_back({.fd = client->fd, .events = events, .revents = 0});
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) {
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t count = 0;
+            [[maybe_unused]] auto nbytes = ::read(m_wake_fd, &count, sizeof(count));
+        }
+        if (fds[0].revents & POLLIN) {
+            accept_clients();
+        }
+
+        // Clients are only added or removed on this thread, so they line up with `fds`, and the
+        // list can be read without the lock. Subscriptions are read first, without holding it
+        connected.assign(fds.size() - 2, true);
+        for (size_t i = 2; i < fds.size(); i++) {
+            auto &client = *m_clients[i - 2];
+            if (fds[i].revents & (POLLERR | POLLHUP)) {
+                connected[i - 2] = false;
+            } else if (fds[i].revents & POLLIN) {
+                connected[i - 2] = read_subscription(client);
+            }
+        }
+
+        // The queued blocks are taken over under the lock and written without it, so that a slow
+        // client never holds up the thread publishing the bus traffic
+        {
+            std::lock_guard lock(m_mutex);
+            for (size_t i = 2; i < fds.size(); i++) {
+                auto &client = *m_clients[i - 2];
+                if (client.overrun) {
+                    m_dropped++;
+                    connected[i - 2] = false;
+                }
+                if (connected[i - 2] && (fds[i].revents & POLLOUT)) {
+                    std::ranges::move(client.blocks, std::back_inserter(client.sending));
+                    client.blocks.clear();
+                }
+            }
+        }
+        for (size_t i = 2; i < fds.size(); i++) {
+            auto &client = *m_clients[i - 2];
+            if (connected[i - 2] && (fds[i].revents & POLLOUT)) {
+                connected[i - 2] = flush(client);
+            }
+        }
+
+        std::lock_guard lock(m_mutex);
+        for (size_t i = 2; i < fds.size(); i++) {
+            auto &client = *m_clients[i - 2];
+            if (fds[i].revents & POLLOUT) {
+                client.queued -= client.written;
+                client.written = 0;
+                std::ranges::move(client.written_blocks, std::back_inserter(client.spare_blocks));
+                client.written_blocks.clear();
+                if (!client.sending.empty()) {
+                    // Whatever is left goes out as soon as the socket has room again
+                    client.first_queued = Clock::time_point{};
+                } else if (client.queued > 0) {
+                    // Queued while writing, with the deadline of the records written
+                    client.first_queued = Clock::now();
+                }
+            }
+            if (!connected[i - 2]) {
+                close(client.fd);
+                client.fd = -1;
+            }
+        }
+        std::erase_if(m_clients, [](const auto &client) { return client->fd < 0; });
+    }
+}
+
+} // namespace nmea
@@ -0,0 +1,33 @@
+#include "nmea/text_logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace nmea {
+
+TextLogger::TextLogger(int fd, TextLoggerConfig config) : m_fd(fd), m_config(config) {
+    m_buffer.reserve(m_config.flush_threshold);
+}
+
+TextLogger::~TextLogger() { auto _ = flush(); }
+
+std::expected<void, std::string> TextLogger::flush() {
+    size_t written = 0;
+    while (written < m_buffer.size()) {
+        auto nbytes = ::write(m_fd, m_buffer.data() + written, m_buffer.size() - written);
+        if (nbytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Drop what could not be written, so a broken output does not grow the buffer forever
+            m_buffer.clear();
+            return std::unexpected(std::format("Unable to write log: {}", std::strerror(errno)));
+        }
+        written += static_cast<size_t>(nbytes);
+    }
+    // Keeps the capacity for the next batch
+    m_buffer.clear();
+    return {};
+}
+
+} // namespace nmea
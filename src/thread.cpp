@@ -0,0 +1,60 @@
+#include "nmea/thread.hpp"
+#include <cstring>
+#include <format>
+#include <future>
+#include <pthread.h>
+#include <sched.h>
+#include <utility>
+
+namespace nmea {
+std::expected<void, std::string> configure_thread(const ThreadOptions &options) {
+    if (!options.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : options.cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                return std::unexpected(std::format("Invalid CPU {}", cpu));
+            }
+            CPU_SET(cpu, &set);
+        }
+        // pthread functions return the error instead of setting errno
+        if (int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+            return std::unexpected(
+                std::format("Unable to set thread affinity: {}", std::strerror(error)));
+        }
+    }
+    if (options.fifo_priority) {
+        sched_param param{};
+        param.sched_priority = *options.fifo_priority;
+        if (int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+            return std::unexpected(
+                std::format("Unable to set SCHED_FIFO priority {}: {}", *options.fifo_priority,
+                            std::strerror(error)));
+        }
+    }
+    return {};
+}
+
+std::expected<std::thread, std::string> start_thread(const ThreadOptions &options,
+                                                     std::function<void()> function) {
+    std::promise<std::expected<void, std::string>> configured;
+    auto result = configured.get_future();
+    // The thread configures itself, so that `function` never runs with the default scheduling
+    std::thread thread([&options, configured = std::move(configured),
+                        function = std::move(function)]() mutable {
+        auto applied = configure_thread(options);
+        const bool ok = applied.has_value();
+        // `options` belongs to the starting thread, which may return once this is set
+        configured.set_value(std::move(applied));
+        if (ok) {
+            function();
+        }
+    });
+    auto applied = result.get();
+    if (!applied) {
+        thread.join();
+        return std::unexpected(applied.error());
+    }
+    return thread;
+}
+} // namespace nmea
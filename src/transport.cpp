@@ -0,0 +1,316 @@
+#include "nmea/transport.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <linux/can.h>
+#include <linux/can/j1939.h>
+#include <linux/can/raw.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace nmea {
+
+constexpr uint32_t PGN_ADDRESS_CLAIM = 60928;
+
+// PDU1 PGNs carry the destination address in their lower byte
+static bool is_pdu1(uint32_t pgn) { return ((pgn >> 8) & 0xFF) < 240; }
+
+uint32_t Packet::can_id() const {
+    uint32_t id = CAN_EFF_FLAG | (uint32_t(priority & 0x07) << 26) | (pgn << 8) | source;
+    if (is_pdu1(pgn)) {
+        id = (id & ~0xFF00u) | (uint32_t(destination) << 8);
+    }
+    return id;
+}
+
+std::expected<size_t, std::string> Transport::write_batch(std::span<const can_frame> frames) {
+    size_t written = 0;
+    for (const auto &frame : frames) {
+        if (auto result = write(frame); !result) {
+            if (written == 0) {
+                return std::unexpected(result.error());
+            }
+            break;
+        }
+        written++;
+    }
+    return written;
+}
+
+std::expected<void, std::string> Transport::reconnect(connection_t conn) {
+    close(conn);
+    return std::unexpected("Transport cannot reconnect");
+}
+
+// Swap the socket behind `target` for `conn` in one step, so that a thread using `target` never
+// sees it closed, or reused by another file
+static std::expected<void, std::string> replace_socket(connection_t target, connection_t conn) {
+    const int result = dup2(conn, target);
+    const int error = errno;
+    close(conn);
+    if (result == -1) {
+        return std::unexpected(std::format("Unable to replace socket: {}", std::strerror(error)));
+    }
+    return {};
+}
+
+std::expected<void, std::string> Transport::read_packet(Packet & /* packet */) {
+    return std::unexpected("Transport does not reassemble packets");
+}
+
+std::expected<void, std::string> Transport::write_packet(const Packet & /* packet */) {
+    return std::unexpected("Transport does not reassemble packets");
+}
+
+std::unique_ptr<Transport> socket_transport(connection_t conn) {
+    int protocol = 0;
+    socklen_t length = sizeof(protocol);
+    if (getsockopt(conn, SOL_SOCKET, SO_PROTOCOL, &protocol, &length) == 0 &&
+        protocol == CAN_J1939) {
+        return std::make_unique<J1939Transport>(conn);
+    }
+    return std::make_unique<SocketTransport>(conn);
+}
+
+// ====================================== SocketTransport ======================================= //
+
+SocketTransport::SocketTransport(connection_t conn) : m_conn(conn) {}
+
+SocketTransport::~SocketTransport() {
+    if (m_conn != -1) {
+        close(m_conn);
+    }
+}
+
+std::expected<void, std::string> SocketTransport::read(can_frame &frame) {
+    auto nbytes = ::read(m_conn, &frame, sizeof(frame));
+    if (nbytes < 0) {
+        return std::unexpected("Unable to read from socket");
+    }
+    if (nbytes < static_cast<ssize_t>(sizeof(frame))) {
+        return std::unexpected("Incomplete CAN frame");
+    }
+    return {};
+}
+
+std::expected<void, std::string> SocketTransport::write(const can_frame &frame) {
+    if (::write(m_conn, &frame, sizeof(frame)) < 0) {
+        return std::unexpected("Unable to write to socket");
+    }
+    return {};
+}
+
+std::expected<size_t, std::string>
+SocketTransport::write_batch(std::span<const can_frame> frames) {
+    std::array<iovec, MAX_BATCH> iovecs;
+    std::array<mmsghdr, MAX_BATCH> headers;
+    size_t written = 0;
+    while (written < frames.size()) {
+        const size_t count = std::min(MAX_BATCH, frames.size() - written);
+        for (size_t i = 0; i < count; i++) {
+            // sendmmsg() does not write to the frames
+            iovecs[i] = {.iov_base = const_cast<can_frame *>(&frames[written + i]),
+                         .iov_len = sizeof(can_frame)};
+            headers[i] = {};
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+        // Stops at the first frame that cannot be written, which the next call then fails on
+        const int sent = ::sendmmsg(m_conn, headers.data(), static_cast<unsigned int>(count), 0);
+        if (sent <= 0) {
+            if (written == 0) {
+                return std::unexpected(
+                    std::format("Unable to write to socket: {}", std::strerror(errno)));
+            }
+            break;
+        }
+        written += static_cast<size_t>(sent);
+    }
+    return written;
+}
+
+std::expected<void, std::string> SocketTransport::reconnect(connection_t conn) {
+    // A new socket receives every frame, the filter installed on the old one is carried over. The
+    // kernel reports the size needed when the buffer is too small
+    std::vector<can_filter> filters(1);
+    auto length = static_cast<socklen_t>(filters.size() * sizeof(can_filter));
+    int result = getsockopt(m_conn, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(), &length);
+    if (result == -1 && errno == ERANGE) {
+        filters.resize(length / sizeof(can_filter));
+        result = getsockopt(m_conn, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(), &length);
+    }
+    // Fails for sockets that are not CAN_RAW ones, which have no filter
+    if (result == 0 &&
+        setsockopt(conn, SOL_CAN_RAW, CAN_RAW_FILTER, filters.data(), length) == -1) {
+        const int error = errno;
+        close(conn);
+        return std::unexpected(std::format("Unable to filter socket: {}", std::strerror(error)));
+    }
+    return replace_socket(m_conn, conn);
+}
+
+bool SocketTransport::wait(std::chrono::milliseconds timeout) {
+    pollfd pfd{.fd = m_conn, .events = POLLIN, .revents = 0};
+    return ::poll(&pfd, 1, static_cast<int>(timeout.count())) > 0;
+}
+
+// ======================================= J1939Transport ======================================= //
+J1939Transport::J1939Transport(connection_t conn) : m_conn(conn), m_buffer(MAX_PACKET_SIZE) {
+    sockaddr_can addr{};
+    socklen_t length = sizeof(addr);
+    if (getsockname(m_conn, reinterpret_cast<sockaddr *>(&addr), &length) == 0) {
+        m_ifindex = addr.can_ifindex;
+    }
+}
+
+J1939Transport::~J1939Transport() {
+    if (m_conn != -1) {
+        close(m_conn);
+    }
+}
+
+std::expected<void, std::string> J1939Transport::receive(Packet &packet) {
+    sockaddr_can addr{};
+    iovec iov{.iov_base = m_buffer.data(), .iov_len = m_buffer.size()};
+    alignas(cmsghdr) char control[2 * CMSG_SPACE(sizeof(uint8_t)) + CMSG_SPACE(sizeof(uint64_t))];
+    msghdr msg{};
+    msg.msg_name = &addr;
+    msg.msg_namelen = sizeof(addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    const auto nbytes = recvmsg(m_conn, &msg, MSG_TRUNC);
+    if (nbytes < 0) {
+        return std::unexpected("Unable to read from socket");
+    }
+    if (static_cast<size_t>(nbytes) > m_buffer.size()) {
+        return std::unexpected(std::format("Packet of {} bytes is too large", nbytes));
+    }
+
+    packet.pgn = addr.can_addr.j1939.pgn;
+    packet.source = addr.can_addr.j1939.addr;
+    packet.priority = 6;
+    packet.destination = J1939_NO_ADDR;
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_CAN_J1939) {
+            continue;
+        }
+        if (cmsg->cmsg_type == SCM_J1939_DEST_ADDR) {
+            packet.destination = *CMSG_DATA(cmsg);
+        } else if (cmsg->cmsg_type == SCM_J1939_PRIO) {
+            packet.priority = *CMSG_DATA(cmsg);
+        }
+    }
+    packet.data.assign(m_buffer.begin(), m_buffer.begin() + nbytes);
+    return {};
+}
+
+std::expected<void, std::string> J1939Transport::read_packet(Packet &packet) {
+    return receive(packet);
+}
+
+std::expected<void, std::string> J1939Transport::read(can_frame &frame) {
+    // Longer packets have no frame of their own, they are only available as packets
+    do {
+        if (auto result = receive(m_packet); !result) {
+            return result;
+        }
+    } while (m_packet.data.size() > CAN_MAX_DLEN);
+
+    frame = can_frame{};
+    frame.can_id = m_packet.can_id();
+    frame.can_dlc = static_cast<uint8_t>(m_packet.data.size());
+    std::copy(m_packet.data.begin(), m_packet.data.end(), frame.data);
+    return {};
+}
+
+std::expected<void, std::string> J1939Transport::send(uint32_t pgn, uint8_t priority,
+                                                      uint8_t source, uint8_t destination,
+                                                      std::span<const uint8_t> data) {
+    // Claims are sent from the thread that processes frames, which also reconnects, while other
+    // threads send
+    std::lock_guard lock(m_mutex);
+
+    // The kernel only sends an address claim from a socket bound to the NAME it claims for, which
+    // then also keeps the source address of the other PGNs sent from the socket up to date
+    uint64_t name = m_bound_name;
+    if (pgn == PGN_ADDRESS_CLAIM && data.size() == 8) {
+        name = 0;
+        for (size_t i = 0; i < 8; i++) {
+            name |= uint64_t{data[i]} << (i * 8);
+        }
+    }
+    if (m_bound_source != source || m_bound_name != name) {
+        sockaddr_can addr{};
+        addr.can_family = AF_CAN;
+        addr.can_ifindex = m_ifindex;
+        addr.can_addr.j1939 = {.name = name, .pgn = J1939_NO_PGN, .addr = source};
+        if (bind(m_conn, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            return std::unexpected(std::format("Unable to bind to address {}", source));
+        }
+        m_bound_source = source;
+        m_bound_name = name;
+    }
+    if (m_send_priority != priority) {
+        const int value = priority;
+        if (setsockopt(m_conn, SOL_CAN_J1939, SO_J1939_SEND_PRIO, &value, sizeof(value)) < 0) {
+            return std::unexpected("Unable to set the priority");
+        }
+        m_send_priority = priority;
+    }
+
+    sockaddr_can addr{};
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = m_ifindex;
+    addr.can_addr.j1939 = {
+        .name = J1939_NO_NAME,
+        .pgn = is_pdu1(pgn) ? pgn & 0x3FF00 : pgn,
+        .addr = is_pdu1(pgn) ? destination : static_cast<uint8_t>(J1939_NO_ADDR),
+    };
+    if (sendto(m_conn, data.data(), data.size(), 0, reinterpret_cast<sockaddr *>(&addr),
+               sizeof(addr)) < 0) {
+        return std::unexpected("Unable to write to socket");
+    }
+    return {};
+}
+
+std::expected<void, std::string> J1939Transport::write(const can_frame &frame) {
+    const uint32_t pgn = (frame.can_id >> 8) & 0x3FFFF;
+    return send(is_pdu1(pgn) ? pgn & 0x3FF00 : pgn, (frame.can_id >> 26) & 0x07,
+                frame.can_id & 0xFF, is_pdu1(pgn) ? pgn & 0xFF : J1939_NO_ADDR,
+                std::span<const uint8_t>(frame.data, std::min<size_t>(frame.can_dlc, 8)));
+}
+
+bool J1939Transport::wait(std::chrono::milliseconds timeout) {
+    pollfd pfd{.fd = m_conn, .events = POLLIN, .revents = 0};
+    return ::poll(&pfd, 1, static_cast<int>(timeout.count())) > 0;
+}
+
+std::expected<void, std::string> J1939Transport::reconnect(connection_t conn) {
+    std::lock_guard lock(m_mutex);
+    if (auto replaced = replace_socket(m_conn, conn); !replaced) {
+        return replaced;
+    }
+    // A new socket is not bound to a source address, and the interface may have a new index
+    sockaddr_can addr{};
+    socklen_t length = sizeof(addr);
+    if (getsockname(m_conn, reinterpret_cast<sockaddr *>(&addr), &length) == 0) {
+        m_ifindex = addr.can_ifindex;
+    }
+    m_bound_source.reset();
+    m_bound_name = J1939_NO_NAME;
+    m_send_priority.reset();
+    return {};
+}
+
+std::expected<void, std::string> J1939Transport::write_packet(const Packet &packet) {
+    return send(packet.pgn, packet.priority, packet.source, packet.destination, packet.data);
+}
+
+} // namespace nmea
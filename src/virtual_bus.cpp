@@ -0,0 +1,229 @@
+#include "nmea/virtual_bus.hpp"
+#include "nmea/bus_load.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <linux/can.h>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace nmea {
+namespace internal {
+
+using Clock = std::chrono::steady_clock;
+
+struct PendingFrame {
+    can_frame frame;
+    uint64_t seq;
+    uint32_t sender;
+    Clock::time_point submitted;
+};
+
+struct ReceivedFrame {
+    can_frame frame;
+    Clock::time_point ready;
+};
+
+struct VirtualNode {
+    uint32_t id;
+    std::deque<ReceivedFrame> rx;
+    std::condition_variable cv;
+};
+
+struct VirtualBusState {
+    std::mutex mutex;
+    VirtualBusConfig config;
+    std::mt19937 rng;
+    std::bernoulli_distribution loss;
+    std::vector<VirtualNode *> nodes;
+    std::vector<PendingFrame> pending;
+    Clock::time_point busy_until{};
+    uint64_t next_seq = 0;
+    uint32_t next_node = 0;
+    uint64_t transmitted = 0;
+    uint64_t dropped = 0;
+
+    explicit VirtualBusState(VirtualBusConfig cfg)
+        : config(cfg), rng(cfg.seed), loss(std::clamp(cfg.loss, 0.0, 1.0)) {}
+
+    Clock::duration frame_time(const can_frame &frame) const {
+        if (config.bitrate == 0) {
+            return Clock::duration::zero();
+        }
+        const uint64_t bits = BusLoad::frame_bits(frame);
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(
+            bits * 1'000'000'000ull / config.bitrate));
+    }
+
+    // When the bus next becomes free for a pending frame to start transmitting
+    std::optional<Clock::time_point> next_start() const {
+        if (pending.empty()) {
+            return std::nullopt;
+        }
+        auto earliest = std::min_element(
+            pending.begin(), pending.end(),
+            [](const auto &a, const auto &b) { return a.submitted < b.submitted; });
+        return std::max(busy_until, earliest->submitted);
+    }
+
+    // Wake every node, so that one waiting without a deadline drives the bus once it is free
+    void wake_nodes() {
+        for (auto *node : nodes) {
+            node->cv.notify_all();
+        }
+    }
+
+    void deliver(const PendingFrame &pending_frame, Clock::time_point ready) {
+        for (auto *node : nodes) {
+            if (node->id == pending_frame.sender) {
+                continue;
+            }
+            if (config.loss > 0 && loss(rng)) {
+                dropped++;
+                continue;
+            }
+            node->rx.push_back({pending_frame.frame, ready});
+            node->cv.notify_one();
+        }
+    }
+
+    // Run arbitration for every frame that could have started transmitting by `now`. Whenever the
+    // bus becomes free, the pending frame with the lowest id wins
+    void advance(Clock::time_point now) {
+        while (auto start = next_start()) {
+            if (*start > now) {
+                break;
+            }
+            auto winner = pending.end();
+            for (auto iter = pending.begin(); iter != pending.end(); ++iter) {
+                if (iter->submitted > *start) {
+                    continue;
+                }
+                if (winner == pending.end() ||
+                    (iter->frame.can_id & CAN_EFF_MASK) < (winner->frame.can_id & CAN_EFF_MASK) ||
+                    ((iter->frame.can_id & CAN_EFF_MASK) == (winner->frame.can_id & CAN_EFF_MASK) &&
+                     iter->seq < winner->seq)) {
+                    winner = iter;
+                }
+            }
+            busy_until = *start + frame_time(winner->frame);
+            transmitted++;
+            deliver(*winner, busy_until + config.latency);
+            pending.erase(winner);
+        }
+    }
+};
+
+} // namespace internal
+
+namespace {
+
+class VirtualTransport : public Transport {
+public:
+    explicit VirtualTransport(std::shared_ptr<internal::VirtualBusState> state)
+        : m_state(std::move(state)) {
+        std::lock_guard lock(m_state->mutex);
+        m_node.id = m_state->next_node++;
+        m_state->nodes.push_back(&m_node);
+    }
+
+    ~VirtualTransport() override {
+        std::lock_guard lock(m_state->mutex);
+        std::erase(m_state->nodes, &m_node);
+    }
+
+    VirtualTransport(const VirtualTransport &other) = delete;
+    VirtualTransport &operator=(const VirtualTransport &other) = delete;
+    VirtualTransport(VirtualTransport &&other) noexcept = delete;
+    VirtualTransport &operator=(VirtualTransport &&other) noexcept = delete;
+
+    std::expected<void, std::string> read(can_frame &frame) override {
+        std::unique_lock lock(m_state->mutex);
+        wait_ready(lock, std::nullopt);
+        frame = m_node.rx.front().frame;
+        m_node.rx.pop_front();
+        return {};
+    }
+
+    std::expected<void, std::string> write(const can_frame &frame) override {
+        std::lock_guard lock(m_state->mutex);
+        const auto now = internal::Clock::now();
+        m_state->pending.push_back({frame, m_state->next_seq++, m_node.id, now});
+        m_state->advance(now);
+        if (!m_state->pending.empty()) {
+            // The bus is busy. Readers waiting for nothing in particular must wake up when it is
+            // free, or the frame stays queued until the next write
+            m_state->wake_nodes();
+        }
+        return {};
+    }
+
+    bool wait(std::chrono::milliseconds timeout) override {
+        std::unique_lock lock(m_state->mutex);
+        return wait_ready(lock, internal::Clock::now() + timeout);
+    }
+
+    int fd() const override { return -1; }
+
+private:
+    // Wait until the frame at the front of the queue is readable, driving the bus while waiting
+    bool wait_ready(std::unique_lock<std::mutex> &lock,
+                    std::optional<internal::Clock::time_point> deadline) {
+        while (true) {
+            const auto now = internal::Clock::now();
+            m_state->advance(now);
+
+            std::optional<internal::Clock::time_point> wake = deadline;
+            if (!m_node.rx.empty()) {
+                const auto ready = m_node.rx.front().ready;
+                if (ready <= now) {
+                    return true;
+                }
+                wake = wake ? std::min(*wake, ready) : ready;
+            }
+            if (auto start = m_state->next_start()) {
+                wake = wake ? std::min(*wake, *start) : *start;
+            }
+            if (deadline && now >= *deadline) {
+                return false;
+            }
+
+            if (wake) {
+                m_node.cv.wait_until(lock, *wake);
+            } else {
+                m_node.cv.wait(lock);
+            }
+        }
+    }
+
+    std::shared_ptr<internal::VirtualBusState> m_state;
+    internal::VirtualNode m_node;
+};
+
+} // namespace
+
+VirtualBus::VirtualBus(VirtualBusConfig config)
+    : m_state(std::make_shared<internal::VirtualBusState>(config)) {}
+
+std::unique_ptr<Transport> VirtualBus::attach() {
+    return std::make_unique<VirtualTransport>(m_state);
+}
+
+size_t VirtualBus::nodes() const {
+    std::lock_guard lock(m_state->mutex);
+    return m_state->nodes.size();
+}
+
+uint64_t VirtualBus::frames_transmitted() const {
+    std::lock_guard lock(m_state->mutex);
+    return m_state->transmitted;
+}
+
+uint64_t VirtualBus::frames_dropped() const {
+    std::lock_guard lock(m_state->mutex);
+    return m_state->dropped;
+}
+
+} // namespace nmea
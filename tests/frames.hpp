@@ -0,0 +1,60 @@
+#pragma once
+
+#include "nmea/message.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <linux/can.h>
+#include <vector>
+
+// Frames shared by the tests
+
+// Single frame Heave from `source`, told apart by its `sid`
+inline can_frame heave_frame(uint8_t source, uint8_t sid) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (3u << 26) | (nmea::pgn::HEAVE << 8) | source;
+    frame.can_dlc = 8;
+    frame.data[0] = sid;
+    return frame;
+}
+
+// Frames of `msg` as sent by `source`, using TP BAM if it does not fit a single frame
+inline std::vector<can_frame> message_frames(const nmea::NmeaMessage &msg, uint8_t source) {
+    auto serialized = nmea::serialize(msg);
+    std::vector<can_frame> result;
+    if (serialized.data.size() <= 8) {
+        can_frame frame{};
+        frame.can_id = CAN_EFF_FLAG | (2u << 26) | (serialized.pgn << 8) | source;
+        frame.can_dlc = static_cast<uint8_t>(serialized.data.size());
+        std::ranges::copy(serialized.data, frame.data);
+        result.push_back(frame);
+        return result;
+    }
+
+    const auto size = static_cast<uint16_t>(serialized.data.size());
+    const auto packets = static_cast<uint8_t>((size + 6) / 7);
+    can_frame bam{};
+    bam.can_id = CAN_EFF_FLAG | (6u << 26) | (0xECu << 16) | (0xFFu << 8) | source;
+    bam.can_dlc = 8;
+    bam.data[0] = 0x20;
+    bam.data[1] = static_cast<uint8_t>(size);
+    bam.data[2] = static_cast<uint8_t>(size >> 8);
+    bam.data[3] = packets;
+    bam.data[4] = 0xFF;
+    bam.data[5] = static_cast<uint8_t>(serialized.pgn);
+    bam.data[6] = static_cast<uint8_t>(serialized.pgn >> 8);
+    bam.data[7] = static_cast<uint8_t>(serialized.pgn >> 16);
+    result.push_back(bam);
+    for (uint8_t seq = 1; seq <= packets; seq++) {
+        can_frame dt{};
+        dt.can_id = CAN_EFF_FLAG | (6u << 26) | (0xEBu << 16) | (0xFFu << 8) | source;
+        dt.can_dlc = 8;
+        dt.data[0] = seq;
+        for (size_t i = 0; i < 7; i++) {
+            const size_t idx = (seq - 1) * 7 + i;
+            dt.data[i + 1] = idx < size ? serialized.data[idx] : 0xFF;
+        }
+        result.push_back(dt);
+    }
+    return result;
+}
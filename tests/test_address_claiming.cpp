@@ -2,9 +2,12 @@
 #include "nmea/device.hpp"
 #include <chrono>
 #include <cstdint>
+#include <expected>
 #include <gtest/gtest.h>
 #include <linux/can.h>
+#include <poll.h>
 #include <optional>
+#include <string>
 #include <sys/socket.h>
 #include <thread>
 #include <unistd.h>
@@ -47,6 +50,16 @@ protected:
 
     void TearDown() override { close(other_device); }
 
+    std::optional<can_frame> read_other_device() {
+        pollfd pfd{.fd = other_device, .events = POLLIN, .revents = {}};
+        can_frame frame{};
+        if (poll(&pfd, 1, 1000) <= 0 ||
+            read(other_device, &frame, sizeof(frame)) != sizeof(frame)) {
+            return std::nullopt;
+        }
+        return frame;
+    }
+
     void send_other_device_address(uint8_t address) {
         can_frame frame{};
         frame.can_id = CAN_EFF_FLAG | (6u << 26) | (0xEEu << 16) | (0xFFu << 8) | address;
@@ -90,6 +103,32 @@ TEST_F(AddressClaimTest, SecondClaimWhileInProgressReturnsError) {
     EXPECT_EQ(second.get().error(), "Address claim already in progress");
 }
 
+TEST_F(AddressClaimTest, SecondAsyncClaimWhileInProgressReturnsError) {
+    std::optional<std::expected<void, std::string>> first;
+    std::optional<std::expected<void, std::string>> second;
+    auto claim = [&](auto &result) -> nmea::Task<> {
+        result = co_await device->claim_async(arbitrary_name);
+    };
+    nmea::Executor executor;
+    executor.spawn(claim(first));
+    executor.spawn(claim(second));
+    executor.run();
+
+    ASSERT_TRUE(first && second);
+    EXPECT_TRUE(first->has_value());
+    ASSERT_FALSE(second->has_value());
+    EXPECT_EQ(second->error(), "Address claim already in progress");
+}
+
+TEST_F(AddressClaimTest, ProcessWhileClaimingReturnsError) {
+    auto future = device->claim(arbitrary_name);
+    auto processed = device->process(std::chrono::milliseconds(0));
+    ASSERT_FALSE(processed.has_value());
+    EXPECT_EQ(processed.error(), "Address claim already in progress");
+    ASSERT_TRUE(future.get().has_value());
+    EXPECT_TRUE(device->process(std::chrono::milliseconds(0)).has_value());
+}
+
 TEST_F(AddressClaimTest, CanClaimAgainAfterCompletion) {
     ASSERT_TRUE(device->claim(arbitrary_name).get().has_value());
     ASSERT_TRUE(device->claim(arbitrary_name).get().has_value());
@@ -105,3 +144,72 @@ TEST_F(AddressClaimTest, ConflictFailsWhenNotArbitraryAddressCapable) {
     ASSERT_FALSE(result.has_value());
     EXPECT_EQ(result.error(), "Address conflict. Device not arbitrary address capable");
 }
+
+TEST_F(AddressClaimTest, ClaimStartsWithRequestForAddressClaim) {
+    auto future = device->claim(arbitrary_name);
+
+    auto request = read_other_device();
+    ASSERT_TRUE(request.has_value());
+    EXPECT_EQ(request->can_id, CAN_EFF_FLAG | (6u << 26) | (0xEAu << 16) | (0xFFu << 8) | 254u);
+    ASSERT_EQ(request->can_dlc, 3);
+    EXPECT_EQ(request->data[0], 0x00);
+    EXPECT_EQ(request->data[1], 0xEE);
+    EXPECT_EQ(request->data[2], 0x00);
+
+    auto claim = read_other_device();
+    ASSERT_TRUE(claim.has_value());
+    EXPECT_EQ((claim->can_id >> 16) & 0xFF, 0xEEu);
+    EXPECT_EQ(claim->can_id & 0xFF, unique_number);
+    ASSERT_TRUE(future.get().has_value());
+}
+
+TEST_F(AddressClaimTest, KnownAddressesAreSkippedWithoutConflict) {
+    device->address_map().record(unique_number, 0);
+    device->address_map().record(unique_number + 1, 1);
+
+    auto future = device->claim(arbitrary_name);
+    auto _ = read_other_device();
+    auto claim = read_other_device();
+    ASSERT_TRUE(claim.has_value());
+    EXPECT_EQ(claim->can_id & 0xFF, unique_number + 2);
+
+    ASSERT_TRUE(future.get().has_value());
+    EXPECT_EQ(device->address(), unique_number + 2);
+}
+
+TEST_F(AddressClaimTest, ClaimsSeenWhileClaimingAreLearned) {
+    auto future = device->claim(arbitrary_name);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    send_other_device_address(unique_number);
+
+    ASSERT_TRUE(future.get().has_value());
+    EXPECT_EQ(device->address_map().name(unique_number), 0u);
+    EXPECT_TRUE(device->address_map().name(unique_number + 1).has_value());
+    EXPECT_EQ(device->address_map().size(), 2);
+}
+
+TEST_F(AddressClaimTest, NotArbitraryAddressCapableOnlyClaimsPreferredAddress) {
+    // Held by a higher priority NAME, so the device cannot claim it and must not pick another
+    device->address_map().record(unique_number, 0);
+
+    auto result = device->claim(non_arbitrary_name).get();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Address conflict. Device not arbitrary address capable");
+    EXPECT_FALSE(device->address().has_value());
+
+    // Request for address claims, then the claim of the null address
+    auto _ = read_other_device();
+    auto cannot_claim = read_other_device();
+    ASSERT_TRUE(cannot_claim.has_value());
+    EXPECT_EQ((cannot_claim->can_id >> 16) & 0xFF, 0xEEu);
+    EXPECT_EQ(cannot_claim->can_id & 0xFF, 254u);
+}
+
+TEST_F(AddressClaimTest, AddressOfLowerPriorityNameIsClaimed) {
+    // The holder's NAME loses the contest, so the device claims its preferred address anyway
+    device->address_map().record(unique_number, UINT64_MAX);
+
+    ASSERT_TRUE(device->claim(arbitrary_name).get().has_value());
+    EXPECT_EQ(device->address(), unique_number);
+}
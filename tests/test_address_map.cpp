@@ -0,0 +1,119 @@
+#include "nmea/address_map.hpp"
+#include "nmea/device.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <gtest/gtest.h>
+#include <linux/can.h>
+
+static can_frame address_claim(uint8_t address, uint64_t name) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (6u << 26) | (0xEEu << 16) | (0xFFu << 8) | address;
+    frame.can_dlc = 8;
+    for (int i = 0; i < 8; ++i) {
+        frame.data[i] = static_cast<uint8_t>(name >> (i * 8));
+    }
+    return frame;
+}
+
+TEST(AddressMapTest, ObservesAddressClaims) {
+    nmea::AddressMap map;
+    map.observe(address_claim(0x23, 0x1122334455667788));
+
+    EXPECT_EQ(map.name(0x23), 0x1122334455667788u);
+    EXPECT_EQ(map.address(0x1122334455667788), 0x23);
+    EXPECT_EQ(map.size(), 1);
+}
+
+TEST(AddressMapTest, OtherFramesAreIgnored) {
+    nmea::AddressMap map;
+    can_frame frame = address_claim(0x23, 1);
+    frame.can_id = CAN_EFF_FLAG | (2u << 26) | (0x1F802u << 8) | 0x23;
+    map.observe(frame);
+
+    EXPECT_EQ(map.size(), 0);
+}
+
+TEST(AddressMapTest, NewClaimReplacesPreviousAddress) {
+    nmea::AddressMap map;
+    map.record(10, 5);
+    map.record(11, 5);
+
+    EXPECT_FALSE(map.name(10).has_value());
+    EXPECT_EQ(map.address(5), 11);
+}
+
+TEST(AddressMapTest, NullAddressRemovesDevice) {
+    nmea::AddressMap map;
+    map.record(10, 5);
+    map.observe(address_claim(254, 5));
+
+    EXPECT_FALSE(map.address(5).has_value());
+    EXPECT_EQ(map.size(), 0);
+}
+
+TEST(AddressMapTest, FreeAddressSkipsClaimedAddresses) {
+    nmea::AddressMap map;
+    map.record(10, 1);
+    map.record(11, 2);
+
+    EXPECT_EQ(map.free_address(10, 3), 12);
+    EXPECT_EQ(map.free_address(10, 1), 10);
+}
+
+TEST(AddressMapTest, FreeAddressWrapsAround) {
+    nmea::AddressMap map;
+    map.record(nmea::MAX_CLAIMABLE_ADDRESS, 1);
+
+    EXPECT_EQ(map.free_address(nmea::MAX_CLAIMABLE_ADDRESS, 2), 0);
+}
+
+TEST(AddressMapTest, NoFreeAddressWhenFull) {
+    nmea::AddressMap map;
+    for (uint8_t address = 0; address <= nmea::MAX_CLAIMABLE_ADDRESS; address++) {
+        map.record(address, address + 100);
+    }
+
+    EXPECT_FALSE(map.free_address(0, 1000).has_value());
+    map.clear();
+    EXPECT_EQ(map.free_address(0, 1000), 0);
+}
+
+TEST(AddressMapTest, AddressesOfLowerPriorityNamesAreFree) {
+    nmea::AddressMap map;
+    map.record(10, 5);
+    map.record(11, 1);
+
+    // The contest for 10 is won by the lower NAME 3, the one for 11 by its holder
+    EXPECT_EQ(map.free_address(10, 3), 10);
+    EXPECT_EQ(map.free_address(11, 3), 12);
+    EXPECT_FALSE(map.taken(10, 3));
+    EXPECT_TRUE(map.taken(11, 3));
+    EXPECT_FALSE(map.taken(12, 3));
+}
+
+TEST(AddressMapTest, ListenerFillsDeviceMap) {
+    nmea::VirtualBus bus;
+    nmea::Device other(bus.attach());
+    nmea::Device device(bus.attach());
+    nmea::Listener listener(bus.attach());
+    listener.set_address_map(&device.address_map());
+
+    nmea::DeviceName name{
+        .unique_number = 42,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    };
+    ASSERT_TRUE(other.claim(name).get().has_value());
+    auto _ = listener.read();
+    _ = listener.read();
+    ASSERT_TRUE(device.address_map().name(42).has_value());
+
+    name.unique_number = 42 + nmea::MAX_CLAIMABLE_ADDRESS + 1;
+    ASSERT_TRUE(device.claim(name).get().has_value());
+    EXPECT_EQ(device.address(), 43);
+}
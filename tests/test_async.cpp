@@ -0,0 +1,185 @@
+#include "frames.hpp"
+#include "nmea/async.hpp"
+#include "nmea/device.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <atomic>
+#include <chrono>
+#include <expected>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <memory>
+#include <set>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+static nmea::DeviceName device_name(uint32_t unique_number) {
+    return {
+        .unique_number = unique_number,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    };
+}
+
+static nmea::Task<int> add_after(int a, int b, std::chrono::milliseconds delay) {
+    co_await nmea::sleep_for(delay);
+    co_return a + b;
+}
+
+static nmea::Task<int> sum() {
+    int first = co_await add_after(1, 2, 10ms);
+    int second = co_await add_after(first, 3, 10ms);
+    co_return second;
+}
+
+TEST(AsyncTest, BlockOnReturnsResult) {
+    nmea::Executor executor;
+    EXPECT_EQ(executor.block_on(sum()), 6);
+    EXPECT_EQ(executor.pending(), 0);
+}
+
+TEST(AsyncTest, TimersResumeInOrder) {
+    nmea::Executor executor;
+    std::vector<int> order;
+    auto sleeper = [&](int id, std::chrono::milliseconds delay) -> nmea::Task<> {
+        co_await nmea::sleep_for(delay);
+        order.push_back(id);
+    };
+    executor.spawn(sleeper(1, 30ms));
+    executor.spawn(sleeper(2, 10ms));
+    executor.spawn(sleeper(3, 20ms));
+    executor.run();
+    EXPECT_EQ(order, (std::vector<int>{2, 3, 1}));
+}
+
+TEST(AsyncTest, RunsOnSeveralThreads) {
+    nmea::Executor executor;
+    std::atomic<int> done = 0;
+    auto sleeper = [&]() -> nmea::Task<> {
+        co_await nmea::sleep_for(5ms);
+        done++;
+    };
+    for (int i = 0; i < 1000; i++) {
+        executor.spawn(sleeper());
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&] { executor.run(); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(done, 1000);
+}
+
+TEST(AsyncTest, StopLeavesTasksSuspended) {
+    nmea::Executor executor;
+    auto forever = []() -> nmea::Task<> { co_await nmea::sleep_for(1h); };
+    executor.spawn(forever());
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(20ms);
+        executor.stop();
+    });
+    executor.run();
+    stopper.join();
+    EXPECT_EQ(executor.pending(), 1);
+}
+
+TEST(AsyncTest, RunsAgainAfterStop) {
+    nmea::Executor executor;
+    executor.stop();
+    auto brief = []() -> nmea::Task<> { co_await nmea::sleep_for(1ms); };
+    executor.spawn(brief());
+    executor.run();
+    EXPECT_EQ(executor.pending(), 1);
+
+    executor.run();
+    EXPECT_EQ(executor.pending(), 0);
+}
+
+TEST(AsyncTest, ListenerAwaitsSocket) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    nmea::Listener listener(fds[0]);
+
+    std::thread writer([&] {
+        std::this_thread::sleep_for(20ms);
+        auto frame = heave_frame(0x21, 5);
+        ASSERT_EQ(write(fds[1], &frame, sizeof(frame)), static_cast<ssize_t>(sizeof(frame)));
+    });
+    nmea::Executor executor;
+    auto message = executor.block_on(listener.next());
+    writer.join();
+    close(fds[1]);
+
+    ASSERT_TRUE(message.has_value()) << message.error();
+    EXPECT_EQ(std::get<nmea::message::Heave>(*message).sid, 5);
+    EXPECT_EQ(listener.last_source(), 0x21);
+}
+
+TEST(AsyncTest, ListenerAwaitsMessageType) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach());
+
+    can_frame temperature{};
+    temperature.can_id = CAN_EFF_FLAG | (5u << 26) | (nmea::pgn::TEMPERATURE << 8) | 0x10;
+    temperature.can_dlc = 8;
+    ASSERT_TRUE(sender->write(temperature).has_value());
+    ASSERT_TRUE(sender->write(heave_frame(0x21, 9)).has_value());
+
+    nmea::Executor executor;
+    auto heave = executor.block_on(listener.next<nmea::message::Heave>());
+    ASSERT_TRUE(heave.has_value()) << heave.error();
+    EXPECT_EQ(heave->sid, 9);
+}
+
+TEST(AsyncTest, ManyDevicesClaimOnOneThread) {
+    constexpr int DEVICES = 50;
+    nmea::VirtualBus bus;
+    nmea::Listener listener(bus.attach());
+    std::vector<std::unique_ptr<nmea::Device>> devices;
+    nmea::Executor executor;
+    int claimed = 0;
+    for (int i = 0; i < DEVICES; i++) {
+        devices.push_back(std::make_unique<nmea::Device>(bus.attach()));
+        executor.spawn([](nmea::Device &device, uint32_t number, int &count) -> nmea::Task<> {
+            auto result = co_await device.claim_async(device_name(number));
+            if (result) {
+                auto sent = co_await device.send_async(nmea::message::Heave{.sid = 1});
+                count += sent.has_value();
+            }
+        }(*devices.back(), static_cast<uint32_t>(i), claimed));
+    }
+    executor.run();
+
+    EXPECT_EQ(claimed, DEVICES);
+    std::set<uint8_t> addresses;
+    for (const auto &device : devices) {
+        ASSERT_TRUE(device->address().has_value());
+        addresses.insert(*device->address());
+    }
+    EXPECT_EQ(addresses.size(), DEVICES);
+
+    // Every device sent its message once claimed
+    int heaves = 0;
+    auto count = [&]() -> nmea::Task<> {
+        for (int i = 0; i < DEVICES; i++) {
+            auto heave = co_await listener.next<nmea::message::Heave>();
+            heaves += heave.has_value();
+        }
+    };
+    executor.block_on(count());
+    EXPECT_EQ(heaves, DEVICES);
+}
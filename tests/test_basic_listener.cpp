@@ -0,0 +1,107 @@
+#include "frames.hpp"
+#include "nmea/basic_listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/parse.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <memory>
+#include <variant>
+#include <vector>
+
+using HeadingListener = nmea::BasicListener<nmea::message::VesselHeading, nmea::message::Position,
+                                            nmea::message::VesselSpeedComponents>;
+
+static void send(nmea::Transport &sender, const nmea::NmeaMessage &msg, uint8_t source) {
+    for (const auto &frame : message_frames(msg, source)) {
+        ASSERT_TRUE(sender.write(frame).has_value());
+    }
+}
+
+TEST(BasicListenerTest, SkipsOtherMessages) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    HeadingListener listener(bus.attach());
+
+    send(*sender, nmea::message::Temperature{.sid = 1}, 0x10);
+    send(*sender, nmea::message::Heave{.sid = 2, .heave = 0.25}, 0x10);
+    send(*sender, nmea::message::VesselHeading{.sid = 3, .heading = 1.5}, 0x11);
+    send(*sender, nmea::message::Position{.latitude = 42.5, .longitude = -8.25}, 0x12);
+
+    auto heading = listener.read();
+    ASSERT_TRUE(heading.has_value());
+    ASSERT_TRUE(std::holds_alternative<nmea::message::VesselHeading>(*heading));
+    EXPECT_EQ(std::get<nmea::message::VesselHeading>(*heading).sid, 3);
+    EXPECT_EQ(listener.last_source(), 0x11);
+
+    auto position = listener.read();
+    ASSERT_TRUE(position.has_value());
+    EXPECT_NEAR(std::get<nmea::message::Position>(*position).latitude, 42.5, 1e-7);
+    EXPECT_EQ(listener.last_source(), 0x12);
+}
+
+TEST(BasicListenerTest, ReassemblesTransportProtocol) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    HeadingListener listener(bus.attach());
+
+    // A transfer of a message that was not chosen is reassembled and then dropped
+    send(*sender, nmea::message::Temperature{}, 0x20);
+    nmea::message::VesselSpeedComponents speed{};
+    speed.longitudinal.water = 1.5;
+    speed.stern.ground = -0.25;
+    send(*sender, speed, 0x20);
+
+    auto result = listener.read();
+    ASSERT_TRUE(result.has_value());
+    const auto &components = std::get<nmea::message::VesselSpeedComponents>(*result);
+    EXPECT_DOUBLE_EQ(components.longitudinal.water, 1.5);
+    EXPECT_DOUBLE_EQ(components.stern.ground, -0.25);
+}
+
+TEST(BasicListenerTest, ReturnsErrorsOfChosenMessages) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::BasicListener<nmea::message::BasicHeave<nmea::policy::Raw>> listener(bus.attach());
+    EXPECT_EQ(listener.pgns.size(), 1);
+    EXPECT_EQ(listener.pgns[0], nmea::pgn::HEAVE);
+
+    auto frame = message_frames(nmea::message::Heave{.sid = 4, .heave = 0.5}, 0x30)[0];
+    frame.can_dlc = 2;
+    ASSERT_TRUE(sender->write(frame).has_value());
+    frame.can_dlc = 8;
+    ASSERT_TRUE(sender->write(frame).has_value());
+
+    auto truncated = listener.read();
+    ASSERT_FALSE(truncated.has_value());
+    EXPECT_EQ(truncated.error(), "PGN 127252 payload too short: got 2 bytes, expected 3");
+
+    auto heave = listener.read();
+    ASSERT_TRUE(heave.has_value());
+    EXPECT_EQ(std::get<0>(*heave).heave, 50);
+}
+
+TEST(BasicListenerTest, VirtualTransportCannotBeFiltered) {
+    nmea::VirtualBus bus;
+    HeadingListener listener(bus.attach());
+    auto filtered = listener.filter();
+    ASSERT_FALSE(filtered.has_value());
+    EXPECT_EQ(filtered.error(), "Transport has no socket to filter");
+}
+
+TEST(BasicListenerTest, ParseAsChecksLength) {
+    const std::vector<uint8_t> data{7, 0xE8, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    auto heave = nmea::parse_as<nmea::message::Heave>(data);
+    ASSERT_TRUE(heave.has_value());
+    EXPECT_EQ(heave->sid, 7);
+    EXPECT_DOUBLE_EQ(heave->heave, 10.0);
+
+    auto position = nmea::parse_as<nmea::message::Position>(data);
+    EXPECT_TRUE(position.has_value());
+    auto attitude = nmea::parse_as<nmea::message::BasicAttitude<nmea::policy::Float>>(
+        std::span<const uint8_t>(data).first(4));
+    ASSERT_FALSE(attitude.has_value());
+    EXPECT_EQ(attitude.error(), "PGN 127257 payload too short: got 4 bytes, expected 7");
+}
@@ -0,0 +1,128 @@
+#include "nmea/batch.hpp"
+#include "nmea/message.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <random>
+#include <span>
+#include <vector>
+
+static std::vector<can_frame> random_frames(uint32_t pgn, size_t count) {
+    std::mt19937 rng(pgn);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<can_frame> frames(count);
+    for (auto &frame : frames) {
+        frame.can_id = CAN_EFF_FLAG | (2u << 26) | (pgn << 8) | 0x23;
+        frame.can_dlc = 8;
+        for (auto &data : frame.data) {
+            data = static_cast<uint8_t>(byte(rng));
+        }
+    }
+    return frames;
+}
+
+static std::vector<nmea::batch::Simd> kernels() {
+    std::vector<nmea::batch::Simd> result{nmea::batch::Simd::SCALAR};
+    if (nmea::batch::detect_simd() >= nmea::batch::Simd::SSE2) {
+        result.push_back(nmea::batch::Simd::SSE2);
+    }
+    if (nmea::batch::detect_simd() >= nmea::batch::Simd::AVX2) {
+        result.push_back(nmea::batch::Simd::AVX2);
+    }
+    return result;
+}
+
+template <typename T> static T parse_frame(const can_frame &frame) {
+    auto msg = nmea::parse(frame.can_id, std::span<const uint8_t>(frame.data, frame.can_dlc));
+    return std::get<T>(msg.value());
+}
+
+// Sizes that are not a multiple of the SIMD width and span several chunks
+constexpr size_t FRAMES = 1031;
+
+TEST(BatchTest, AttitudeMatchesParse) {
+    auto frames = random_frames(nmea::pgn::ATTITUDE, FRAMES);
+    for (auto simd : kernels()) {
+        nmea::batch::Attitude out;
+        ASSERT_TRUE(nmea::batch::decode(frames, out, simd).has_value());
+        ASSERT_EQ(out.size(), frames.size());
+        for (size_t i = 0; i < frames.size(); i++) {
+            auto expected = parse_frame<nmea::message::Attitude>(frames[i]);
+            EXPECT_EQ(out.sid[i], expected.sid);
+            EXPECT_EQ(out.yaw[i], expected.yaw);
+            EXPECT_EQ(out.pitch[i], expected.pitch);
+            EXPECT_EQ(out.roll[i], expected.roll);
+        }
+    }
+}
+
+TEST(BatchTest, PositionMatchesParse) {
+    auto frames = random_frames(nmea::pgn::POSITION, FRAMES);
+    for (auto simd : kernels()) {
+        nmea::batch::Position out;
+        ASSERT_TRUE(nmea::batch::decode(frames, out, simd).has_value());
+        ASSERT_EQ(out.size(), frames.size());
+        for (size_t i = 0; i < frames.size(); i++) {
+            auto expected = parse_frame<nmea::message::Position>(frames[i]);
+            EXPECT_EQ(out.latitude[i], expected.latitude);
+            EXPECT_EQ(out.longitude[i], expected.longitude);
+        }
+    }
+}
+
+TEST(BatchTest, CogSogMatchesParse) {
+    auto frames = random_frames(nmea::pgn::COG_SOG, FRAMES);
+    for (auto simd : kernels()) {
+        nmea::batch::CogSog out;
+        ASSERT_TRUE(nmea::batch::decode(frames, out, simd).has_value());
+        ASSERT_EQ(out.size(), frames.size());
+        for (size_t i = 0; i < frames.size(); i++) {
+            auto expected = parse_frame<nmea::message::CogSog>(frames[i]);
+            EXPECT_EQ(out.sid[i], expected.sid);
+            EXPECT_EQ(out.cog_reference[i], expected.cog_reference);
+            EXPECT_EQ(out.cog[i], expected.cog);
+            EXPECT_EQ(out.sog[i], expected.sog);
+        }
+    }
+}
+
+TEST(BatchTest, DecodeAppends) {
+    auto frames = random_frames(nmea::pgn::POSITION, 10);
+    nmea::batch::Position out;
+    ASSERT_TRUE(nmea::batch::decode(std::span(frames).first(3), out).has_value());
+    ASSERT_TRUE(nmea::batch::decode(std::span(frames).subspan(3), out).has_value());
+    ASSERT_EQ(out.size(), 10);
+    EXPECT_EQ(out.longitude[9], parse_frame<nmea::message::Position>(frames[9]).longitude);
+}
+
+TEST(BatchTest, OtherPgnIsRejected) {
+    auto frames = random_frames(nmea::pgn::ATTITUDE, 5);
+    frames[3].can_id = CAN_EFF_FLAG | (2u << 26) | (nmea::pgn::HEAVE << 8) | 0x23;
+    nmea::batch::Attitude out;
+    auto result = nmea::batch::decode(frames, out);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Frame 3 is PGN 127252, expected 127257");
+    EXPECT_EQ(out.size(), 0);
+}
+
+TEST(BatchTest, ShortFrameIsRejected) {
+    auto frames = random_frames(nmea::pgn::COG_SOG, 5);
+    frames[1].can_dlc = 4;
+    nmea::batch::CogSog out;
+    auto result = nmea::batch::decode(frames, out);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Frame 1: PGN 129026 payload too short: got 4 bytes, expected 6");
+    EXPECT_EQ(out.size(), 0);
+}
+
+TEST(BatchTest, FailedDecodeLeavesOutputUnchanged) {
+    auto frames = random_frames(nmea::pgn::POSITION, 600);
+    nmea::batch::Position out;
+    ASSERT_TRUE(nmea::batch::decode(std::span(frames).first(2), out).has_value());
+
+    frames[500].can_dlc = 7;
+    auto result = nmea::batch::decode(frames, out);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Frame 500: PGN 129025 payload too short: got 7 bytes, expected 8");
+    EXPECT_EQ(out.size(), 2);
+}
@@ -0,0 +1,157 @@
+#include "frames.hpp"
+#include "nmea/broadcast.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+static can_frame temperature_frame(uint8_t source) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (5u << 26) | (nmea::pgn::TEMPERATURE << 8) | source;
+    frame.can_dlc = 8;
+    return frame;
+}
+
+TEST(BroadcastTest, ReadersHaveTheirOwnPosition) {
+    nmea::BroadcastRing ring({.capacity = 16});
+    ring.write(heave_frame(1, 0));
+    auto a = ring.subscribe();
+    EXPECT_FALSE(a.next()->has_value());
+
+    const auto timestamp = std::chrono::system_clock::time_point(1714566600123456789ns);
+    ring.write(heave_frame(2, 7), nmea::message::Heave{.sid = 7, .heave = 0.5}, timestamp);
+    auto b = ring.subscribe();
+    ring.write(heave_frame(3, 8));
+
+    auto first = a.next();
+    ASSERT_TRUE(first.has_value() && first->has_value());
+    EXPECT_EQ((*first)->sequence, 1);
+    EXPECT_EQ((*first)->timestamp, timestamp);
+    ASSERT_TRUE((*first)->message.has_value());
+    EXPECT_DOUBLE_EQ(std::get<nmea::message::Heave>(*(*first)->message).heave, 0.5);
+    EXPECT_EQ((*a.next())->frame.data[0], 8);
+    EXPECT_FALSE(a.next()->has_value());
+
+    // Subscribed after the message
+    auto second = b.next();
+    ASSERT_TRUE(second.has_value() && second->has_value());
+    EXPECT_EQ((*second)->sequence, 2);
+    EXPECT_FALSE((*second)->message.has_value());
+}
+
+TEST(BroadcastTest, FiltersByPgn) {
+    nmea::BroadcastRing ring;
+    auto heave = ring.subscribe({nmea::pgn::HEAVE});
+    auto speed = ring.subscribe({nmea::pgn::VESSEL_SPEED});
+
+    ring.write(temperature_frame(1));
+    ring.write(heave_frame(1, 1));
+    // The last frame of a TP transfer is matched on the PGN of the message it completed
+    can_frame dt{};
+    dt.can_id = CAN_EFF_FLAG | (6u << 26) | (0xEBu << 16) | (0xFFu << 8) | 1;
+    ring.write(dt);
+    ring.write(dt, nmea::message::VesselSpeedComponents{});
+
+    auto entry = heave.next();
+    ASSERT_TRUE(entry.has_value() && entry->has_value());
+    EXPECT_EQ((*entry)->sequence, 1);
+    EXPECT_FALSE(heave.next()->has_value());
+
+    entry = speed.next();
+    ASSERT_TRUE(entry.has_value() && entry->has_value());
+    EXPECT_EQ((*entry)->sequence, 3);
+    EXPECT_TRUE((*entry)->message.has_value());
+}
+
+TEST(BroadcastTest, DetectsOverrun) {
+    nmea::BroadcastRing ring({.capacity = 10});
+    EXPECT_EQ(ring.capacity(), 16);
+    auto reader = ring.subscribe();
+    for (uint8_t i = 0; i < 20; i++) {
+        ring.write(heave_frame(1, i));
+    }
+    auto overrun = reader.next();
+    ASSERT_FALSE(overrun.has_value());
+    EXPECT_EQ(overrun.error(), "Reader overrun, 4 entries lost");
+    EXPECT_EQ(reader.lost(), 4);
+    EXPECT_EQ((*reader.next())->frame.data[0], 4);
+}
+
+TEST(BroadcastTest, ConsumersOnOtherThreads) {
+    constexpr int FRAMES = 20000;
+    nmea::BroadcastRing ring({.capacity = 1024});
+    std::vector<std::thread> consumers;
+    std::vector<int> received(3, 0);
+    std::vector<nmea::BroadcastReader> readers;
+    for (size_t i = 0; i < received.size(); i++) {
+        readers.push_back(ring.subscribe());
+    }
+    for (size_t i = 0; i < received.size(); i++) {
+        consumers.emplace_back([&, i] {
+            auto &reader = readers[i];
+            uint8_t expected = 0;
+            while (received[i] + reader.lost() < FRAMES) {
+                if (!reader.wait(1000ms)) {
+                    break;
+                }
+                while (true) {
+                    auto entry = reader.next();
+                    if (!entry) {
+                        // Lapped: the next entry is not the expected one any more
+                        expected = 0;
+                        continue;
+                    }
+                    if (!*entry) {
+                        break;
+                    }
+                    // Entries are never torn
+                    const uint8_t sid = (*entry)->frame.data[0];
+                    EXPECT_EQ((*entry)->frame.data[1], sid);
+                    EXPECT_TRUE(expected == 0 || sid == expected);
+                    expected = static_cast<uint8_t>(sid + 1);
+                    received[i]++;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < FRAMES; i++) {
+        auto frame = heave_frame(1, static_cast<uint8_t>(i));
+        frame.data[1] = frame.data[0];
+        ring.write(frame);
+        if (i % 100 == 0) {
+            std::this_thread::sleep_for(100us);
+        }
+    }
+    for (auto &consumer : consumers) {
+        consumer.join();
+    }
+    for (size_t i = 0; i < received.size(); i++) {
+        EXPECT_EQ(received[i] + readers[i].lost(), FRAMES);
+    }
+}
+
+TEST(BroadcastTest, ListenerDecodesOnceForEveryReader) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach());
+    nmea::BroadcastRing ring;
+    listener.set_broadcast(&ring);
+    auto a = ring.subscribe({nmea::pgn::HEAVE});
+    auto b = ring.subscribe({nmea::pgn::HEAVE});
+
+    ASSERT_TRUE(sender->write(heave_frame(0x10, 3)).has_value());
+    ASSERT_TRUE(listener.read().has_value());
+
+    for (auto *reader : {&a, &b}) {
+        auto entry = reader->next();
+        ASSERT_TRUE(entry.has_value() && entry->has_value());
+        ASSERT_TRUE((*entry)->message.has_value());
+        EXPECT_EQ(std::get<nmea::message::Heave>(*(*entry)->message).sid, 3);
+    }
+}
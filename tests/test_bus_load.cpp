@@ -0,0 +1,99 @@
+#include "nmea/bus_load.hpp"
+#include "nmea/message.hpp"
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+
+using namespace std::chrono_literals;
+
+static can_frame make_frame(uint32_t priority, uint32_t pgn, uint8_t source) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (priority << 26) | (pgn << 8) | source;
+    frame.can_dlc = 8;
+    return frame;
+}
+
+TEST(BusLoadTest, FrameBitsIncludesStuffing) {
+    // 131 bits before stuffing. Long runs of zeros need 19 stuff bits
+    can_frame frame = make_frame(0, 0, 0);
+    EXPECT_EQ(nmea::BusLoad::frame_bits(frame), 150);
+
+    frame = make_frame(6, 0xEEFF, 42);
+    EXPECT_EQ(nmea::BusLoad::frame_bits(frame), 146);
+}
+
+TEST(BusLoadTest, FrameBitsStandardFrame) {
+    can_frame frame{};
+    frame.can_id = 0x7FF;
+    frame.can_dlc = 0;
+    EXPECT_EQ(nmea::BusLoad::frame_bits(frame), 50);
+}
+
+TEST(BusLoadTest, FrameBitsWithinCanBounds) {
+    for (uint32_t pgn : {nmea::pgn::COG_SOG, nmea::pgn::ATTITUDE, nmea::pgn::TEMPERATURE}) {
+        can_frame frame = make_frame(2, pgn, 0x23);
+        for (int i = 0; i < 8; i++) {
+            frame.data[i] = static_cast<uint8_t>(pgn >> i);
+        }
+        auto bits = nmea::BusLoad::frame_bits(frame);
+        EXPECT_GE(bits, 131);
+        // At most one stuff bit per 4 bits after the first 5
+        EXPECT_LE(bits, 131 + (54 + 64 - 1) / 4);
+    }
+}
+
+TEST(BusLoadTest, AccountsPerPgnAndSource) {
+    nmea::BusLoad load;
+    const auto now = std::chrono::steady_clock::time_point(10s);
+
+    load.record(make_frame(2, nmea::pgn::COG_SOG, 0x10), now);
+    load.record(make_frame(2, nmea::pgn::COG_SOG, 0x10), now);
+    load.record(make_frame(3, nmea::pgn::ATTITUDE, 0x20), now);
+
+    EXPECT_EQ(load.total(now).frames, 3);
+    EXPECT_EQ(load.pgn(nmea::pgn::COG_SOG, now).frames, 2);
+    EXPECT_EQ(load.pgn(nmea::pgn::ATTITUDE, now).frames, 1);
+    EXPECT_EQ(load.pgn(nmea::pgn::TEMPERATURE, now).frames, 0);
+    EXPECT_EQ(load.source(0x10, now).frames, 2);
+    EXPECT_EQ(load.source(0x20, now).frames, 1);
+    EXPECT_EQ(load.pgns(now).size(), 2);
+}
+
+TEST(BusLoadTest, PduOnePgnExcludesDestination) {
+    nmea::BusLoad load;
+    const auto now = std::chrono::steady_clock::time_point(10s);
+
+    // TP connection management sent to two different destinations
+    load.record(make_frame(7, nmea::pgn::TP_CM | 0x05, 0x10), now);
+    load.record(make_frame(7, nmea::pgn::TP_CM | 0xFF, 0x10), now);
+
+    EXPECT_EQ(load.pgn(nmea::pgn::TP_CM, now).frames, 2);
+}
+
+TEST(BusLoadTest, LoadIsFractionOfCapacity) {
+    nmea::BusLoad load({.bitrate = 250000, .window = 1000ms});
+    const auto now = std::chrono::steady_clock::time_point(10s);
+    const can_frame frame = make_frame(0, 0, 0);
+
+    for (int i = 0; i < 1000; i++) {
+        load.record(frame, now);
+    }
+
+    auto usage = load.total(now);
+    EXPECT_EQ(usage.bits, 150000);
+    EXPECT_DOUBLE_EQ(usage.load, 0.6);
+}
+
+TEST(BusLoadTest, OldTrafficLeavesWindow) {
+    nmea::BusLoad load({.bitrate = 250000, .window = 1000ms});
+    const auto start = std::chrono::steady_clock::time_point(10s);
+
+    load.record(make_frame(2, nmea::pgn::COG_SOG, 0x10), start);
+    load.record(make_frame(2, nmea::pgn::COG_SOG, 0x10), start + 500ms);
+
+    EXPECT_EQ(load.total(start + 900ms).frames, 2);
+    EXPECT_EQ(load.total(start + 1200ms).frames, 1);
+    EXPECT_EQ(load.pgn(nmea::pgn::COG_SOG, start + 2s).frames, 0);
+    EXPECT_TRUE(load.pgns(start + 2s).empty());
+}
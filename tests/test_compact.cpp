@@ -0,0 +1,82 @@
+#include "nmea/message.hpp"
+#include <cstdint>
+#include <format>
+#include <gtest/gtest.h>
+#include <vector>
+
+using nmea::policy::Double;
+using nmea::policy::Float;
+using nmea::policy::Raw;
+
+static constexpr uint32_t id(uint32_t pgn) { return pgn << 8; }
+
+TEST(CompactTest, IsSmallerThanNmeaMessage) {
+    EXPECT_LT(sizeof(nmea::CompactNmeaMessage), sizeof(nmea::NmeaMessage));
+    EXPECT_LE(sizeof(nmea::message::BasicAttitude<Raw>), 8);
+    EXPECT_LE(sizeof(nmea::message::BasicPosition<Raw>), 8);
+}
+
+TEST(CompactTest, RawKeepsWireIntegers) {
+    const std::vector<uint8_t> data{0x07, 0x34, 0x12, 0xCC, 0xED, 0x10, 0x27, 0xFF};
+    auto result = nmea::parse<Raw>(id(nmea::pgn::ATTITUDE), data);
+    ASSERT_TRUE(result.has_value()) << result.error();
+
+    const auto &attitude = std::get<nmea::message::BasicAttitude<Raw>>(*result);
+    EXPECT_EQ(attitude.sid, 7);
+    EXPECT_EQ(attitude.yaw, 0x1234);
+    EXPECT_EQ(attitude.pitch, -0x1234);
+    EXPECT_EQ(attitude.roll, 10000);
+}
+
+TEST(CompactTest, RawSerializesToTheSameBytes) {
+    const std::vector<uint8_t> data{0x80, 0x96, 0x98, 0x00, 0x00, 0x00, 0x6A, 0x67};
+    auto compact = nmea::parse<Raw>(id(nmea::pgn::POSITION), data);
+    ASSERT_TRUE(compact.has_value()) << compact.error();
+
+    const auto serialized = nmea::serialize(*compact);
+    EXPECT_EQ(serialized.pgn, nmea::pgn::POSITION);
+    EXPECT_EQ(serialized.data, data);
+}
+
+TEST(CompactTest, ConvertMatchesParse) {
+    const std::vector<uint8_t> data{0x01, 0xFC, 0x34, 0x12, 0x78, 0x56, 0xFF, 0xFF};
+    auto compact = nmea::parse<Raw>(id(nmea::pgn::COG_SOG), data);
+    auto full = nmea::parse(id(nmea::pgn::COG_SOG), data);
+    ASSERT_TRUE(compact.has_value()) << compact.error();
+    ASSERT_TRUE(full.has_value()) << full.error();
+
+    const auto converted = nmea::convert<Double>(*compact);
+    const auto &expected = std::get<nmea::message::CogSog>(*full);
+    const auto &actual = std::get<nmea::message::CogSog>(converted);
+    EXPECT_EQ(actual.sid, expected.sid);
+    EXPECT_EQ(actual.cog_reference, expected.cog_reference);
+    EXPECT_EQ(actual.cog, expected.cog);
+    EXPECT_EQ(actual.sog, expected.sog);
+}
+
+TEST(CompactTest, ConvertSingleMessage) {
+    const nmea::message::Heave heave{.sid = 3, .heave = 1.23};
+    const auto compact = nmea::convert<Raw>(heave);
+    EXPECT_EQ(compact.sid, 3);
+    EXPECT_EQ(compact.heave, 123);
+
+    const auto back = nmea::convert<Double>(compact);
+    EXPECT_DOUBLE_EQ(back.heave, 1.23);
+}
+
+TEST(CompactTest, FloatRoundTrip) {
+    const std::vector<uint8_t> data{0x02, 0x00, 0x01, 0x9C, 0x72, 0x9C, 0x72, 0x00};
+    auto result = nmea::parse<Float>(id(nmea::pgn::TEMPERATURE), data);
+    ASSERT_TRUE(result.has_value()) << result.error();
+
+    const auto &temperature = std::get<nmea::message::BasicTemperature<Float>>(*result);
+    EXPECT_FLOAT_EQ(temperature.actual_temperature, 293.4f);
+
+    const auto serialized = nmea::serialize<Float>(*result);
+    EXPECT_EQ(serialized.data, data);
+}
+
+TEST(CompactTest, Formats) {
+    const nmea::CompactNmeaMessage msg = nmea::message::BasicHeave<Raw>{.sid = 1, .heave = 250};
+    EXPECT_EQ(std::format("{}", msg), "Heave(SID=1, Heave=250)");
+}
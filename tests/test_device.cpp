@@ -1,8 +1,17 @@
 #include "nmea/device.hpp"
 #include "nmea/message.hpp"
+#include "nmea/transport.hpp"
+#include <atomic>
+#include <chrono>
 #include <gtest/gtest.h>
+#include <linux/can.h>
+#include <memory>
+#include <optional>
+#include <span>
 #include <sys/socket.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 TEST(DeviceTest, SendWithoutClaimReturnsError) {
     int fds[2];
@@ -14,3 +23,220 @@ TEST(DeviceTest, SendWithoutClaimReturnsError) {
     ASSERT_FALSE(result.has_value());
     EXPECT_EQ(result.error(), "Device has not claimed an address");
 }
+
+// Records the frames written and checks that only one thread writes at a time
+class RecordingTransport : public nmea::Transport {
+public:
+    std::vector<can_frame> frames;
+    std::atomic<int> writers = 0;
+    bool overlapped = false;
+
+    std::expected<void, std::string> read(can_frame & /* frame */) override {
+        return std::unexpected("Nothing to read");
+    }
+    std::expected<void, std::string> write(const can_frame &frame) override {
+        if (writers.fetch_add(1) != 0) {
+            overlapped = true;
+        }
+        frames.push_back(frame);
+        writers.fetch_sub(1);
+        return {};
+    }
+    bool wait(std::chrono::milliseconds timeout) override {
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+    int fd() const override { return -1; }
+};
+
+TEST(DeviceTest, ConcurrentSendsDoNotInterleaveTransfers) {
+    auto transport = std::make_unique<RecordingTransport>();
+    auto *recorder = transport.get();
+    nmea::Device device(std::move(transport));
+    ASSERT_TRUE(device
+                    .claim({
+                        .unique_number = 7,
+                        .manufacturer_code = ManufacturerCode::ACTISENSE,
+                        .device_instance_lower = 0,
+                        .device_instance_upper = 0,
+                        .device_function = device_function::RADAR,
+                        .system_instance = 0,
+                        .industry_group = IndustryCode::MARINE,
+                        .arbitrary_address_capable = true,
+                    })
+                    .get()
+                    .has_value());
+    recorder->frames.clear();
+
+    constexpr int THREADS = 8;
+    constexpr int MESSAGES = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&device, t] {
+            for (int i = 0; i < MESSAGES; i++) {
+                // Alternate between transport protocol transfers and single frames
+                auto result = i % 2 ? device.send(nmea::message::Heave{.sid = uint8_t(t)})
+                                    : device.send(nmea::message::VesselSpeedComponents{
+                                          .longitudinal = {.water = 1.0, .ground = 2.0},
+                                          .transverse = {},
+                                          .stern = {},
+                                      });
+                ASSERT_TRUE(result.has_value());
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_FALSE(recorder->overlapped);
+    int transfers = 0;
+    const auto &frames = recorder->frames;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const uint32_t pf = (frames[i].can_id >> 16) & 0xFF;
+        if (pf == 0xEC) {
+            // Every BAM is directly followed by all of its data packets
+            const uint8_t packets = frames[i].data[3];
+            for (uint8_t seq = 1; seq <= packets; seq++) {
+                ASSERT_LT(i + seq, frames.size());
+                EXPECT_EQ((frames[i + seq].can_id >> 16) & 0xFF, 0xEB);
+                EXPECT_EQ(frames[i + seq].data[0], seq);
+            }
+            i += packets;
+            transfers++;
+        } else {
+            EXPECT_NE(pf, 0xEB);
+        }
+    }
+    EXPECT_EQ(transfers, THREADS * MESSAGES / 2);
+}
+
+static nmea::DeviceName test_name() {
+    return {
+        .unique_number = 7,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    };
+}
+
+TEST(DeviceTest, SendBatchWritesEveryFrameInOrder) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    nmea::Device device(fds[0]);
+    auto claimed = device.claim(test_name());
+    ASSERT_TRUE(claimed.get().has_value());
+    can_frame frame{};
+    while (recv(fds[1], &frame, sizeof(frame), MSG_DONTWAIT) > 0) {
+        // Address claim
+    }
+
+    const std::vector<nmea::NmeaMessage> messages{
+        nmea::message::Heave{.sid = 1},
+        nmea::message::VesselSpeedComponents{},
+        nmea::message::Position{.latitude = 1.0},
+    };
+    auto sent = device.send_batch(messages);
+    ASSERT_TRUE(sent.has_value());
+    EXPECT_EQ(*sent, 3);
+
+    // A single frame, a BAM with two data packets and a single frame
+    const std::vector<uint32_t> pfs{0xF1, 0xEC, 0xEB, 0xEB, 0xF8};
+    for (uint32_t pf : pfs) {
+        ASSERT_EQ(recv(fds[1], &frame, sizeof(frame), MSG_DONTWAIT), sizeof(frame));
+        EXPECT_EQ((frame.can_id >> 16) & 0xFF, pf);
+        EXPECT_EQ(frame.can_id & 0xFF, *device.address());
+    }
+    EXPECT_EQ(recv(fds[1], &frame, sizeof(frame), MSG_DONTWAIT), -1);
+    close(fds[1]);
+}
+
+TEST(DeviceTest, SocketWritesLargeBatches) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    nmea::SocketTransport transport(fds[0]);
+    std::vector<can_frame> frames(nmea::SocketTransport::MAX_BATCH * 2 + 3);
+    for (size_t i = 0; i < frames.size(); i++) {
+        frames[i].can_id = CAN_EFF_FLAG | static_cast<uint32_t>(i);
+    }
+    auto written = transport.write_batch(frames);
+    ASSERT_TRUE(written.has_value());
+    EXPECT_EQ(*written, frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        can_frame frame{};
+        ASSERT_EQ(recv(fds[1], &frame, sizeof(frame), MSG_DONTWAIT), sizeof(frame));
+        EXPECT_EQ(frame.can_id & CAN_EFF_MASK, i);
+    }
+    close(fds[1]);
+}
+
+// Fails every write once `limit` frames were written
+class LimitedTransport : public RecordingTransport {
+public:
+    std::optional<size_t> limit;
+
+    std::expected<void, std::string> write(const can_frame &frame) override {
+        if (limit && frames.size() >= *limit) {
+            return std::unexpected("Bus off");
+        }
+        return RecordingTransport::write(frame);
+    }
+};
+
+TEST(DeviceTest, SendBatchReportsMessagesSentInFull) {
+    auto transport = std::make_unique<LimitedTransport>();
+    auto *limited = transport.get();
+    nmea::Device device(std::move(transport));
+    auto claimed = device.claim(test_name());
+    ASSERT_TRUE(claimed.get().has_value());
+    limited->frames.clear();
+
+    const std::vector<nmea::NmeaMessage> messages{
+        nmea::message::Heave{},
+        nmea::message::VesselSpeedComponents{},
+        nmea::message::Heave{},
+    };
+    // Stops in the middle of the transfer
+    limited->limit = 3;
+    auto sent = device.send_batch(messages);
+    ASSERT_TRUE(sent.has_value());
+    EXPECT_EQ(*sent, 1);
+
+    // The rest can be retried
+    limited->frames.clear();
+    limited->limit = 0;
+    sent = device.send_batch(std::span(messages).subspan(1));
+    ASSERT_FALSE(sent.has_value());
+    EXPECT_EQ(sent.error(), "Bus off");
+
+    limited->limit.reset();
+    sent = device.send_batch(std::span(messages).subspan(1));
+    ASSERT_TRUE(sent.has_value());
+    EXPECT_EQ(*sent, 2);
+    EXPECT_EQ(limited->frames.size(), 4);
+}
+
+TEST(DeviceTest, FailedHeartbeatStaysDue) {
+    auto transport = std::make_unique<LimitedTransport>();
+    auto *limited = transport.get();
+    nmea::Device device(std::move(transport));
+    auto claimed = device.claim(test_name());
+    ASSERT_TRUE(claimed.get().has_value());
+    limited->frames.clear();
+
+    const auto now = nmea::Device::Clock::now();
+    limited->limit = 0;
+    ASSERT_FALSE(device.heartbeat(now).has_value());
+
+    limited->limit.reset();
+    auto next = device.heartbeat(now);
+    ASSERT_TRUE(next.has_value());
+    EXPECT_EQ(*next, now + std::chrono::seconds(60));
+    ASSERT_EQ(limited->frames.size(), 1);
+    // The sequence counter did not advance for the heartbeat that was not sent
+    EXPECT_EQ(limited->frames[0].data[2], 0);
+}
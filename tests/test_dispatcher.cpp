@@ -0,0 +1,128 @@
+#include "nmea/dispatcher.hpp"
+#include "nmea/message.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+
+TEST(DispatcherTest, HandlerReceivesSubscribedType) {
+    nmea::Dispatcher dispatcher;
+    double yaw = 0;
+    dispatcher.on<nmea::message::Attitude>([&](const nmea::message::Attitude &m) { yaw = m.yaw; });
+
+    dispatcher.dispatch(nmea::message::Attitude{.sid = 1, .yaw = 0.5, .pitch = 0, .roll = 0}, 10);
+
+    EXPECT_DOUBLE_EQ(yaw, 0.5);
+}
+
+TEST(DispatcherTest, OtherTypesAreNotDelivered) {
+    nmea::Dispatcher dispatcher;
+    int calls = 0;
+    dispatcher.on<nmea::message::Attitude>([&](const nmea::message::Attitude &) { calls++; });
+
+    dispatcher.dispatch(nmea::message::CogSog{}, 10);
+    dispatcher.dispatch(nmea::message::Temperature{}, 10);
+
+    EXPECT_EQ(calls, 0);
+}
+
+TEST(DispatcherTest, SourceFilter) {
+    nmea::Dispatcher dispatcher;
+    int filtered = 0;
+    int any = 0;
+    dispatcher.on<nmea::message::CogSog>(uint8_t{20},
+                                         [&](const nmea::message::CogSog &) { filtered++; });
+    dispatcher.on<nmea::message::CogSog>([&](const nmea::message::CogSog &) { any++; });
+
+    dispatcher.dispatch(nmea::message::CogSog{}, 10);
+    dispatcher.dispatch(nmea::message::CogSog{}, 20);
+
+    EXPECT_EQ(filtered, 1);
+    EXPECT_EQ(any, 2);
+}
+
+TEST(DispatcherTest, HandlerCanReceiveSource) {
+    nmea::Dispatcher dispatcher;
+    uint8_t seen = 0;
+    dispatcher.on<nmea::message::Heave>(
+        [&](const nmea::message::Heave &, uint8_t source) { seen = source; });
+
+    dispatcher.dispatch(nmea::message::Heave{}, 42);
+
+    EXPECT_EQ(seen, 42);
+}
+
+TEST(DispatcherTest, OffRemovesHandler) {
+    nmea::Dispatcher dispatcher;
+    int calls = 0;
+    auto id = dispatcher.on<nmea::message::Heave>([&](const nmea::message::Heave &) { calls++; });
+    dispatcher.on<nmea::message::Heave>([&](const nmea::message::Heave &) { calls += 10; });
+
+    dispatcher.off(id);
+    dispatcher.dispatch(nmea::message::Heave{}, 1);
+
+    EXPECT_EQ(calls, 10);
+    EXPECT_EQ(dispatcher.subscribers<nmea::message::Heave>(), 1);
+}
+
+TEST(DispatcherTest, NonTrivialHandlersSurviveTableGrowth) {
+    nmea::Dispatcher dispatcher;
+    auto counter = std::make_shared<int>(0);
+    for (int i = 0; i < 50; i++) {
+        dispatcher.on<nmea::message::Position>(
+            [counter](const nmea::message::Position &) { (*counter)++; });
+    }
+
+    dispatcher.dispatch(nmea::message::Position{}, 1);
+
+    EXPECT_EQ(*counter, 50);
+    EXPECT_EQ(counter.use_count(), 51);
+}
+
+TEST(DispatcherTest, HandlerCanRemoveItself) {
+    nmea::Dispatcher dispatcher;
+    int once = 0;
+    int skipped = 0;
+    int always = 0;
+    nmea::Dispatcher::SubscriptionId id = 0;
+    nmea::Dispatcher::SubscriptionId later = 0;
+    id = dispatcher.on<nmea::message::Heave>([&](const nmea::message::Heave &) {
+        once++;
+        dispatcher.off(id);
+        dispatcher.off(later);
+    });
+    // Removed by the first handler before its turn, so it is never called
+    later = dispatcher.on<nmea::message::Heave>([&](const nmea::message::Heave &) { skipped++; });
+    dispatcher.on<nmea::message::Heave>([&](const nmea::message::Heave &) { always++; });
+
+    dispatcher.dispatch(nmea::message::Heave{}, 1);
+    EXPECT_EQ(once, 1);
+    EXPECT_EQ(skipped, 0);
+    EXPECT_EQ(always, 1);
+    EXPECT_EQ(dispatcher.subscribers<nmea::message::Heave>(), 1);
+
+    dispatcher.dispatch(nmea::message::Heave{}, 1);
+    EXPECT_EQ(once, 1);
+    EXPECT_EQ(skipped, 0);
+    EXPECT_EQ(always, 2);
+}
+
+TEST(DispatcherTest, HandlersAddedDuringDispatchRunFromTheNextOne) {
+    nmea::Dispatcher dispatcher;
+    int added = 0;
+    size_t seen = 0;
+    dispatcher.on<nmea::message::Heave>([&](const nmea::message::Heave &) {
+        // Enough to reallocate the table if they were appended right away
+        for (int i = 0; i < 20; i++) {
+            dispatcher.on<nmea::message::Heave>([&](const nmea::message::Heave &) { added++; });
+        }
+        seen = dispatcher.subscribers<nmea::message::Heave>();
+    });
+
+    dispatcher.dispatch(nmea::message::Heave{}, 1);
+    EXPECT_EQ(added, 0);
+    EXPECT_EQ(seen, 21);
+
+    dispatcher.dispatch(nmea::message::Heave{}, 1);
+    EXPECT_EQ(added, 20);
+    EXPECT_EQ(dispatcher.subscribers<nmea::message::Heave>(), 41);
+}
@@ -0,0 +1,252 @@
+#include "frames.hpp"
+#include "nmea/async.hpp"
+#include "nmea/device.hpp"
+#include "nmea/interface_monitor.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/transport.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+// Monitor of an interface that is taken down and up by the test. Every socket opened on it is
+// one end of a socket pair, whose other end the test reads and writes as the bus
+class FakeMonitor : public nmea::InterfaceMonitor {
+public:
+    FakeMonitor() : InterfaceMonitor("fake0", {}) { set_state(true); }
+    ~FakeMonitor() override {
+        for (int fd : m_peers) {
+            close(fd);
+        }
+    }
+
+    void go_down() { set_state(false); }
+    void come_up() { set_state(true); }
+
+    std::expected<nmea::connection_t, std::string> connect() const override {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == -1) {
+            return std::unexpected("socketpair failed");
+        }
+        std::lock_guard lock(m_mutex);
+        m_peers.push_back(fds[1]);
+        m_cv.notify_all();
+        return fds[0];
+    }
+
+    /// Bus end of the socket opened by the `index`th reconnection, or -1 if there is none yet
+    int peer(size_t index) const {
+        std::lock_guard lock(m_mutex);
+        return m_peers.size() > index ? m_peers[index] : -1;
+    }
+    /// Wait up to 2s for the `index`th reconnection
+    int wait_peer(size_t index) const {
+        std::unique_lock lock(m_mutex);
+        m_cv.wait_for(lock, 2s, [&] { return m_peers.size() > index; });
+        return m_peers.size() > index ? m_peers[index] : -1;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    mutable std::vector<int> m_peers;
+};
+
+// Wait for `future`, or unblock a reader stuck on the old socket by closing its bus end
+template <typename T> static bool ready(std::future<T> &future, int old_peer) {
+    if (future.wait_for(2s) == std::future_status::ready) {
+        return true;
+    }
+    shutdown(old_peer, SHUT_RDWR);
+    return false;
+}
+
+TEST(InterfaceMonitorTest, LoopbackIsUp) {
+    auto monitor = nmea::InterfaceMonitor::create("lo");
+    ASSERT_TRUE(monitor.has_value()) << monitor.error();
+    EXPECT_EQ((*monitor)->interface(), "lo");
+    EXPECT_TRUE((*monitor)->up());
+    EXPECT_TRUE((*monitor)->wait_up(0ms));
+    EXPECT_EQ((*monitor)->generation(), 0);
+}
+
+TEST(InterfaceMonitorTest, MissingInterfaceIsDown) {
+    auto monitor = nmea::InterfaceMonitor::create("nmea-missing0");
+    ASSERT_TRUE(monitor.has_value()) << monitor.error();
+    EXPECT_FALSE((*monitor)->up());
+    EXPECT_FALSE((*monitor)->wait_up(10ms));
+    auto conn = (*monitor)->connect();
+    ASSERT_FALSE(conn.has_value());
+}
+
+TEST(InterfaceMonitorTest, ReconnectKeepsDescriptor) {
+    int old_fds[2];
+    int new_fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, old_fds), 0);
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, new_fds), 0);
+    nmea::SocketTransport transport(old_fds[0]);
+    ASSERT_TRUE(transport.reconnect(new_fds[0]).has_value());
+    EXPECT_EQ(transport.fd(), old_fds[0]);
+
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | 0x1234;
+    ASSERT_EQ(write(new_fds[1], &frame, sizeof(frame)), sizeof(frame));
+    can_frame received{};
+    ASSERT_TRUE(transport.read(received).has_value());
+    EXPECT_EQ(received.can_id, frame.can_id);
+
+    // The old socket was closed
+    EXPECT_EQ(read(old_fds[1], &received, sizeof(received)), 0);
+    close(old_fds[1]);
+    close(new_fds[1]);
+}
+
+TEST(InterfaceMonitorTest, VirtualTransportCannotReconnect) {
+    nmea::VirtualBus bus;
+    auto transport = bus.attach();
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    auto reconnected = transport->reconnect(fds[0]);
+    ASSERT_FALSE(reconnected.has_value());
+    EXPECT_EQ(reconnected.error(), "Transport cannot reconnect");
+    close(fds[1]);
+}
+
+TEST(InterfaceMonitorTest, ListenerReturnsErrorsWhileInterfaceIsUp) {
+    auto monitor = nmea::InterfaceMonitor::create("lo");
+    ASSERT_TRUE(monitor.has_value());
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    close(fds[1]);
+    nmea::Listener listener(fds[0]);
+    ASSERT_TRUE(listener.set_interface_monitor(monitor->get()).has_value());
+
+    // The monitor never saw the interface go down, so the error is not a reason to reconnect
+    auto result = listener.read();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Incomplete CAN frame");
+}
+
+TEST(InterfaceMonitorTest, WatchNeedsSocket) {
+    FakeMonitor monitor;
+    nmea::VirtualBus bus;
+    auto transport = bus.attach();
+    auto watch = monitor.watch(*transport);
+    ASSERT_FALSE(watch.has_value());
+    EXPECT_EQ(watch.error(), "Transport has no socket to watch");
+}
+
+TEST(InterfaceMonitorTest, ListenerReconnectsWhileBlockedInRead) {
+    FakeMonitor monitor;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    nmea::Listener listener(fds[0]);
+    ASSERT_TRUE(listener.set_interface_monitor(&monitor).has_value());
+
+    // Nothing is ever written to the old socket, nor is it closed, as on a dead interface
+    auto message = std::async(std::launch::async, [&] { return listener.read(); });
+    monitor.go_down();
+    monitor.come_up();
+    const int peer = monitor.wait_peer(0);
+    ASSERT_NE(peer, -1);
+    auto frame = heave_frame(0x21, 7);
+    ASSERT_EQ(write(peer, &frame, sizeof(frame)), static_cast<ssize_t>(sizeof(frame)));
+
+    ASSERT_TRUE(ready(message, fds[1])) << "read() blocked on the old socket";
+    auto result = message.get();
+    ASSERT_TRUE(result.has_value()) << result.error();
+    EXPECT_EQ(std::get<nmea::message::Heave>(*result).sid, 7);
+    close(fds[1]);
+}
+
+static nmea::Task<> cycle_link(FakeMonitor &monitor) {
+    monitor.go_down();
+    // Only resumed if the listener awaiting the link does not block the executor
+    co_await nmea::sleep_for(10ms);
+    monitor.come_up();
+    while (monitor.peer(0) == -1) {
+        co_await nmea::sleep_for(1ms);
+    }
+    auto frame = heave_frame(0x21, 8);
+    [[maybe_unused]] auto written = write(monitor.peer(0), &frame, sizeof(frame));
+}
+
+TEST(InterfaceMonitorTest, ListenerAwaitsReconnectWithoutBlockingExecutor) {
+    FakeMonitor monitor;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    nmea::Listener listener(fds[0]);
+    ASSERT_TRUE(listener.set_interface_monitor(&monitor).has_value());
+
+    auto message = std::async(std::launch::async, [&] {
+        nmea::Executor executor;
+        executor.spawn(cycle_link(monitor));
+        return executor.block_on(listener.next<nmea::message::Heave>());
+    });
+    ASSERT_TRUE(ready(message, fds[1])) << "next() blocked the executor";
+    auto heave = message.get();
+    ASSERT_TRUE(heave.has_value()) << heave.error();
+    EXPECT_EQ(heave->sid, 8);
+    close(fds[1]);
+}
+
+TEST(InterfaceMonitorTest, DeviceClaimsAgainAfterReconnect) {
+    FakeMonitor monitor;
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0);
+    nmea::Device device(fds[0]);
+    auto claimed = device.claim({
+        .unique_number = 42,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    });
+    ASSERT_TRUE(claimed.get().has_value());
+    const auto address = device.address();
+    ASSERT_TRUE(address.has_value());
+    ASSERT_TRUE(device.set_interface_monitor(&monitor).has_value());
+
+    auto processed = std::async(std::launch::async, [&] { return device.process(1s); });
+    monitor.go_down();
+    monitor.come_up();
+    const int peer = monitor.wait_peer(0);
+    ASSERT_NE(peer, -1);
+
+    // The request for address claims, and the claim of the same address once nobody objected
+    std::vector<uint32_t> pfs;
+    can_frame frame{};
+    pollfd pfd{.fd = peer, .events = POLLIN, .revents = 0};
+    while (pfs.size() < 2 && poll(&pfd, 1, 2000) == 1) {
+        ASSERT_EQ(recv(peer, &frame, sizeof(frame), 0), static_cast<ssize_t>(sizeof(frame)));
+        pfs.push_back((frame.can_id >> 16) & 0xFF);
+    }
+    EXPECT_EQ(pfs, (std::vector<uint32_t>{0xEA, 0xEE}));
+    EXPECT_EQ(frame.can_id & 0xFF, *address);
+
+    ASSERT_TRUE(ready(processed, fds[1])) << "process() blocked on the old socket";
+    auto result = processed.get();
+    ASSERT_TRUE(result.has_value()) << result.error();
+    EXPECT_EQ(device.address(), address);
+
+    // Sent after the first heartbeat of `process()`
+    ASSERT_TRUE(device.send(nmea::message::Heave{.sid = 3}).has_value());
+    do {
+        ASSERT_EQ(recv(peer, &frame, sizeof(frame), MSG_DONTWAIT),
+                  static_cast<ssize_t>(sizeof(frame)));
+    } while (((frame.can_id >> 8) & 0x3FFFF) != nmea::pgn::HEAVE);
+    EXPECT_EQ(frame.data[0], 3);
+    close(fds[1]);
+}
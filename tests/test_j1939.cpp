@@ -0,0 +1,195 @@
+#include "nmea/bus_load.hpp"
+#include "nmea/connection.hpp"
+#include "nmea/device.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/transport.hpp"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// Stands in for the kernel J1939 stack, which is not available everywhere the tests run
+class PacketTransport : public nmea::Transport {
+public:
+    std::deque<nmea::Packet> incoming;
+    std::vector<nmea::Packet> written;
+    std::vector<can_frame> written_frames;
+
+    std::expected<void, std::string> read(can_frame &frame) override {
+        if (incoming.empty()) {
+            return std::unexpected("No more packets");
+        }
+        const auto packet = incoming.front();
+        incoming.pop_front();
+        frame = can_frame{};
+        frame.can_id = packet.can_id();
+        frame.can_dlc = static_cast<uint8_t>(packet.data.size());
+        std::copy(packet.data.begin(), packet.data.end(), frame.data);
+        return {};
+    }
+    std::expected<void, std::string> write(const can_frame &frame) override {
+        written_frames.push_back(frame);
+        return {};
+    }
+    bool wait(std::chrono::milliseconds /* timeout */) override { return !incoming.empty(); }
+    int fd() const override { return -1; }
+
+    bool reassembles() const override { return true; }
+    std::expected<void, std::string> read_packet(nmea::Packet &packet) override {
+        if (incoming.empty()) {
+            return std::unexpected("No more packets");
+        }
+        packet = std::move(incoming.front());
+        incoming.pop_front();
+        return {};
+    }
+    std::expected<void, std::string> write_packet(const nmea::Packet &packet) override {
+        written.push_back(packet);
+        return {};
+    }
+};
+
+TEST(J1939Test, PacketCanId) {
+    nmea::Packet broadcast{
+        .pgn = nmea::pgn::HEAVE, .priority = 3, .source = 0x21, .destination = 0xFF, .data = {}};
+    EXPECT_EQ(broadcast.can_id(), CAN_EFF_FLAG | (3u << 26) | (nmea::pgn::HEAVE << 8) | 0x21);
+
+    // PDU1 PGNs carry the destination instead of the lower byte of the PGN
+    nmea::Packet request{
+        .pgn = 59904, .priority = 6, .source = 0x21, .destination = 0x42, .data = {}};
+    EXPECT_EQ(request.can_id(), CAN_EFF_FLAG | (6u << 26) | (0xEA42u << 8) | 0x21);
+}
+
+TEST(J1939Test, ListenerDecodesWholePackets) {
+    auto transport = std::make_unique<PacketTransport>();
+    auto *packets = transport.get();
+    nmea::Listener listener(std::move(transport));
+    nmea::BusLoad bus_load;
+    listener.set_bus_load(&bus_load);
+
+    nmea::message::VesselSpeedComponents original{
+        .longitudinal = {.water = 1.0, .ground = 2.0},
+        .transverse = {.water = 3.0, .ground = 4.0},
+        .stern = {.water = 5.0, .ground = 6.0},
+    };
+    auto serialized = nmea::serialize(original);
+    ASSERT_GT(serialized.data.size(), 8);
+    packets->incoming.push_back({.pgn = serialized.pgn,
+                                 .priority = 2,
+                                 .source = 0x33,
+                                 .destination = 0xFF,
+                                 .data = serialized.data});
+
+    auto result = listener.read();
+    ASSERT_TRUE(result.has_value()) << result.error();
+    auto *msg = std::get_if<nmea::message::VesselSpeedComponents>(&*result);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_DOUBLE_EQ(msg->stern.ground, 6.0);
+    EXPECT_EQ(listener.last_source(), 0x33);
+    EXPECT_EQ(bus_load.total().frames, 1);
+
+    // Decoding errors are returned, transport errors too once the packets run out
+    packets->incoming.push_back(
+        {.pgn = 65280, .priority = 6, .source = 0x33, .destination = 0xFF, .data = {1, 2}});
+    EXPECT_FALSE(listener.read().has_value());
+    auto end = listener.read();
+    ASSERT_FALSE(end.has_value());
+    EXPECT_EQ(end.error(), "No more packets");
+}
+
+TEST(J1939Test, DeviceSendsWholePackets) {
+    auto transport = std::make_unique<PacketTransport>();
+    auto *packets = transport.get();
+    nmea::Device device(std::move(transport));
+    // Nobody answers the claim
+    auto claimed = device.claim({
+        .unique_number = 7,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    });
+    ASSERT_TRUE(claimed.get().has_value());
+    // The address claim procedure goes out as single frames
+    EXPECT_EQ(packets->written_frames.size(), 2);
+
+    ASSERT_TRUE(device.send(nmea::message::VesselSpeedComponents{}).has_value());
+    ASSERT_EQ(packets->written.size(), 1);
+    EXPECT_EQ(packets->written[0].pgn, nmea::pgn::VESSEL_SPEED);
+    EXPECT_EQ(packets->written[0].source, *device.address());
+    EXPECT_GT(packets->written[0].data.size(), 8);
+    // No TP frames from the library
+    EXPECT_EQ(packets->written_frames.size(), 2);
+}
+
+// Runs against the kernel stack, which is only available once set up with eg.
+// `modprobe can-j1939 && ip link add vcan0 type vcan && ip link set vcan0 up`
+TEST(J1939Test, KernelSendsAddressClaimAndTransfers) {
+    auto conn = nmea::connect("vcan0", nmea::Protocol::J1939);
+    if (!conn) {
+        GTEST_SKIP() << "No J1939 socket on vcan0: " << conn.error();
+    }
+    auto raw = nmea::connect("vcan0");
+    ASSERT_TRUE(raw.has_value()) << raw.error();
+    auto bus = nmea::socket_transport(*raw);
+
+    nmea::Device device(*conn);
+    const nmea::DeviceName name{
+        .unique_number = 11,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    };
+    // The kernel rejects a claim from a socket that is not bound to the claimed NAME
+    auto claimed = device.claim(name).get();
+    ASSERT_TRUE(claimed.has_value()) << claimed.error();
+    ASSERT_TRUE(device.send(nmea::message::VesselSpeedComponents{}).has_value());
+
+    bool claim_seen = false;
+    bool transfer_seen = false;
+    can_frame frame{};
+    while (!transfer_seen && bus->wait(std::chrono::milliseconds(1000)) && bus->read(frame)) {
+        const uint8_t pf = (frame.can_id >> 16) & 0xFF;
+        if ((frame.can_id & 0xFF) != *device.address()) {
+            continue;
+        }
+        if (pf == 0xEE) {
+            uint64_t claimed_name = 0;
+            for (int i = 0; i < 8; i++) {
+                claimed_name |= uint64_t{frame.data[i]} << (i * 8);
+            }
+            EXPECT_EQ(claimed_name & 0x1FFFFF, name.unique_number);
+            claim_seen = true;
+        } else if (pf == 0xEC && frame.data[0] == 0x20) {
+            // Broadcast by the kernel from the claimed address
+            const uint32_t pgn = frame.data[5] | (frame.data[6] << 8) | (frame.data[7] << 16);
+            EXPECT_EQ(pgn, nmea::pgn::VESSEL_SPEED);
+            transfer_seen = true;
+        }
+    }
+    EXPECT_TRUE(claim_seen);
+    EXPECT_TRUE(transfer_seen);
+}
+
+TEST(J1939Test, RawSocketsGetFrameTransport) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    auto transport = nmea::socket_transport(fds[0]);
+    EXPECT_FALSE(transport->reassembles());
+    nmea::Packet packet{};
+    EXPECT_FALSE(transport->read_packet(packet).has_value());
+    close(fds[1]);
+}
@@ -0,0 +1,73 @@
+#include "nmea/json.hpp"
+#include "nmea/message.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace std::chrono_literals;
+
+// 2024-05-01T12:30:00.250Z
+static const nmea::JsonEncoder::Clock::time_point TIMESTAMP{1714566600250ms};
+
+TEST(JsonEncoderTest, SignalKDelta) {
+    nmea::JsonEncoder encoder;
+    encoder.add(nmea::message::Position{.latitude = 52.5, .longitude = -4.25}, 0x23, TIMESTAMP);
+    EXPECT_EQ(encoder.pending(), 1);
+    EXPECT_EQ(encoder.finish(),
+              R"({"context":"vessels.self","updates":[{"source":{"label":"can0","type":"NMEA2000",)"
+              R"("pgn":129025,"src":"35"},"timestamp":"2024-05-01T12:30:00.250Z","values":[)"
+              R"({"path":"navigation.position","value":{"latitude":52.5,"longitude":-4.25}}]}]})"
+              "\n");
+    EXPECT_EQ(encoder.pending(), 0);
+}
+
+TEST(JsonEncoderTest, BatchesUpdatesIntoOneDelta) {
+    nmea::JsonEncoder encoder({.context = "vessels.urn:mrn:imo:mmsi:123", .label = "n2k"});
+    encoder.add(nmea::message::CogSog{.sid = 1, .cog_reference = 0, .cog = 1.5, .sog = 2.25}, 1,
+                TIMESTAMP);
+    encoder.add(nmea::message::Heave{.sid = 2, .heave = 0.5}, 2, TIMESTAMP);
+    EXPECT_EQ(encoder.finish(),
+              R"({"context":"vessels.urn:mrn:imo:mmsi:123","updates":[)"
+              R"({"source":{"label":"n2k","type":"NMEA2000","pgn":129026,"src":"1"},)"
+              R"("timestamp":"2024-05-01T12:30:00.250Z","values":[)"
+              R"({"path":"navigation.courseOverGroundTrue","value":1.5},)"
+              R"({"path":"navigation.speedOverGround","value":2.25}]},)"
+              R"({"source":{"label":"n2k","type":"NMEA2000","pgn":127252,"src":"2"},)"
+              R"("timestamp":"2024-05-01T12:30:00.250Z","values":[)"
+              R"({"path":"environment.heave","value":0.5}]}]})"
+              "\n");
+}
+
+TEST(JsonEncoderTest, UnmappedSourcesHaveNoValues) {
+    nmea::JsonEncoder encoder;
+    encoder.add(nmea::message::Temperature{.source = 200, .actual_temperature = 300.0}, 1,
+                TIMESTAMP);
+    const std::string delta(encoder.finish());
+    EXPECT_NE(delta.find(R"("values":[]})"), std::string::npos);
+}
+
+TEST(JsonEncoderTest, JsonLines) {
+    nmea::JsonEncoder encoder({.format = nmea::JsonFormat::JSON_LINES});
+    encoder.add(nmea::message::Heave{.sid = 2, .heave = 0.5}, 7);
+    encoder.add(nmea::message::Attitude{.sid = 3, .yaw = 0.1, .pitch = -0.2, .roll = 0.25}, 8);
+    EXPECT_EQ(encoder.finish(),
+              "{\"pgn\":127252,\"src\":7,\"sid\":2,\"heave\":0.5}\n"
+              "{\"pgn\":127257,\"src\":8,\"sid\":3,\"yaw\":0.1,\"pitch\":-0.2,\"roll\":0.25}\n");
+}
+
+TEST(JsonEncoderTest, BufferIsReusedBetweenBatches) {
+    nmea::JsonEncoder encoder({.format = nmea::JsonFormat::JSON_LINES});
+    encoder.add(nmea::message::Heave{.sid = 1, .heave = 1.0}, 1);
+    EXPECT_EQ(encoder.finish(), "{\"pgn\":127252,\"src\":1,\"sid\":1,\"heave\":1}\n");
+    EXPECT_EQ(encoder.finish(), "");
+
+    encoder.add(nmea::message::Heave{.sid = 2, .heave = 2.0}, 1);
+    EXPECT_EQ(encoder.finish(), "{\"pgn\":127252,\"src\":1,\"sid\":2,\"heave\":2}\n");
+}
+
+TEST(JsonEncoderTest, EscapesStrings) {
+    nmea::JsonEncoder encoder({.label = "bus \"a\"\n"});
+    encoder.add(nmea::message::Heave{.sid = 1, .heave = 1.0}, 1, TIMESTAMP);
+    const std::string delta(encoder.finish());
+    EXPECT_NE(delta.find(R"("label":"bus \"a\"\u000a")"), std::string::npos);
+}
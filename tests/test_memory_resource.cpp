@@ -0,0 +1,147 @@
+#include "frames.hpp"
+#include "nmea/decoder.hpp"
+#include "nmea/device.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <variant>
+#include <vector>
+
+// Heap allocations of the current thread while `counting_allocations` is set, counted by the
+// replaced global `operator new`, which every other allocation function ends up in
+static thread_local bool counting_allocations = false;
+static thread_local size_t heap_allocations = 0;
+
+void *operator new(size_t size) {
+    if (counting_allocations) {
+        heap_allocations++;
+    }
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t /* size */) noexcept { std::free(p); }
+
+// Counts the allocations that reach it before passing them on
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST(MemoryResourceTest, SerializeIntoArena) {
+    std::array<std::byte, 64> storage;
+    // Throws if the arena runs out instead of going to the heap
+    std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size(),
+                                              std::pmr::null_memory_resource());
+    nmea::message::VesselSpeedComponents speed{.stern = {.water = 1.5, .ground = 2.5}};
+    nmea::pmr::SerializedMessage serialized =
+        nmea::serialize(speed, std::pmr::polymorphic_allocator<uint8_t>(&arena));
+
+    EXPECT_EQ(serialized.data.get_allocator().resource(), &arena);
+    EXPECT_EQ(serialized.pgn, nmea::pgn::VESSEL_SPEED);
+    auto parsed = nmea::parse(serialized.pgn << 8, serialized.data);
+    ASSERT_TRUE(parsed.has_value()) << parsed.error();
+    EXPECT_DOUBLE_EQ(std::get<nmea::message::VesselSpeedComponents>(*parsed).stern.ground, 2.5);
+
+    // Same payload as with the default allocator
+    auto heap = nmea::serialize(speed);
+    EXPECT_TRUE(std::equal(heap.data.begin(), heap.data.end(), serialized.data.begin(),
+                           serialized.data.end()));
+}
+
+TEST(MemoryResourceTest, DecoderReusesTransferBuffers) {
+    CountingResource resource;
+    nmea::Decoder decoder(&resource);
+    const auto frames = message_frames(nmea::message::VesselSpeedComponents{}, 0x21);
+
+    auto decode_all = [&] {
+        int messages = 0;
+        for (const auto &frame : frames) {
+            auto result = decoder.decode(frame);
+            if (result) {
+                EXPECT_TRUE(result->has_value()) << result->error();
+                messages++;
+            }
+        }
+        return messages;
+    };
+    ASSERT_EQ(decode_all(), 1);
+    const size_t warm = resource.allocations;
+    EXPECT_GT(warm, 0);
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(decode_all(), 1);
+    }
+    EXPECT_EQ(resource.allocations, warm);
+}
+
+TEST(MemoryResourceTest, ListenerAllocatesFromResource) {
+    CountingResource resource;
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach(), &resource);
+
+    for (const auto &frame : message_frames(nmea::message::VesselSpeedComponents{}, 0x10)) {
+        ASSERT_TRUE(sender->write(frame).has_value());
+    }
+    auto result = listener.read();
+    ASSERT_TRUE(result.has_value()) << result.error();
+    EXPECT_TRUE(std::holds_alternative<nmea::message::VesselSpeedComponents>(*result));
+    EXPECT_GT(resource.allocations, 0);
+}
+
+TEST(MemoryResourceTest, DeviceSerializesOnTheStack) {
+    nmea::VirtualBus bus;
+    nmea::Device device(bus.attach());
+    // Nobody answers the claim
+    auto claimed = device.claim({
+        .unique_number = 3,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    });
+    ASSERT_TRUE(claimed.get().has_value());
+
+    // The first sends may set up the queue and the bus
+    ASSERT_TRUE(device.send(nmea::message::Heave{}).has_value());
+    ASSERT_TRUE(device.send(nmea::message::VesselSpeedComponents{}).has_value());
+
+    heap_allocations = 0;
+    counting_allocations = true;
+    auto single = device.send(nmea::message::Heave{});
+    auto transfer = device.send(nmea::message::VesselSpeedComponents{});
+    counting_allocations = false;
+
+    EXPECT_TRUE(single.has_value());
+    EXPECT_TRUE(transfer.has_value());
+    EXPECT_EQ(heap_allocations, 0);
+}
@@ -3,6 +3,8 @@
 #include "nmea/listener.hpp"
 #include "nmea/message.hpp"
 #include <gtest/gtest.h>
+#include <linux/can.h>
+#include <linux/can/error.h>
 #include <optional>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -30,8 +32,9 @@ protected:
         device.emplace(fds[0]);
         listener.emplace(fds[1]);
         device->claim(name).get();
-        // Needed to flush address claim from the buffer
+        // Needed to flush the request for address claim and the address claim from the buffer
         auto _ = listener->read();
+        _ = listener->read();
     }
 };
 
@@ -233,3 +236,63 @@ TEST_F(MessageTest, ActualPressure) {
     EXPECT_EQ(msg->source, original.source);
     EXPECT_DOUBLE_EQ(msg->pressure, original.pressure);
 }
+
+TEST_F(MessageTest, ShortFrameReturnsError) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (2u << 26) | (nmea::pgn::POSITION << 8) | 0x10;
+    frame.can_dlc = 4;
+    write(device->sockfd(), &frame, sizeof(frame));
+
+    auto result = listener->read();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "PGN 129025 payload too short: got 4 bytes, expected 8");
+}
+
+TEST_F(MessageTest, InconsistentTpBamIsRejected) {
+    can_frame bam{};
+    bam.can_id = CAN_EFF_FLAG | (6u << 26) | (0xECu << 16) | (0xFFu << 8) | 0x10;
+    bam.can_dlc = 8;
+    // Claims 12 bytes but announces 200 packets
+    bam.data[0] = 0x20;
+    bam.data[1] = 12;
+    bam.data[3] = 200;
+    write(device->sockfd(), &bam, sizeof(bam));
+
+    auto result = listener->read();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Invalid TP BAM from source 10: 12 bytes in 200 packets");
+}
+
+TEST_F(MessageTest, OutOfOrderTpPacketReturnsError) {
+    can_frame bam{};
+    bam.can_id = CAN_EFF_FLAG | (6u << 26) | (0xECu << 16) | (0xFFu << 8) | 0x10;
+    bam.can_dlc = 8;
+    bam.data[0] = 0x20;
+    bam.data[1] = 12;
+    bam.data[3] = 2;
+    bam.data[5] = static_cast<uint8_t>(nmea::pgn::VESSEL_SPEED);
+    bam.data[6] = static_cast<uint8_t>(nmea::pgn::VESSEL_SPEED >> 8);
+    bam.data[7] = static_cast<uint8_t>(nmea::pgn::VESSEL_SPEED >> 16);
+    write(device->sockfd(), &bam, sizeof(bam));
+
+    can_frame dt{};
+    dt.can_id = CAN_EFF_FLAG | (6u << 26) | (0xEBu << 16) | (0xFFu << 8) | 0x10;
+    dt.can_dlc = 8;
+    dt.data[0] = 2;
+    write(device->sockfd(), &dt, sizeof(dt));
+
+    auto result = listener->read();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Out of order TP packet: expected 1, got 2");
+}
+
+TEST_F(MessageTest, ErrorFrameReturnsError) {
+    can_frame frame{};
+    frame.can_id = CAN_ERR_FLAG | CAN_ERR_BUSOFF;
+    frame.can_dlc = CAN_ERR_DLC;
+    write(device->sockfd(), &frame, sizeof(frame));
+
+    auto result = listener->read();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "CAN error frame with class 040");
+}
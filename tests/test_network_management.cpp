@@ -0,0 +1,204 @@
+#include "nmea/definitions.hpp"
+#include "nmea/device.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+class NetworkManagementTest : public ::testing::Test {
+protected:
+    nmea::VirtualBus bus;
+    std::unique_ptr<nmea::Transport> other = bus.attach();
+    nmea::Device device{bus.attach()};
+
+    void SetUp() override {
+        nmea::DeviceName name{
+            .unique_number = 42,
+            .manufacturer_code = ManufacturerCode::ACTISENSE,
+            .device_instance_lower = 0,
+            .device_instance_upper = 0,
+            .device_function = device_function::RADAR,
+            .system_instance = 0,
+            .industry_group = IndustryCode::MARINE,
+            .arbitrary_address_capable = true,
+        };
+        ASSERT_TRUE(device.claim(name).get().has_value());
+        // The first heartbeat is sent right after the claim
+        ASSERT_TRUE(device.heartbeat().has_value());
+        while (read_other()) {
+        }
+    }
+
+    void request(uint32_t pgn, uint8_t destination = 0xFF) {
+        can_frame frame{};
+        frame.can_id =
+            CAN_EFF_FLAG | (6u << 26) | (0xEAu << 16) | (uint32_t(destination) << 8) | 7;
+        frame.can_dlc = 3;
+        frame.data[0] = static_cast<uint8_t>(pgn);
+        frame.data[1] = static_cast<uint8_t>(pgn >> 8);
+        frame.data[2] = static_cast<uint8_t>(pgn >> 16);
+        ASSERT_TRUE(other->write(frame).has_value());
+        ASSERT_TRUE(device.process(0ms).has_value());
+    }
+
+    std::optional<can_frame> read_other() {
+        can_frame frame{};
+        if (!other->wait(0ms) || !other->read(frame)) {
+            return std::nullopt;
+        }
+        return frame;
+    }
+
+    static uint32_t pgn_of(const can_frame &frame) {
+        const uint32_t pgn = (frame.can_id >> 8) & 0x3FFFF;
+        return ((pgn >> 8) & 0xFF) < 240 ? pgn & 0x3FF00 : pgn;
+    }
+};
+
+TEST_F(NetworkManagementTest, AnswersProductInformationWithFastPacket) {
+    device.set_product_info({
+        .nmea2000_version = 2100,
+        .product_code = 1234,
+        .model_id = "Radar 9000",
+        .software_version = "1.2.3",
+        .model_version = "B",
+        .serial_code = "SN0042",
+        .certification_level = 1,
+        .load_equivalency = 2,
+    });
+    request(126996);
+
+    std::vector<uint8_t> data;
+    size_t total = 0;
+    for (uint8_t index = 0; index < 20; index++) {
+        auto frame = read_other();
+        ASSERT_TRUE(frame.has_value());
+        EXPECT_EQ(pgn_of(*frame), 126996u);
+        EXPECT_EQ(frame->can_id & 0xFF, *device.address());
+        EXPECT_EQ(frame->data[0] & 0x1F, index);
+        if (index == 0) {
+            total = frame->data[1];
+            data.insert(data.end(), frame->data + 2, frame->data + 8);
+        } else {
+            data.insert(data.end(), frame->data + 1, frame->data + 8);
+        }
+    }
+    EXPECT_FALSE(read_other().has_value());
+
+    ASSERT_EQ(total, 134);
+    EXPECT_EQ(data[0] | (data[1] << 8), 2100);
+    EXPECT_EQ(data[2] | (data[3] << 8), 1234);
+    EXPECT_EQ(std::string(data.begin() + 4, data.begin() + 14), "Radar 9000");
+    EXPECT_EQ(data[14], 0xFF);
+    EXPECT_EQ(std::string(data.begin() + 100, data.begin() + 106), "SN0042");
+    EXPECT_EQ(data[132], 1);
+    EXPECT_EQ(data[133], 2);
+}
+
+TEST_F(NetworkManagementTest, AnswersConfigurationInformationWithFastPacket) {
+    device.set_configuration_info({
+        .installation_description1 = "Mast head",
+        .installation_description2 = "",
+        .manufacturer_information = "Made by Example Marine",
+    });
+    request(126998);
+
+    std::vector<uint8_t> data;
+    size_t total = 0;
+    for (uint8_t index = 0; index < 6; index++) {
+        auto frame = read_other();
+        ASSERT_TRUE(frame.has_value());
+        EXPECT_EQ(pgn_of(*frame), 126998u);
+        EXPECT_EQ(frame->can_id & 0xFF, *device.address());
+        EXPECT_EQ(frame->data[0] & 0x1F, index);
+        if (index == 0) {
+            total = frame->data[1];
+            data.insert(data.end(), frame->data + 2, frame->data + 8);
+        } else {
+            data.insert(data.end(), frame->data + 1, frame->data + 8);
+        }
+    }
+    EXPECT_FALSE(read_other().has_value());
+
+    // Three strings, each after its length including the two header bytes and the ASCII marker
+    ASSERT_EQ(total, 11 + 2 + 24);
+    EXPECT_EQ(data[0], 11);
+    EXPECT_EQ(data[1], 1);
+    EXPECT_EQ(std::string(data.begin() + 2, data.begin() + 11), "Mast head");
+    EXPECT_EQ(data[11], 2);
+    EXPECT_EQ(data[13], 24);
+    EXPECT_EQ(std::string(data.begin() + 15, data.begin() + 37), "Made by Example Marine");
+}
+
+TEST_F(NetworkManagementTest, FastPacketSequenceAdvances) {
+    device.set_product_info({.model_id = "Radar"});
+    request(126996);
+    auto first = read_other();
+    while (read_other()) {
+    }
+    request(126996);
+    auto second = read_other();
+    ASSERT_TRUE(first && second);
+    EXPECT_NE(first->data[0] >> 5, second->data[0] >> 5);
+}
+
+TEST_F(NetworkManagementTest, AnswersAddressClaimAndHeartbeatRequests) {
+    request(60928);
+    auto claim = read_other();
+    ASSERT_TRUE(claim.has_value());
+    EXPECT_EQ(pgn_of(*claim), 60928u);
+    EXPECT_EQ(claim->can_id & 0xFF, *device.address());
+
+    request(126993, *device.address());
+    auto heartbeat = read_other();
+    ASSERT_TRUE(heartbeat.has_value());
+    EXPECT_EQ(pgn_of(*heartbeat), 126993u);
+    // 60 s in units of 10 ms
+    EXPECT_EQ(heartbeat->data[0] | (heartbeat->data[1] << 8), 6000);
+}
+
+TEST_F(NetworkManagementTest, RejectsUnsupportedRequestsAddressedToDevice) {
+    // Not answered without product information either
+    request(126996, *device.address());
+    auto nack = read_other();
+    ASSERT_TRUE(nack.has_value());
+    EXPECT_EQ(pgn_of(*nack), 59392u);
+    EXPECT_EQ(nack->data[0], 1);
+    EXPECT_EQ(nack->data[4], 7);
+    EXPECT_EQ(nack->data[5] | (nack->data[6] << 8) | (nack->data[7] << 16), 126996);
+
+    // Global requests and requests for other devices are not rejected
+    request(130312);
+    request(130312, static_cast<uint8_t>(*device.address() + 1));
+    EXPECT_FALSE(read_other().has_value());
+}
+
+TEST_F(NetworkManagementTest, SendsHeartbeatWhenDue) {
+    device.set_heartbeat_interval(50ms);
+    const auto now = nmea::Device::Clock::now();
+    auto next = device.heartbeat(now);
+    ASSERT_TRUE(next.has_value());
+    EXPECT_EQ(*next, now + 50ms);
+    auto first = read_other();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(pgn_of(*first), 126993u);
+    EXPECT_EQ(first->data[0] | (first->data[1] << 8), 5);
+
+    // Not due again before the interval
+    auto again = device.heartbeat(now + 10ms);
+    ASSERT_TRUE(again.has_value());
+    EXPECT_EQ(*again, *next);
+    EXPECT_FALSE(read_other().has_value());
+
+    ASSERT_TRUE(device.process(120ms).has_value());
+    auto second = read_other();
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(second->data[2], static_cast<uint8_t>(first->data[2] + 1));
+}
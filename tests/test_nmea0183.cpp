@@ -0,0 +1,112 @@
+#include "nmea/message.hpp"
+#include "nmea/nmea0183.hpp"
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <numbers>
+#include <string>
+#include <string_view>
+
+using namespace std::chrono_literals;
+using nmea::nmea0183::SentenceType;
+
+// 2024-05-01T12:30:05.250Z
+static const nmea::nmea0183::Gateway::Clock::time_point NOW{1714566605250ms};
+
+static double radians(double degrees) { return degrees * std::numbers::pi / 180.0; }
+
+// Checksum of the sentence between `$` and `*`
+static bool valid_checksum(std::string_view sentence) {
+    const auto star = sentence.find('*');
+    uint8_t checksum = 0;
+    for (char c : sentence.substr(1, star - 1)) {
+        checksum ^= static_cast<uint8_t>(c);
+    }
+    return std::stoi(std::string(sentence.substr(star + 1, 2)), nullptr, 16) == checksum;
+}
+
+TEST(Nmea0183Test, VesselHeadingMagnetic) {
+    nmea::nmea0183::Gateway gateway;
+    auto sentences = gateway.convert(
+        nmea::message::VesselHeading{
+            .heading = radians(90.0),
+            .deviation = radians(-2.5),
+            .variation = radians(1.0),
+            .reference = DirectionReference::MAGNETIC,
+        },
+        NOW);
+    ASSERT_EQ(sentences.size(), 2);
+    EXPECT_EQ(sentences[0].type(), SentenceType::HDG);
+    EXPECT_EQ(sentences[0].view().substr(0, sentences[0].view().find('*')),
+              "$IIHDG,90.0,2.5,W,1.0,E");
+    EXPECT_EQ(sentences[1].view().substr(0, sentences[1].view().find('*')), "$IIHDT,88.5,T");
+    EXPECT_TRUE(sentences[1].view().ends_with("\r\n"));
+    for (const auto &sentence : sentences) {
+        EXPECT_TRUE(valid_checksum(sentence.view())) << sentence.view();
+    }
+}
+
+TEST(Nmea0183Test, CogSog) {
+    nmea::nmea0183::Gateway gateway({.talker = {'G', 'P'}});
+    auto sentences = gateway.convert(
+        nmea::message::CogSog{.cog_reference = 0, .cog = radians(45.0), .sog = 5.0}, NOW);
+    ASSERT_EQ(sentences.size(), 1);
+    const auto vtg = sentences[0].view();
+    EXPECT_EQ(vtg.substr(0, vtg.find('*')), "$GPVTG,45.0,T,,M,9.7,N,18.0,K,A");
+    EXPECT_TRUE(valid_checksum(vtg));
+}
+
+TEST(Nmea0183Test, Position) {
+    nmea::nmea0183::Gateway gateway;
+    auto sentences =
+        gateway.convert(nmea::message::Position{.latitude = 52.5, .longitude = -4.9999999}, NOW);
+    ASSERT_EQ(sentences.size(), 1);
+    const auto gll = sentences[0].view();
+    EXPECT_EQ(gll.substr(0, gll.find('*')), "$IIGLL,5230.0000,N,00500.0000,W,123005.25,A,A");
+}
+
+TEST(Nmea0183Test, Temperatures) {
+    nmea::nmea0183::Gateway gateway;
+    auto sea = gateway.convert(
+        nmea::message::Temperature{.source = 0, .actual_temperature = 290.15}, NOW);
+    ASSERT_EQ(sea.size(), 1);
+    EXPECT_EQ(sea[0].type(), SentenceType::MTW);
+    EXPECT_EQ(sea[0].view().substr(0, sea[0].view().find('*')), "$IIMTW,17.0,C");
+
+    auto engine = gateway.convert(
+        nmea::message::Temperature{.instance = 3, .source = 3, .actual_temperature = 353.15}, NOW);
+    ASSERT_EQ(engine.size(), 1);
+    EXPECT_EQ(engine[0].view().substr(0, engine[0].view().find('*')), "$IIXDR,C,80.0,C,Temp3");
+}
+
+TEST(Nmea0183Test, Pressure) {
+    nmea::nmea0183::Gateway gateway;
+    auto sentences =
+        gateway.convert(nmea::message::ActualPressure{.source = 0, .pressure = 101325.0}, NOW);
+    ASSERT_EQ(sentences.size(), 1);
+    EXPECT_EQ(sentences[0].view().substr(0, sentences[0].view().find('*')),
+              "$IIXDR,P,1.01325,B,Barometer");
+}
+
+TEST(Nmea0183Test, RateLimit) {
+    nmea::nmea0183::Gateway gateway;
+    gateway.set_interval(SentenceType::XDR, 1000ms);
+    const nmea::message::Heave heave{.heave = 0.5};
+    const nmea::message::Attitude attitude{.pitch = radians(1.0), .roll = radians(-2.0)};
+
+    EXPECT_EQ(gateway.convert(heave, NOW).size(), 1);
+    EXPECT_EQ(gateway.convert(heave, NOW + 500ms).size(), 0);
+    // Tracked separately from the heave
+    EXPECT_EQ(gateway.convert(attitude, NOW + 500ms).size(), 1);
+    EXPECT_EQ(gateway.convert(heave, NOW + 1000ms).size(), 1);
+    // Other sentence types are not limited
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(gateway.convert(nmea::message::RateOfTurn{.rate = 0.01}, NOW).size(), 1);
+    }
+}
+
+TEST(Nmea0183Test, OversizedSentenceIsDropped) {
+    nmea::nmea0183::Gateway gateway;
+    auto sentences = gateway.convert(nmea::message::Heave{.heave = 1e80}, NOW);
+    EXPECT_TRUE(sentences.empty());
+}
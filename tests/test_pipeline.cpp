@@ -0,0 +1,153 @@
+#include "frames.hpp"
+#include "nmea/decoder.hpp"
+#include "nmea/message.hpp"
+#include "nmea/pipeline.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <map>
+#include <thread>
+#include <vector>
+
+// Traffic from many sources where the TP transfers of different sources are interleaved
+static std::vector<can_frame> traffic(int rounds) {
+    constexpr uint8_t SOURCES = 20;
+    std::vector<can_frame> result;
+    for (int round = 0; round < rounds; round++) {
+        std::vector<std::vector<can_frame>> per_source;
+        for (uint8_t source = 0; source < SOURCES; source++) {
+            nmea::message::VesselSpeedComponents speed{
+                .longitudinal = {.water = round * 0.001, .ground = source * 0.001},
+            };
+            auto tp = message_frames(speed, source);
+            nmea::message::Heave heave_msg{.heave = (round % 100) * 0.01};
+            auto heave = message_frames(heave_msg, source);
+            tp.insert(tp.begin() + 1, heave.begin(), heave.end());
+            per_source.push_back(std::move(tp));
+        }
+        for (size_t i = 0; i < per_source.front().size(); i++) {
+            for (auto &source_frames : per_source) {
+                result.push_back(source_frames[i]);
+            }
+        }
+    }
+    return result;
+}
+
+// Messages do not have equality operators, so compare what they serialize to
+static std::vector<uint8_t> bytes(const std::expected<nmea::NmeaMessage, std::string> &result) {
+    if (!result) {
+        return {result.error().begin(), result.error().end()};
+    }
+    auto serialized = nmea::serialize(*result);
+    serialized.data.push_back(static_cast<uint8_t>(serialized.pgn));
+    serialized.data.push_back(static_cast<uint8_t>(serialized.pgn >> 8));
+    return serialized.data;
+}
+
+TEST(PipelineTest, OrderedOutputMatchesSequentialDecode) {
+    auto input = traffic(50);
+
+    std::vector<std::vector<uint8_t>> expected;
+    nmea::Decoder decoder;
+    for (const auto &frame : input) {
+        if (auto result = decoder.decode(frame)) {
+            expected.push_back(bytes(*result));
+        }
+    }
+
+    // The queues are much smaller than the input, so ingest has to run alongside the consumer
+    nmea::Pipeline pipeline({.workers = 4, .capacity = 64});
+    std::thread ingest([&] {
+        for (const auto &frame : input) {
+            pipeline.push(frame);
+        }
+        pipeline.close();
+    });
+
+    std::vector<std::vector<uint8_t>> actual;
+    uint64_t last_sequence = 0;
+    while (auto decoded = pipeline.next()) {
+        EXPECT_TRUE(actual.empty() || decoded->sequence > last_sequence);
+        last_sequence = decoded->sequence;
+        actual.push_back(bytes(decoded->message));
+    }
+    ingest.join();
+    ASSERT_EQ(actual.size(), expected.size());
+    EXPECT_EQ(actual, expected);
+}
+
+TEST(PipelineTest, ShardsKeepPerSourceOrder) {
+    nmea::Pipeline pipeline({.workers = 3});
+    ASSERT_EQ(pipeline.shards(), 3);
+    for (const auto &frame : traffic(20)) {
+        pipeline.push(frame);
+    }
+    pipeline.close();
+
+    std::map<uint8_t, std::vector<uint64_t>> sequences;
+    for (size_t shard = 0; shard < pipeline.shards(); shard++) {
+        while (auto decoded = pipeline.next(shard)) {
+            ASSERT_TRUE(decoded->message.has_value()) << decoded->message.error();
+            EXPECT_EQ(decoded->source % pipeline.shards(), shard);
+            sequences[decoded->source].push_back(decoded->sequence);
+        }
+    }
+
+    ASSERT_EQ(sequences.size(), 20);
+    for (const auto &[source, source_sequences] : sequences) {
+        EXPECT_EQ(source_sequences.size(), 40);
+        EXPECT_TRUE(std::ranges::is_sorted(source_sequences));
+    }
+}
+
+TEST(PipelineTest, ErrorsArePassedThrough) {
+    nmea::Pipeline pipeline({.workers = 2});
+    auto heave = message_frames(nmea::message::Heave{.heave = 1.0}, 0x10);
+    heave.front().can_dlc = 1;
+    pipeline.push(heave.front());
+    pipeline.close();
+
+    auto decoded = pipeline.next();
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->source, 0x10);
+    EXPECT_FALSE(decoded->message.has_value());
+    EXPECT_FALSE(pipeline.next().has_value());
+}
+
+TEST(PipelineTest, IngestsFromTransport) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Pipeline pipeline(bus.attach(), {.workers = 2});
+
+    for (uint8_t source = 0; source < 4; source++) {
+        nmea::message::Heave heave{.heave = source * 0.5};
+        for (const auto &frame : message_frames(heave, source)) {
+            ASSERT_TRUE(sender->write(frame).has_value());
+        }
+    }
+
+    for (uint8_t source = 0; source < 4; source++) {
+        auto decoded = pipeline.next();
+        ASSERT_TRUE(decoded.has_value());
+        EXPECT_EQ(decoded->source, source);
+        EXPECT_DOUBLE_EQ(std::get<nmea::message::Heave>(decoded->message.value()).heave,
+                         source * 0.5);
+    }
+    EXPECT_FALSE(pipeline.ingest_error().has_value());
+}
+
+TEST(PipelineTest, DestroyingWithUnconsumedMessagesDoesNotBlock) {
+    nmea::Pipeline pipeline({.workers = 2, .capacity = 4});
+    for (const auto &frame : message_frames(nmea::message::Heave{.heave = 1.0}, 0x10)) {
+        pipeline.push(frame);
+    }
+    auto decoded = pipeline.next();
+    ASSERT_TRUE(decoded.has_value());
+    // Fills the output queues of both workers up to their capacity
+    for (uint8_t source = 0; source < 16; source++) {
+        pipeline.push(message_frames(nmea::message::Heave{.heave = 1.0}, source).front());
+    }
+}
@@ -0,0 +1,119 @@
+#include "nmea/definitions.hpp"
+#include "nmea/device.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/publisher.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <chrono>
+#include <gtest/gtest.h>
+#include <optional>
+
+using namespace std::chrono_literals;
+
+class PublisherTest : public ::testing::Test {
+protected:
+    nmea::VirtualBus bus;
+    std::optional<nmea::Device> device;
+    std::optional<nmea::Listener> listener;
+    std::optional<nmea::Publisher> publisher;
+
+    const nmea::Publisher::Clock::time_point start{10s};
+
+    nmea::DeviceName name{
+        .unique_number = 42,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    };
+
+    void SetUp() override {
+        device.emplace(bus.attach());
+        listener.emplace(bus.attach());
+        device->claim(name).get();
+        // Needed to flush the request for address claim and the address claim from the buffer
+        auto _ = listener->read();
+        _ = listener->read();
+        publisher.emplace(*device);
+    }
+
+    nmea::message::CogSog cogsog(double sog) {
+        return {.sid = 1, .cog_reference = 0, .cog = 1.0, .sog = sog};
+    }
+};
+
+TEST_F(PublisherTest, UnconfiguredTypeIsRejected) {
+    auto result = publisher->update(nmea::message::Temperature{});
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "Message type has not been configured for publishing");
+}
+
+TEST_F(PublisherTest, FirstUpdateIsSentImmediately) {
+    publisher->configure<nmea::message::CogSog>({.interval = 100ms});
+    ASSERT_TRUE(publisher->update(cogsog(1.0)).has_value());
+
+    auto sent = publisher->flush(start);
+    ASSERT_TRUE(sent.has_value());
+    EXPECT_EQ(*sent, 1);
+
+    auto result = listener->read();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_DOUBLE_EQ(std::get<nmea::message::CogSog>(*result).sog, 1.0);
+}
+
+TEST_F(PublisherTest, UpdatesWithinIntervalAreCoalesced) {
+    publisher->configure<nmea::message::CogSog>({.interval = 100ms});
+    ASSERT_TRUE(publisher->update(cogsog(1.0)).has_value());
+    ASSERT_EQ(publisher->flush(start).value(), 1);
+
+    ASSERT_TRUE(publisher->update(cogsog(2.0)).has_value());
+    EXPECT_EQ(publisher->flush(start + 30ms).value(), 0);
+    ASSERT_TRUE(publisher->update(cogsog(3.0)).has_value());
+    EXPECT_EQ(publisher->flush(start + 60ms).value(), 0);
+    EXPECT_EQ(publisher->next_due(), start + 100ms);
+    EXPECT_EQ(publisher->flush(start + 100ms).value(), 1);
+
+    auto _ = listener->read();
+    auto result = listener->read();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_DOUBLE_EQ(std::get<nmea::message::CogSog>(*result).sog, 3.0);
+}
+
+TEST_F(PublisherTest, UnchangedValuesAreSkipped) {
+    publisher->configure<nmea::message::CogSog>({.interval = 100ms, .tolerance = 0.05});
+    ASSERT_TRUE(publisher->update(cogsog(1.0)).has_value());
+    ASSERT_EQ(publisher->flush(start).value(), 1);
+
+    ASSERT_TRUE(publisher->update(cogsog(1.01)).has_value());
+    EXPECT_EQ(publisher->flush(start + 200ms).value(), 0);
+    EXPECT_FALSE(publisher->next_due().has_value());
+
+    ASSERT_TRUE(publisher->update(cogsog(1.5)).has_value());
+    EXPECT_EQ(publisher->flush(start + 300ms).value(), 1);
+}
+
+TEST_F(PublisherTest, UnchangedValuesAreRepeatedAtMaxInterval) {
+    publisher->configure<nmea::message::CogSog>({.interval = 100ms, .max_interval = 1s});
+    ASSERT_TRUE(publisher->update(cogsog(1.0)).has_value());
+    ASSERT_EQ(publisher->flush(start).value(), 1);
+
+    EXPECT_EQ(publisher->flush(start + 500ms).value(), 0);
+    EXPECT_EQ(publisher->next_due(), start + 1s);
+    EXPECT_EQ(publisher->flush(start + 1s).value(), 1);
+}
+
+TEST_F(PublisherTest, TypesHaveIndependentRates) {
+    publisher->configure<nmea::message::CogSog>({.interval = 100ms});
+    publisher->configure<nmea::message::Temperature>({.interval = 1s});
+    ASSERT_TRUE(publisher->update(cogsog(1.0)).has_value());
+    ASSERT_TRUE(publisher->update(nmea::message::Temperature{.actual_temperature = 290}).has_value());
+    ASSERT_EQ(publisher->flush(start).value(), 2);
+
+    ASSERT_TRUE(publisher->update(cogsog(2.0)).has_value());
+    ASSERT_TRUE(publisher->update(nmea::message::Temperature{.actual_temperature = 291}).has_value());
+    EXPECT_EQ(publisher->flush(start + 100ms).value(), 1);
+    EXPECT_EQ(publisher->flush(start + 1s).value(), 1);
+}
@@ -1,5 +1,7 @@
 #include "nmea/message.hpp"
+#include <cstdint>
 #include <gtest/gtest.h>
+#include <span>
 
 TEST(SerializationTest, CogSog) {
     nmea::message::CogSog original{
@@ -102,3 +104,18 @@ TEST(SerializationTest, VesselSpeedComponents) {
     EXPECT_EQ(msg->stern.water, original.stern.water);
     EXPECT_EQ(msg->stern.ground, original.stern.ground);
 }
+
+TEST(SerializationTest, TruncatedPayloadReturnsError) {
+    auto serialized = nmea::serialize(nmea::message::VesselSpeedComponents{});
+    ASSERT_EQ(serialized.data.size(), 12);
+
+    auto truncated = std::span<const uint8_t>(serialized.data).first(8);
+    auto parsed = nmea::parse(serialized.pgn << 8, truncated);
+    ASSERT_FALSE(parsed.has_value());
+    EXPECT_EQ(parsed.error(), "PGN 130578 payload too short: got 8 bytes, expected 12");
+}
+
+TEST(SerializationTest, EmptyPayloadReturnsError) {
+    auto parsed = nmea::parse(nmea::pgn::VESSEL_HEADING << 8, {});
+    ASSERT_FALSE(parsed.has_value());
+}
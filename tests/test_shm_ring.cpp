@@ -0,0 +1,115 @@
+#include "frames.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/shm_ring.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <chrono>
+#include <format>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <string>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+class ShmRingTest : public ::testing::Test {
+protected:
+    std::string name = std::format("/nmea-test-{}", getpid());
+};
+
+TEST_F(ShmRingTest, ReaderSeesEntriesWrittenAfterOpening) {
+    auto writer = nmea::ShmRingWriter::create(name, {.capacity = 16});
+    ASSERT_TRUE(writer.has_value()) << writer.error();
+    writer->write(heave_frame(1, 0));
+
+    auto reader = nmea::ShmRingReader::open(name);
+    ASSERT_TRUE(reader.has_value()) << reader.error();
+    auto empty = reader->next();
+    ASSERT_TRUE(empty.has_value());
+    EXPECT_FALSE(empty->has_value());
+
+    const auto timestamp = std::chrono::system_clock::time_point(1714566600123456789ns);
+    writer->write(heave_frame(2, 7), nmea::message::Heave{.sid = 7, .heave = 0.5}, timestamp);
+    writer->write(heave_frame(3, 8));
+
+    auto first = reader->next();
+    ASSERT_TRUE(first.has_value() && first->has_value());
+    EXPECT_EQ((*first)->sequence, 1);
+    EXPECT_EQ((*first)->timestamp, timestamp);
+    EXPECT_EQ((*first)->frame.can_id & 0xFF, 2);
+    ASSERT_TRUE((*first)->message.has_value());
+    EXPECT_DOUBLE_EQ(std::get<nmea::message::Heave>(*(*first)->message).heave, 0.5);
+
+    auto second = reader->next();
+    ASSERT_TRUE(second.has_value() && second->has_value());
+    EXPECT_EQ((*second)->frame.data[0], 8);
+    EXPECT_FALSE((*second)->message.has_value());
+
+    EXPECT_FALSE(reader->next()->has_value());
+}
+
+TEST_F(ShmRingTest, IndependentReaders) {
+    auto writer = nmea::ShmRingWriter::create(name);
+    ASSERT_TRUE(writer.has_value()) << writer.error();
+    auto a = nmea::ShmRingReader::open(name);
+    auto b = nmea::ShmRingReader::open(name);
+    ASSERT_TRUE(a.has_value() && b.has_value());
+
+    for (uint8_t i = 0; i < 10; i++) {
+        writer->write(heave_frame(1, i));
+    }
+    for (uint8_t i = 0; i < 10; i++) {
+        EXPECT_EQ((*a->next())->frame.data[0], i);
+    }
+    EXPECT_EQ((*b->next())->frame.data[0], 0);
+}
+
+TEST_F(ShmRingTest, DetectsOverrun) {
+    auto writer = nmea::ShmRingWriter::create(name, {.capacity = 10});
+    ASSERT_TRUE(writer.has_value()) << writer.error();
+    EXPECT_EQ(writer->capacity(), 16);
+    auto reader = nmea::ShmRingReader::open(name);
+    ASSERT_TRUE(reader.has_value()) << reader.error();
+
+    for (uint8_t i = 0; i < 40; i++) {
+        writer->write(heave_frame(1, i));
+    }
+    auto overrun = reader->next();
+    ASSERT_FALSE(overrun.has_value());
+    EXPECT_EQ(overrun.error(), "Reader overrun, 24 entries lost");
+    EXPECT_EQ(reader->lost(), 24);
+
+    // Resumes at the oldest entry in the ring
+    for (uint8_t i = 24; i < 40; i++) {
+        auto entry = reader->next();
+        ASSERT_TRUE(entry.has_value() && entry->has_value());
+        EXPECT_EQ((*entry)->frame.data[0], i);
+    }
+    EXPECT_FALSE(reader->next()->has_value());
+}
+
+TEST_F(ShmRingTest, OpeningMissingRingFails) {
+    auto reader = nmea::ShmRingReader::open("/nmea-test-does-not-exist");
+    EXPECT_FALSE(reader.has_value());
+}
+
+TEST_F(ShmRingTest, ListenerPublishesFramesAndMessages) {
+    auto writer = nmea::ShmRingWriter::create(name);
+    ASSERT_TRUE(writer.has_value()) << writer.error();
+    auto reader = nmea::ShmRingReader::open(name);
+    ASSERT_TRUE(reader.has_value()) << reader.error();
+
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach());
+    listener.set_shm_ring(&*writer);
+
+    ASSERT_TRUE(sender->write(heave_frame(0x10, 3)).has_value());
+    ASSERT_TRUE(listener.read().has_value());
+
+    auto entry = reader->next();
+    ASSERT_TRUE(entry.has_value() && entry->has_value());
+    EXPECT_EQ((*entry)->frame.can_id & 0xFF, 0x10);
+    ASSERT_TRUE((*entry)->message.has_value());
+    EXPECT_EQ(std::get<nmea::message::Heave>(*(*entry)->message).sid, 3);
+}
@@ -0,0 +1,334 @@
+#include "frames.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/stream_server.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <netinet/in.h>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+struct Record {
+    uint8_t type;
+    uint64_t timestamp;
+    std::vector<uint8_t> payload;
+};
+
+class StreamClient {
+public:
+    explicit StreamClient(const std::string &path) {
+        m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+        m_connected = connect(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    }
+
+    explicit StreamClient(uint16_t port) {
+        m_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        m_connected = connect(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    }
+
+    ~StreamClient() { close(m_fd); }
+
+    StreamClient(const StreamClient &other) = delete;
+    StreamClient &operator=(const StreamClient &other) = delete;
+    StreamClient(StreamClient &&other) noexcept = delete;
+    StreamClient &operator=(StreamClient &&other) noexcept = delete;
+
+    bool connected() const { return m_connected; }
+
+    /// Stop receiving, so that the server fails to write with EPIPE
+    void shutdown_read() { shutdown(m_fd, SHUT_RD); }
+
+    void subscribe(uint8_t types, const std::vector<uint32_t> &pgns) {
+        std::vector<uint8_t> msg;
+        const auto length = static_cast<uint16_t>(2 + pgns.size() * 4);
+        msg.push_back(static_cast<uint8_t>(length));
+        msg.push_back(static_cast<uint8_t>(length >> 8));
+        msg.push_back(nmea::stream::SUBSCRIBE);
+        msg.push_back(types);
+        for (uint32_t pgn : pgns) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                msg.push_back(static_cast<uint8_t>(pgn >> shift));
+            }
+        }
+        ASSERT_EQ(::write(m_fd, msg.data(), msg.size()), static_cast<ssize_t>(msg.size()));
+    }
+
+    std::optional<Record> read(std::chrono::milliseconds timeout = 1000ms) {
+        auto header = read_exact(2, timeout);
+        if (!header) {
+            return std::nullopt;
+        }
+        const size_t length = (*header)[0] | (size_t{(*header)[1]} << 8);
+        auto body = read_exact(length, timeout);
+        if (!body) {
+            return std::nullopt;
+        }
+        Record record{.type = (*body)[0], .timestamp = 0, .payload = {}};
+        for (size_t i = 0; i < 8; i++) {
+            record.timestamp |= uint64_t{(*body)[1 + i]} << (8 * i);
+        }
+        record.payload.assign(body->begin() + 9, body->end());
+        return record;
+    }
+
+private:
+    std::optional<std::vector<uint8_t>> read_exact(size_t size,
+                                                   std::chrono::milliseconds timeout) {
+        std::vector<uint8_t> result(size);
+        size_t done = 0;
+        while (done < size) {
+            pollfd pfd{.fd = m_fd, .events = POLLIN, .revents = 0};
+            if (poll(&pfd, 1, static_cast<int>(timeout.count())) <= 0) {
+                return std::nullopt;
+            }
+            auto nbytes = ::read(m_fd, result.data() + done, size - done);
+            if (nbytes <= 0) {
+                return std::nullopt;
+            }
+            done += static_cast<size_t>(nbytes);
+        }
+        return result;
+    }
+
+    int m_fd;
+    bool m_connected = false;
+};
+
+static can_frame position_frame(uint8_t source) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (2u << 26) | (nmea::pgn::POSITION << 8) | source;
+    frame.can_dlc = 8;
+    return frame;
+}
+
+// Publish positions until one arrives without its raw frame, once the server read a subscription
+// to decoded positions only
+static void wait_for_subscription(nmea::StreamServer &server, StreamClient &client) {
+    for (int i = 0; i < 200; i++) {
+        const auto marker = std::format(R"("latitude":{},)", i);
+        server.publish(position_frame(0x7F),
+                       nmea::message::Position{.latitude = static_cast<double>(i), .longitude = 0});
+        size_t records = 0;
+        std::optional<Record> record;
+        do {
+            record = client.read();
+            records++;
+        } while (record && std::string(record->payload.begin(), record->payload.end())
+                                   .find(marker) == std::string::npos);
+        ASSERT_TRUE(record.has_value());
+        if (records == 1) {
+            return;
+        }
+    }
+    FAIL() << "Subscription was not applied";
+}
+
+static void wait_for_clients(const nmea::StreamServer &server, size_t count) {
+    for (int i = 0; i < 200 && server.clients() != count; i++) {
+        std::this_thread::sleep_for(5ms);
+    }
+    ASSERT_EQ(server.clients(), count);
+}
+
+class StreamServerTest : public ::testing::Test {
+protected:
+    std::string path = std::format("/tmp/nmea-stream-test-{}.sock", getpid());
+};
+
+TEST_F(StreamServerTest, SendsRawAndDecodedRecords) {
+    auto server = nmea::StreamServer::unix_socket(path);
+    ASSERT_TRUE(server.has_value()) << server.error();
+    StreamClient client(path);
+    ASSERT_TRUE(client.connected());
+    wait_for_clients(**server, 1);
+
+    const auto timestamp = nmea::StreamServer::Clock::time_point(1714566600000000123ns);
+    (*server)->publish(heave_frame(0x21, 4), nmea::message::Heave{.sid = 4, .heave = 0.5},
+                       timestamp);
+
+    auto raw = client.read();
+    ASSERT_TRUE(raw.has_value());
+    EXPECT_EQ(raw->type, nmea::stream::RAW_FRAME);
+    EXPECT_EQ(raw->timestamp, 1714566600000000123u);
+    ASSERT_EQ(raw->payload.size(), 4 + 1 + 8);
+    EXPECT_EQ(raw->payload[0], 0x21);
+    EXPECT_EQ(raw->payload[4], 8);
+    EXPECT_EQ(raw->payload[5], 4);
+
+    auto decoded = client.read();
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->type, nmea::stream::DECODED_MESSAGE);
+    EXPECT_EQ(std::string(decoded->payload.begin(), decoded->payload.end()),
+              R"({"pgn":127252,"src":33,"sid":4,"heave":0.5})");
+}
+
+TEST_F(StreamServerTest, Subscriptions) {
+    auto server = nmea::StreamServer::unix_socket(path);
+    ASSERT_TRUE(server.has_value()) << server.error();
+    StreamClient client(path);
+    client.subscribe(nmea::stream::SUBSCRIBE_DECODED, {nmea::pgn::POSITION});
+    wait_for_clients(**server, 1);
+    wait_for_subscription(**server, client);
+
+    (*server)->publish(heave_frame(1, 1), nmea::message::Heave{.sid = 1, .heave = 1.0});
+    (*server)->publish(position_frame(2),
+                       nmea::message::Position{.latitude = 1.0, .longitude = 2.0});
+
+    auto record = client.read();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(record->type, nmea::stream::DECODED_MESSAGE);
+    EXPECT_EQ(std::string(record->payload.begin(), record->payload.end()),
+              R"({"pgn":129025,"src":2,"latitude":1,"longitude":2})");
+    EXPECT_FALSE(client.read(100ms).has_value());
+}
+
+TEST_F(StreamServerTest, SubscriptionsMatchAddressedFrames) {
+    auto server = nmea::StreamServer::unix_socket(path);
+    ASSERT_TRUE(server.has_value()) << server.error();
+    StreamClient client(path);
+    client.subscribe(nmea::stream::SUBSCRIBE_RAW, {59904});
+    wait_for_clients(**server, 1);
+
+    // ISO Request addressed to 0x23, which carries the destination in the low byte of the PGN
+    can_frame request{};
+    request.can_id = CAN_EFF_FLAG | (6u << 26) | (0xEA23u << 8) | 0x42;
+    request.can_dlc = 3;
+    for (int i = 0; i < 200; i++) {
+        (*server)->publish(heave_frame(1, 1));
+        (*server)->publish(request);
+        auto record = client.read();
+        ASSERT_TRUE(record.has_value()) << "The addressed request did not match";
+        if (record->payload[0] == 0x42) {
+            // The heave before it was filtered out, so the subscription was applied
+            EXPECT_EQ(record->payload[1], 0x23);
+            return;
+        }
+        // Sent before the subscription was read, and followed by the request
+        record = client.read();
+        ASSERT_TRUE(record.has_value());
+        EXPECT_EQ(record->payload[0], 0x42);
+    }
+    FAIL() << "Subscription was not applied";
+}
+
+TEST_F(StreamServerTest, CoalescesRecords) {
+    auto server = nmea::StreamServer::unix_socket(path, {.coalesce_delay = 200ms});
+    ASSERT_TRUE(server.has_value()) << server.error();
+    StreamClient client(path);
+    wait_for_clients(**server, 1);
+
+    (*server)->publish(heave_frame(1, 1));
+    (*server)->publish(heave_frame(1, 2));
+    // Held back until the delay expires
+    EXPECT_FALSE(client.read(50ms).has_value());
+    auto first = client.read();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->payload[5], 1);
+    auto second = client.read(0ms);
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(second->payload[5], 2);
+}
+
+TEST_F(StreamServerTest, SlowClientIsDropped) {
+    auto server = nmea::StreamServer::unix_socket(
+        path, {.flush_threshold = 1024, .coalesce_delay = 1ms, .max_queued = 64 * 1024});
+    ASSERT_TRUE(server.has_value()) << server.error();
+    StreamClient slow(path);
+    StreamClient fast(path);
+    wait_for_clients(**server, 2);
+
+    // The fast client keeps reading, the slow one never does. Published in bursts, at a rate a
+    // reading client can keep up with
+    constexpr int FRAMES = 40000;
+    int received = 0;
+    std::thread reader([&] {
+        while (received < FRAMES && fast.read().has_value()) {
+            received++;
+        }
+    });
+    for (int i = 0; i < FRAMES; i++) {
+        (*server)->publish(heave_frame(1, static_cast<uint8_t>(i)));
+        if (i % 200 == 0) {
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+    reader.join();
+
+    EXPECT_EQ(received, FRAMES);
+    EXPECT_EQ((*server)->dropped_clients(), 1);
+    EXPECT_EQ((*server)->clients(), 1);
+}
+
+TEST_F(StreamServerTest, ClientThatWentAwayIsDisconnected) {
+    auto server = nmea::StreamServer::unix_socket(path);
+    ASSERT_TRUE(server.has_value()) << server.error();
+    StreamClient gone(path);
+    StreamClient client(path);
+    wait_for_clients(**server, 2);
+
+    // Writing to it fails with EPIPE, which must not raise SIGPIPE in the serving process
+    gone.shutdown_read();
+    (*server)->publish(heave_frame(1, 5));
+    wait_for_clients(**server, 1);
+
+    auto record = client.read();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(record->payload[5], 5);
+    EXPECT_EQ((*server)->dropped_clients(), 0);
+}
+
+TEST_F(StreamServerTest, Tcp) {
+    auto server = nmea::StreamServer::tcp(0);
+    ASSERT_TRUE(server.has_value()) << server.error();
+    ASSERT_NE((*server)->port(), 0);
+    StreamClient client((*server)->port());
+    ASSERT_TRUE(client.connected());
+    wait_for_clients(**server, 1);
+
+    (*server)->publish(heave_frame(1, 9));
+    auto record = client.read();
+    ASSERT_TRUE(record.has_value());
+    EXPECT_EQ(record->payload[5], 9);
+}
+
+TEST_F(StreamServerTest, ListenerPublishesFramesAndMessages) {
+    auto server = nmea::StreamServer::unix_socket(path);
+    ASSERT_TRUE(server.has_value()) << server.error();
+    StreamClient client(path);
+    wait_for_clients(**server, 1);
+
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach());
+    listener.set_stream_server(server->get());
+
+    ASSERT_TRUE(sender->write(heave_frame(0x10, 3)).has_value());
+    ASSERT_TRUE(listener.read().has_value());
+
+    auto raw = client.read();
+    ASSERT_TRUE(raw.has_value());
+    EXPECT_EQ(raw->type, nmea::stream::RAW_FRAME);
+    auto decoded = client.read();
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(decoded->type, nmea::stream::DECODED_MESSAGE);
+}
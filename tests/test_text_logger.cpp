@@ -0,0 +1,100 @@
+#include "nmea/message.hpp"
+#include "nmea/text_logger.hpp"
+#include <array>
+#include <format>
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Everything written to the pipe so far
+static std::string drain(int fd) {
+    std::string result;
+    std::array<char, 4096> chunk{};
+    while (true) {
+        auto nbytes = ::read(fd, chunk.data(), chunk.size());
+        if (nbytes <= 0) {
+            break;
+        }
+        result.append(chunk.data(), static_cast<size_t>(nbytes));
+        if (static_cast<size_t>(nbytes) < chunk.size()) {
+            break;
+        }
+    }
+    return result;
+}
+
+TEST(FormatterTest, DefaultSpec) {
+    nmea::message::Heave heave{.sid = 1, .heave = 1.5};
+    EXPECT_EQ(std::format("{}", heave), "Heave(SID=1, Heave=1.5)");
+}
+
+TEST(FormatterTest, PrecisionAppliesToScaledFields) {
+    nmea::message::Attitude attitude{.sid = 4, .yaw = 0.12345, .pitch = -1.0, .roll = 2.0};
+    EXPECT_EQ(std::format("{:.2f}", attitude),
+              "Attitude(SID=4, Yaw=0.12, Pitch=-1.00, Roll=2.00)");
+}
+
+TEST(FormatterTest, VariantForwardsSpec) {
+    nmea::NmeaMessage msg = nmea::message::Position{.latitude = 52.1, .longitude = 4.25};
+    EXPECT_EQ(std::format("{:.3f}", msg), "Position(Latitude=52.100, Longitude=4.250)");
+}
+
+TEST(FormatterTest, RawFieldsIgnorePrecision) {
+    nmea::CompactNmeaMessage msg = nmea::message::BasicHeave<nmea::policy::Raw>{.sid = 1,
+                                                                                .heave = 250};
+    EXPECT_EQ(std::format("{:.2f}", msg), "Heave(SID=1, Heave=250)");
+}
+
+class TextLoggerTest : public ::testing::Test {
+protected:
+    int fds[2]{};
+
+    void SetUp() override { ASSERT_EQ(pipe(fds), 0); }
+
+    void TearDown() override {
+        close(fds[0]);
+        close(fds[1]);
+    }
+};
+
+TEST_F(TextLoggerTest, BuffersUntilThreshold) {
+    nmea::TextLogger logger(fds[1], {.flush_threshold = 64});
+    ASSERT_TRUE(logger.log(nmea::NmeaMessage(nmea::message::Heave{.sid = 1, .heave = 1.5})));
+    EXPECT_EQ(logger.buffered(), 24);
+
+    ASSERT_TRUE(logger.log(nmea::NmeaMessage(nmea::message::Heave{.sid = 2, .heave = 2.5})));
+    ASSERT_TRUE(logger.log(nmea::NmeaMessage(nmea::message::Heave{.sid = 3, .heave = 3.5})));
+    EXPECT_EQ(logger.buffered(), 0);
+    EXPECT_EQ(drain(fds[0]), "Heave(SID=1, Heave=1.5)\n"
+                             "Heave(SID=2, Heave=2.5)\n"
+                             "Heave(SID=3, Heave=3.5)\n");
+}
+
+TEST_F(TextLoggerTest, BatchIsWrittenAtOnce) {
+    nmea::TextLogger logger(fds[1]);
+    std::vector<nmea::NmeaMessage> batch{
+        nmea::message::Heave{.sid = 1, .heave = 0.5},
+        nmea::message::Position{.latitude = 1.0, .longitude = 2.0},
+    };
+    ASSERT_TRUE(logger.log_batch(batch));
+    EXPECT_EQ(logger.buffered(), 0);
+    EXPECT_EQ(drain(fds[0]), "Heave(SID=1, Heave=0.5)\n"
+                             "Position(Latitude=1, Longitude=2)\n");
+}
+
+TEST_F(TextLoggerTest, FlushesOnDestruction) {
+    {
+        nmea::TextLogger logger(fds[1]);
+        ASSERT_TRUE(logger.log(nmea::NmeaMessage(nmea::message::Heave{.sid = 1, .heave = 1.0})));
+    }
+    EXPECT_EQ(drain(fds[0]), "Heave(SID=1, Heave=1)\n");
+}
+
+TEST_F(TextLoggerTest, ReportsWriteErrors) {
+    nmea::TextLogger logger(fds[0]);
+    ASSERT_TRUE(logger.log(nmea::NmeaMessage(nmea::message::Heave{.sid = 1, .heave = 1.0})));
+    auto result = logger.flush();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(logger.buffered(), 0);
+}
@@ -0,0 +1,36 @@
+#include "nmea/pipeline.hpp"
+#include "nmea/thread.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <atomic>
+#include <gtest/gtest.h>
+#include <sched.h>
+#include <thread>
+
+TEST(ThreadTest, PinsThreadToCpu) {
+    int cpu = -1;
+    auto thread = nmea::start_thread({.cpus = {0}}, [&] { cpu = sched_getcpu(); });
+    ASSERT_TRUE(thread.has_value()) << thread.error();
+    thread->join();
+    EXPECT_EQ(cpu, 0);
+}
+
+TEST(ThreadTest, FunctionDoesNotRunWhenOptionsFail) {
+    std::atomic<bool> ran = false;
+    auto thread = nmea::start_thread({.cpus = {-1}}, [&] { ran = true; });
+    ASSERT_FALSE(thread.has_value());
+    EXPECT_EQ(thread.error(), "Invalid CPU -1");
+
+    // 0 is not a SCHED_FIFO priority
+    thread = nmea::start_thread({.fifo_priority = 0}, [&] { ran = true; });
+    ASSERT_FALSE(thread.has_value());
+    EXPECT_TRUE(thread.error().starts_with("Unable to set SCHED_FIFO priority 0"))
+        << thread.error();
+    EXPECT_FALSE(ran);
+}
+
+TEST(ThreadTest, PipelineReportsIngestThreadError) {
+    nmea::VirtualBus bus;
+    nmea::Pipeline pipeline(bus.attach(), {.workers = 1, .ingest_thread = {.cpus = {-1}}});
+    EXPECT_EQ(pipeline.ingest_error(), "Invalid CPU -1");
+    EXPECT_FALSE(pipeline.next().has_value());
+}
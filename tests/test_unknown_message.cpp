@@ -0,0 +1,145 @@
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <numeric>
+#include <variant>
+#include <vector>
+
+struct ReceivedUnknown {
+    uint32_t pgn;
+    uint8_t priority;
+    uint8_t source;
+    uint8_t destination;
+    std::vector<uint8_t> data;
+};
+
+static can_frame make_frame(uint8_t priority, uint32_t pgn, uint8_t source,
+                            std::initializer_list<uint8_t> data) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | (uint32_t(priority) << 26) | (pgn << 8) | source;
+    frame.can_dlc = static_cast<uint8_t>(data.size());
+    std::ranges::copy(data, frame.data);
+    return frame;
+}
+
+static void record_unknown(nmea::Listener &listener, std::vector<ReceivedUnknown> &received) {
+    listener.set_unknown_handler([&](const nmea::UnknownMessage &msg) {
+        received.push_back({
+            .pgn = msg.pgn,
+            .priority = msg.priority,
+            .source = msg.source,
+            .destination = msg.destination,
+            .data = {msg.data.begin(), msg.data.end()},
+        });
+    });
+}
+
+TEST(UnknownMessageTest, SupportedPgns) {
+    EXPECT_TRUE(nmea::is_supported(nmea::pgn::VESSEL_HEADING));
+    EXPECT_TRUE(nmea::is_supported(nmea::pgn::ACTUAL_PRESSURE));
+    EXPECT_FALSE(nmea::is_supported(130306));
+    EXPECT_FALSE(nmea::is_supported(0));
+    static_assert(nmea::is_supported(nmea::pgn::POSITION));
+}
+
+TEST(UnknownMessageTest, HandlerReceivesSingleFrames) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach());
+    std::vector<ReceivedUnknown> received;
+    record_unknown(listener, received);
+
+    // PGN 130306 - Wind Data, which is not decoded
+    ASSERT_TRUE(sender->write(make_frame(2, 130306, 0x15, {1, 2, 3, 4, 5, 6})).has_value());
+    ASSERT_TRUE(sender->write(make_frame(2, nmea::pgn::HEAVE, 0x16, {9, 0xE8, 0x03})).has_value());
+
+    // The unknown message is handed over and `read()` goes on to the next one
+    auto heave = listener.read();
+    ASSERT_TRUE(heave.has_value());
+    EXPECT_EQ(std::get<nmea::message::Heave>(*heave).sid, 9);
+    EXPECT_EQ(listener.last_source(), 0x16);
+
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received[0].pgn, 130306);
+    EXPECT_EQ(received[0].priority, 2);
+    EXPECT_EQ(received[0].source, 0x15);
+    EXPECT_EQ(received[0].destination, 0xFF);
+    EXPECT_EQ(received[0].data, (std::vector<uint8_t>{1, 2, 3, 4, 5, 6}));
+}
+
+TEST(UnknownMessageTest, SplitsDestinationOfPdu1Pgns) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach());
+    std::vector<ReceivedUnknown> received;
+    record_unknown(listener, received);
+
+    // PGN 59904 - ISO Request of PGN 60928, addressed to 0x23
+    ASSERT_TRUE(sender->write(make_frame(6, 0xEA23, 0x42, {0x00, 0xEE, 0x00})).has_value());
+    ASSERT_TRUE(sender->write(make_frame(2, nmea::pgn::HEAVE, 0x16, {9, 0xE8, 0x03})).has_value());
+    ASSERT_TRUE(listener.read().has_value());
+
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received[0].pgn, 59904);
+    EXPECT_EQ(received[0].priority, 6);
+    EXPECT_EQ(received[0].source, 0x42);
+    EXPECT_EQ(received[0].destination, 0x23);
+}
+
+TEST(UnknownMessageTest, HandlerReceivesReassembledTransfers) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach());
+    std::vector<ReceivedUnknown> received;
+    record_unknown(listener, received);
+
+    // PGN 129029 - GNSS Position Data, 43 bytes broadcast in 7 packets
+    std::vector<uint8_t> payload(43);
+    std::iota(payload.begin(), payload.end(), uint8_t{0});
+    const uint32_t gnss = 129029;
+    ASSERT_TRUE(sender
+                    ->write(make_frame(3, 0xECFF, 0x07,
+                                       {0x20, 43, 0, 7, 0xFF, gnss & 0xFF, (gnss >> 8) & 0xFF,
+                                        (gnss >> 16) & 0xFF}))
+                    .has_value());
+    for (uint8_t seq = 1; seq <= 7; seq++) {
+        can_frame dt = make_frame(3, 0xEBFF, 0x07, {seq, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+        const size_t offset = (seq - 1) * 7;
+        std::copy_n(payload.begin() + static_cast<ptrdiff_t>(offset),
+                    std::min<size_t>(7, payload.size() - offset), dt.data + 1);
+        ASSERT_TRUE(sender->write(dt).has_value());
+    }
+    ASSERT_TRUE(sender->write(make_frame(2, nmea::pgn::HEAVE, 0x16, {9, 0xE8, 0x03})).has_value());
+    ASSERT_TRUE(listener.read().has_value());
+
+    ASSERT_EQ(received.size(), 1);
+    EXPECT_EQ(received[0].pgn, gnss);
+    EXPECT_EQ(received[0].priority, 3);
+    EXPECT_EQ(received[0].source, 0x07);
+    EXPECT_EQ(received[0].destination, 0xFF);
+    EXPECT_EQ(received[0].data, payload);
+}
+
+TEST(UnknownMessageTest, ErrorsWithoutHandler) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    nmea::Listener listener(bus.attach());
+
+    ASSERT_TRUE(sender->write(make_frame(2, 130306, 0x15, {1, 2, 3})).has_value());
+    auto result = listener.read();
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), "PGN 130306 not supported");
+
+    // Errors of supported PGNs are still returned with a handler
+    std::vector<ReceivedUnknown> received;
+    record_unknown(listener, received);
+    ASSERT_TRUE(sender->write(make_frame(2, nmea::pgn::HEAVE, 0x16, {9})).has_value());
+    auto truncated = listener.read();
+    ASSERT_FALSE(truncated.has_value());
+    EXPECT_EQ(truncated.error(), "PGN 127252 payload too short: got 1 bytes, expected 3");
+    EXPECT_TRUE(received.empty());
+}
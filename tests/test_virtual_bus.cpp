@@ -0,0 +1,165 @@
+#include "nmea/definitions.hpp"
+#include "nmea/device.hpp"
+#include "nmea/listener.hpp"
+#include "nmea/message.hpp"
+#include "nmea/virtual_bus.hpp"
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <gtest/gtest.h>
+#include <linux/can.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static can_frame make_frame(uint32_t id) {
+    can_frame frame{};
+    frame.can_id = CAN_EFF_FLAG | id;
+    frame.can_dlc = 8;
+    return frame;
+}
+
+TEST(VirtualBusTest, FramesFanOutToOtherNodes) {
+    nmea::VirtualBus bus;
+    auto sender = bus.attach();
+    std::vector<std::unique_ptr<nmea::Transport>> receivers;
+    for (int i = 0; i < 3; i++) {
+        receivers.push_back(bus.attach());
+    }
+    EXPECT_EQ(bus.nodes(), 4);
+
+    ASSERT_TRUE(sender->write(make_frame(0x123)).has_value());
+
+    for (auto &receiver : receivers) {
+        ASSERT_TRUE(receiver->wait(std::chrono::milliseconds(0)));
+        can_frame frame{};
+        ASSERT_TRUE(receiver->read(frame).has_value());
+        EXPECT_EQ(frame.can_id & CAN_EFF_MASK, 0x123);
+    }
+    EXPECT_FALSE(sender->wait(std::chrono::milliseconds(0)));
+}
+
+TEST(VirtualBusTest, DetachedNodesAreRemoved) {
+    nmea::VirtualBus bus;
+    auto node = bus.attach();
+    {
+        auto other = bus.attach();
+        EXPECT_EQ(bus.nodes(), 2);
+    }
+    EXPECT_EQ(bus.nodes(), 1);
+}
+
+TEST(VirtualBusTest, LowestIdWinsArbitration) {
+    // 1 kbit/s makes every frame occupy the bus for over 100 ms
+    nmea::VirtualBus bus({.bitrate = 1000});
+    auto first = bus.attach();
+    auto second = bus.attach();
+    auto receiver = bus.attach();
+
+    // The bus is busy with the first frame while the others queue up
+    ASSERT_TRUE(first->write(make_frame(0x300)).has_value());
+    ASSERT_TRUE(first->write(make_frame(0x200)).has_value());
+    ASSERT_TRUE(second->write(make_frame(0x100)).has_value());
+
+    std::vector<uint32_t> order;
+    for (int i = 0; i < 3; i++) {
+        can_frame frame{};
+        ASSERT_TRUE(receiver->read(frame).has_value());
+        order.push_back(frame.can_id & CAN_EFF_MASK);
+    }
+    EXPECT_EQ(order, (std::vector<uint32_t>{0x300, 0x100, 0x200}));
+}
+
+TEST(VirtualBusTest, FrameQueuedBehindBusyBusReachesBlockedReader) {
+    nmea::VirtualBus bus({.bitrate = 1000});
+    auto sender = bus.attach();
+    auto receiver = bus.attach();
+
+    // The receiver's own frame keeps the bus busy, and is not delivered back to it
+    ASSERT_TRUE(receiver->write(make_frame(0x300)).has_value());
+    auto read = std::async(std::launch::async, [&] {
+        can_frame frame{};
+        auto result = receiver->read(frame);
+        return result ? frame.can_id & CAN_EFF_MASK : 0;
+    });
+    // Let the reader block with nothing to wait for. If it has not yet, the frame is still read
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_TRUE(sender->write(make_frame(0x100)).has_value());
+
+    const bool delivered = read.wait_for(std::chrono::seconds(2)) == std::future_status::ready;
+    if (!delivered) {
+        // Drives the bus, which unblocks the reader
+        ASSERT_TRUE(sender->write(make_frame(0x200)).has_value());
+    }
+    EXPECT_TRUE(delivered) << "The queued frame was only transmitted by the next write";
+    EXPECT_EQ(read.get(), 0x100u);
+}
+
+TEST(VirtualBusTest, LatencyDelaysDelivery) {
+    nmea::VirtualBus bus({.latency = std::chrono::milliseconds(50)});
+    auto sender = bus.attach();
+    auto receiver = bus.attach();
+
+    ASSERT_TRUE(sender->write(make_frame(0x123)).has_value());
+
+    EXPECT_FALSE(receiver->wait(std::chrono::milliseconds(0)));
+    EXPECT_TRUE(receiver->wait(std::chrono::milliseconds(200)));
+}
+
+TEST(VirtualBusTest, LossIsReproducible) {
+    auto run = [] {
+        nmea::VirtualBus bus({.loss = 0.5, .seed = 1234});
+        auto sender = bus.attach();
+        auto receiver = bus.attach();
+        std::vector<bool> received;
+        for (int i = 0; i < 64; i++) {
+            EXPECT_TRUE(sender->write(make_frame(0x123)).has_value());
+            received.push_back(receiver->wait(std::chrono::milliseconds(0)));
+            if (received.back()) {
+                can_frame frame{};
+                EXPECT_TRUE(receiver->read(frame).has_value());
+            }
+        }
+        EXPECT_GT(bus.frames_dropped(), 0);
+        EXPECT_EQ(bus.frames_transmitted(), 64);
+        return received;
+    };
+
+    EXPECT_EQ(run(), run());
+}
+
+TEST(VirtualBusTest, DeviceAndListener) {
+    nmea::VirtualBus bus;
+    nmea::Device device(bus.attach());
+    nmea::Listener listener(bus.attach());
+    EXPECT_EQ(listener.sockfd(), -1);
+
+    nmea::DeviceName name{
+        .unique_number = 42,
+        .manufacturer_code = ManufacturerCode::ACTISENSE,
+        .device_instance_lower = 0,
+        .device_instance_upper = 0,
+        .device_function = device_function::RADAR,
+        .system_instance = 0,
+        .industry_group = IndustryCode::MARINE,
+        .arbitrary_address_capable = true,
+    };
+    ASSERT_TRUE(device.claim(name).get().has_value());
+    // Flush the request for address claim and the address claim
+    auto _ = listener.read();
+    _ = listener.read();
+
+    nmea::message::VesselSpeedComponents original{
+        .longitudinal = {.water = 1.0, .ground = 2.0},
+        .transverse = {.water = 3.0, .ground = 4.0},
+        .stern = {.water = 5.0, .ground = 6.0},
+    };
+    ASSERT_TRUE(device.send(original).has_value());
+
+    auto result = listener.read();
+    ASSERT_TRUE(result.has_value());
+    auto *msg = std::get_if<nmea::message::VesselSpeedComponents>(&*result);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_DOUBLE_EQ(msg->stern.ground, original.stern.ground);
+    EXPECT_EQ(listener.last_source(), *device.address());
+}